@@ -0,0 +1,291 @@
+"""
+Local stand-in for the CoAP server of the device uplink (CONFIG_STINGSENSE_UPLINK).
+
+Accepts the batches the device POSTs block-wise (RFC 7959 Block1) to /records, acknowledges
+every block and answers the last one with 2.04 Changed, which confirms the batch to the device.
+Retransmitted blocks are answered from a cache, so a lost acknowledgement does not store a batch
+twice. The records are decoded like the framed serial output, see serial_frames.py, and printed
+or appended to a JSON lines file. Only the CoAP needed by the device is implemented, there are
+no dependencies.
+
+    python coap_server.py [--port 5683] [--output records.jsonl] [--loss 0.1]
+
+With --loss a fraction of the datagrams is dropped in both directions, to exercise the
+retransmissions and retries of the device. The statistics printed with every batch count the
+round trips (blocks received) and the duplicate blocks, sent again because an acknowledgement
+was lost, per 1000 records.
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import struct
+
+from serial_frames import SENSOR_RECORD, decode_sensor_record
+
+COAP_VERSION = 1
+TYPE_CON = 0
+TYPE_NON = 1
+TYPE_ACK = 2
+TYPE_RST = 3
+
+CODE_POST = 0x02
+CODE_CHANGED = 0x44        # 2.04
+CODE_CONTINUE = 0x5f       # 2.31
+CODE_BAD_REQUEST = 0x80    # 4.00
+CODE_NOT_FOUND = 0x84      # 4.04
+CODE_METHOD_NOT_ALLOWED = 0x85  # 4.05
+CODE_INCOMPLETE = 0x88     # 4.08 Request Entity Incomplete
+CODE_TOO_LARGE = 0x8d      # 4.13
+
+OPTION_URI_PATH = 11
+OPTION_BLOCK1 = 27
+
+# struct uplink_batch_header in src/uplink.h
+UPLINK_BATCH_HEADER = struct.Struct('<BBHI')
+UPLINK_BATCH_VERSION = 1
+# Largest batch accepted
+MAX_BODY = 64 * 1024
+# Responses kept for retransmitted requests, EXCHANGE_LIFETIME is 247 s
+RESPONSE_CACHE = 256
+
+
+def parse_message(data):
+    """Returns (type, code, message id, token, options, payload), options as (number, value)."""
+    if len(data) < 4:
+        raise ValueError("short message")
+    first, code, mid = struct.unpack_from('!BBH', data)
+    if first >> 6 != COAP_VERSION:
+        raise ValueError("unknown version")
+    msg_type = (first >> 4) & 0x3
+    tkl = first & 0xf
+    if tkl > 8 or len(data) < 4 + tkl:
+        raise ValueError("bad token")
+    token = data[4:4 + tkl]
+    pos = 4 + tkl
+
+    options = []
+    number = 0
+    while pos < len(data) and data[pos] != 0xff:
+        delta, length = data[pos] >> 4, data[pos] & 0xf
+        pos += 1
+        values = []
+        for nibble in (delta, length):
+            if nibble == 13:
+                values.append(data[pos] + 13)
+                pos += 1
+            elif nibble == 14:
+                values.append(struct.unpack_from('!H', data, pos)[0] + 269)
+                pos += 2
+            elif nibble == 15:
+                raise ValueError("bad option")
+            else:
+                values.append(nibble)
+        number += values[0]
+        options.append((number, data[pos:pos + values[1]]))
+        pos += values[1]
+    if pos > len(data):
+        raise ValueError("truncated option")
+    payload = data[pos + 1:] if pos < len(data) else b''
+    return msg_type, code, mid, token, options, payload
+
+
+def option_header(delta, length):
+    """Returns the option header byte and extended delta and length."""
+    out = bytearray([0])
+    nibbles = []
+    for value in (delta, length):
+        if value < 13:
+            nibbles.append(value)
+        elif value < 269:
+            nibbles.append(13)
+            out.append(value - 13)
+        else:
+            nibbles.append(14)
+            out += struct.pack('!H', value - 269)
+    out[0] = nibbles[0] << 4 | nibbles[1]
+    return bytes(out)
+
+
+def build_message(msg_type, code, mid, token, options=(), payload=b''):
+    out = bytearray(struct.pack('!BBH', COAP_VERSION << 6 | msg_type << 4 | len(token),
+                                code, mid))
+    out += token
+    number = 0
+    for opt_number, value in sorted(options):
+        out += option_header(opt_number - number, len(value)) + value
+        number = opt_number
+    if payload:
+        out += b'\xff' + payload
+    return bytes(out)
+
+
+def uint_option(value):
+    """Encodes an option value as the shortest unsigned integer."""
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def decode_block(value):
+    """Returns (num, more, size) of a Block1 or Block2 option."""
+    raw = int.from_bytes(value, 'big')
+    return raw >> 4, bool(raw & 0x8), 16 << (raw & 0x7)
+
+
+def decode_batch(body):
+    """Returns the first sequence number and the decoded records of an uplink batch."""
+    version, record_size, count, first_seq = UPLINK_BATCH_HEADER.unpack_from(body)
+    if version != UPLINK_BATCH_VERSION or record_size != SENSOR_RECORD.size:
+        raise ValueError(f"unknown batch version {version} or record size {record_size}")
+    start = UPLINK_BATCH_HEADER.size
+    if len(body) != start + count * record_size:
+        raise ValueError(f"batch of {count} records has {len(body)} bytes")
+    records = [decode_sensor_record(body[start + i * record_size:start + (i + 1) * record_size])
+               for i in range(count)]
+    return first_seq, records
+
+
+class UplinkServer(asyncio.DatagramProtocol):
+    def __init__(self, path, output=None, loss=0.0):
+        self.path = path
+        self.output = output
+        self.loss = loss
+        self.transport = None
+        self.transfers = {}
+        self.responses = {}
+        self.next_seq = {}
+        self.records = 0
+        self.batches = 0
+        self.blocks = 0
+        self.duplicates = 0
+        self.lost_records = 0
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if random.random() < self.loss:
+            return
+        try:
+            msg_type, code, mid, token, options, payload = parse_message(data)
+        except ValueError:
+            return
+
+        # A retransmission, the acknowledgement got lost
+        cached = self.responses.get((addr, mid))
+        if cached is not None:
+            self.duplicates += 1
+            self.send(cached, addr)
+            return
+
+        if msg_type not in (TYPE_CON, TYPE_NON) or code == 0:
+            # Empty message (ping) or a response
+            if msg_type == TYPE_CON:
+                self.send(build_message(TYPE_RST, 0, mid, b''), addr)
+            return
+
+        response_type = TYPE_ACK if msg_type == TYPE_CON else TYPE_NON
+        response_mid = mid if msg_type == TYPE_CON else random.getrandbits(16)
+        response_code, response_options = self.handle_request(addr, code, options, payload)
+        response = build_message(response_type, response_code, response_mid, token,
+                                 response_options)
+        self.responses[(addr, mid)] = response
+        if len(self.responses) > RESPONSE_CACHE:
+            del self.responses[next(iter(self.responses))]
+        self.send(response, addr)
+
+    def send(self, data, addr):
+        if random.random() >= self.loss:
+            self.transport.sendto(data, addr)
+
+    def handle_request(self, addr, code, options, payload):
+        path = '/'.join(value.decode('utf-8', errors='replace')
+                        for number, value in options if number == OPTION_URI_PATH)
+        if path != self.path:
+            return CODE_NOT_FOUND, []
+        if code != CODE_POST:
+            return CODE_METHOD_NOT_ALLOWED, []
+
+        self.blocks += 1
+        block1 = next((value for number, value in options if number == OPTION_BLOCK1), None)
+        if block1 is None:
+            body = payload
+        else:
+            num, more, size = decode_block(block1)
+            body = self.transfers.get(addr, b'') if num else b''
+            if len(body) != num * size:
+                # Out of order, the device starts the batch again
+                self.transfers.pop(addr, None)
+                return CODE_INCOMPLETE, []
+            body += payload
+            if len(body) > MAX_BODY:
+                self.transfers.pop(addr, None)
+                return CODE_TOO_LARGE, []
+            if more:
+                self.transfers[addr] = body
+                return CODE_CONTINUE, [(OPTION_BLOCK1, block1)]
+            self.transfers.pop(addr, None)
+
+        try:
+            first_seq, records = decode_batch(body)
+        except (ValueError, struct.error) as e:
+            print(f"{addr[0]}: rejected batch: {e}")
+            return CODE_BAD_REQUEST, []
+
+        self.store(addr, first_seq, records)
+        response_options = [] if block1 is None else [(OPTION_BLOCK1, block1)]
+        return CODE_CHANGED, response_options
+
+    def store(self, addr, first_seq, records):
+        expected = self.next_seq.get(addr[0])
+        if expected is not None and first_seq > expected:
+            # Dropped by the device from its full queue, or the device restarted
+            self.lost_records += first_seq - expected
+        self.next_seq[addr[0]] = first_seq + len(records)
+        self.records += len(records)
+        self.batches += 1
+
+        for seq, record in enumerate(records, first_seq):
+            record["seq"] = seq
+            if self.output:
+                self.output.write(json.dumps(record) + "\n")
+        if self.output:
+            self.output.flush()
+
+        print(f"{addr[0]}: batch of {len(records)} records from #{first_seq}, "
+              f"last {records[-1]['timestamp'] if records else '-'}")
+        print(f"  {self.records} records in {self.batches} batches, "
+              f"{self.blocks * 1000 / self.records:.1f} round trips and "
+              f"{self.duplicates * 1000 / self.records:.1f} duplicates per 1000 records, "
+              f"{self.lost_records} records lost")
+
+
+async def main():
+    parser = argparse.ArgumentParser(description="Local CoAP server for the device uplink.")
+    parser.add_argument('--host', default='0.0.0.0', help='Address to listen on')
+    parser.add_argument('--port', type=int, default=5683)
+    parser.add_argument('--path', default='records',
+                        help='Resource path (CONFIG_STINGSENSE_UPLINK_PATH)')
+    parser.add_argument('--output', metavar='JSONL', help='Append the records to this file')
+    parser.add_argument('--loss', type=float, default=0.0,
+                        help='Fraction of datagrams to drop, in each direction')
+    args = parser.parse_args()
+
+    output = open(args.output, 'a') if args.output else None
+    loop = asyncio.get_running_loop()
+    transport, _ = await loop.create_datagram_endpoint(
+        lambda: UplinkServer(args.path, output, args.loss), local_addr=(args.host, args.port))
+    print(f"Listening on coap://{args.host}:{args.port}/{args.path}")
+    try:
+        await asyncio.Event().wait()
+    finally:
+        transport.close()
+        if output:
+            output.close()
+
+
+if __name__ == '__main__':
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,121 @@
+"""
+Decoder for the binary dictionary log stream of the device.
+
+With CONFIG_LOG_BACKEND_UART_OUTPUT_DICTIONARY_BIN the device sends log messages and printk
+output as binary messages that only carry the address of the format string and the arguments.
+The strings are looked up in the log dictionary database written by the build
+(build/zephyr/log_dictionary.json), using the dictionary parser that comes with Zephyr
+($ZEPHYR_BASE/scripts/logging/dictionary). The database must be from the build that runs on the
+device.
+
+Text written straight to the UART (shell, AT host) can be interleaved with the binary messages,
+between messages. Binary messages start with a message type byte of 0 or 1, which never
+appears in text, so the two are told apart by the first byte after each message.
+"""
+
+import contextlib
+import io
+import os
+import re
+import struct
+import sys
+
+MSG_TYPE_NORMAL = 0
+MSG_TYPE_DROPPED = 1
+# A message that can't be parsed from this many bytes is corrupt, resync from the next byte.
+MAX_MSG_LEN = 4096
+# Color codes added by the Zephyr parser.
+ANSI_COLOR = re.compile(r'\x1b\[[0-9;]*m')
+
+
+class DictionaryLogDecoder:
+    def __init__(self, database_path, zephyr_base=None):
+        zephyr_base = zephyr_base or os.environ.get('ZEPHYR_BASE')
+        if not zephyr_base:
+            raise ValueError("ZEPHYR_BASE is not set, needed for the dictionary log parser")
+        sys.path.insert(0, os.path.join(zephyr_base, 'scripts', 'logging', 'dictionary'))
+        import dictionary_parser
+        from dictionary_parser.log_database import LogDatabase
+
+        database = LogDatabase.read_json_database(database_path)
+        if database is None:
+            raise ValueError(f"Failed to read the log dictionary database {database_path}")
+        self.parser = dictionary_parser.get_parser(database)
+        if self.parser is None:
+            raise ValueError(f"Unsupported log dictionary database version in {database_path}")
+        endian = '<' if database.is_tgt_little_endian() else '>'
+        self.fmt_dropped = getattr(self.parser, 'fmt_dropped_cnt', endian + 'H')
+
+        self.buf = bytearray()
+        self.text = ''
+        self.dropped = 0
+
+    def _parse_one(self):
+        """
+        Parses the message at the start of the buffer. Returns its length and decoded text,
+        or (0, None) if the message is not complete yet.
+        """
+        if self.buf[0] == MSG_TYPE_DROPPED:
+            size = 1 + struct.calcsize(self.fmt_dropped)
+            if len(self.buf) < size:
+                return 0, None
+            count = struct.unpack_from(self.fmt_dropped, self.buf, 1)[0]
+            self.dropped += count
+            return size, f"--- {count} messages dropped ---\n"
+
+        out = io.StringIO()
+        try:
+            with contextlib.redirect_stdout(out):
+                end = self.parser.parse_one_normal_msg(bytes(self.buf), 1)
+        except struct.error:
+            # Header or arguments cut off
+            return 0, None
+        # The parser takes the message length from the header, past the end the message is
+        # still being received.
+        if end is None or end > len(self.buf):
+            return 0, None
+        return end, ANSI_COLOR.sub('', out.getvalue())
+
+    def feed(self, data):
+        """Adds bytes received from the device, returns the complete lines decoded so far."""
+        self.buf.extend(data)
+
+        while self.buf:
+            if self.buf[0] not in (MSG_TYPE_NORMAL, MSG_TYPE_DROPPED):
+                # Plain text up to the next message
+                end = next((i for i, b in enumerate(self.buf)
+                            if b in (MSG_TYPE_NORMAL, MSG_TYPE_DROPPED)), len(self.buf))
+                self.text += self.buf[:end].decode('utf-8', errors='ignore')
+                del self.buf[:end]
+                continue
+
+            try:
+                size, text = self._parse_one()
+            except Exception:
+                # Unknown format string or corrupt message
+                size, text = 1, ''
+            if size == 0:
+                if len(self.buf) < MAX_MSG_LEN:
+                    break
+                size, text = 1, ''
+            del self.buf[:size]
+            self.text += text
+
+        lines = self.text.split('\n')
+        self.text = lines.pop()
+        return [line.rstrip('\r') for line in lines]
+
+
+def serial_lines(ser, decoder=None):
+    """
+    Yields the lines read from the serial port, stripped. With a decoder the binary dictionary
+    log stream is decoded first.
+    """
+    if decoder is None:
+        while True:
+            yield ser.readline().decode('utf-8', errors='ignore').strip()
+
+    while True:
+        data = ser.read(max(ser.in_waiting, 1))
+        for line in decoder.feed(data):
+            yield line.strip()
@@ -0,0 +1,194 @@
+"""
+Local HTTPS stand-in for the nRF Cloud REST API used for assistance
+(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD).
+
+Answers the A-GNSS and P-GPS requests of the device with canned responses. For each request
+it prints the bytes received and sent and the time taken, and for each connection its number
+of requests, so that the keep-alive connection of the device can be checked. There are no
+dependencies.
+
+    openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 365 \\
+        -subj /CN=192.168.1.10 -keyout rest_key.pem -out rest_cert.pem
+    python rest_server.py --cert rest_cert.pem --key rest_key.pem [--agnss agnss.bin]
+
+The device needs CONFIG_NRF_CLOUD_REST_HOST_NAME set to the address of this host and
+rest_cert.pem provisioned as the CA certificate of CONFIG_NRF_CLOUD_SEC_TAG. The JWT is not
+verified. --idle-timeout closes connections idle for that long, as the real server does, to
+exercise the reconnect of the device. --jwt-lifetime refuses a token with 401 once it has
+been in use for that long, to exercise the JWT refresh. The A-GNSS response is served in the
+HTTP ranges the device asks for, as nRF Cloud does. Without --cert the server speaks plain
+HTTP, for testing on the host.
+"""
+
+import argparse
+import json
+import re
+import ssl
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+AGNSS_PATH = '/v1/location/agnss'
+PGPS_PATH = '/v1/location/pgps'
+PGPS_FILE_PATH = '/pgps/predictions.bin'
+
+# Placeholder A-GNSS response: schema version 1 and no elements
+DEFAULT_AGNSS = bytes([1])
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.connections = 0
+        self.requests = 0
+        self.rx_bytes = 0
+        self.tx_bytes = 0
+        self.tokens = {}
+
+    def connection(self):
+        with self.lock:
+            self.connections += 1
+            return self.connections
+
+    def request(self, rx_bytes, tx_bytes):
+        with self.lock:
+            self.requests += 1
+            self.rx_bytes += rx_bytes
+            self.tx_bytes += tx_bytes
+            return (f"{self.requests} requests on {self.connections} connections, "
+                    f"{self.rx_bytes} bytes received, {self.tx_bytes} bytes sent")
+
+    def token_age(self, token):
+        with self.lock:
+            return time.monotonic() - self.tokens.setdefault(token, time.monotonic())
+
+
+class RestHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    server_version = 'rest_server'
+
+    def setup(self):
+        super().setup()
+        self.connection_id = self.server.stats.connection()
+        self.connection_requests = 0
+        self.tx_bytes = 0
+        print(f"{self.client_address[0]}: connection {self.connection_id} opened")
+
+    def finish(self):
+        super().finish()
+        print(f"{self.client_address[0]}: connection {self.connection_id} closed after "
+              f"{self.connection_requests} requests")
+
+    def flush_headers(self):
+        if hasattr(self, '_headers_buffer'):
+            self.tx_bytes += sum(len(line) for line in self._headers_buffer)
+        super().flush_headers()
+
+    def log_message(self, format, *args):
+        pass
+
+    def do_GET(self):
+        self.handle_request()
+
+    def do_POST(self):
+        self.handle_request()
+
+    def handle_request(self):
+        start = time.monotonic()
+        length = int(self.headers.get('Content-Length', 0))
+        body = self.rfile.read(length) if length else b''
+        rx_bytes = len(self.requestline) + 2 + len(self.headers.as_bytes()) + len(body)
+        self.connection_requests += 1
+        self.tx_bytes = 0
+
+        self.range_header = None
+        status, content_type, payload = self.route(body)
+        self.send_response(status)
+        self.send_header('Content-Type', content_type)
+        if self.range_header:
+            self.send_header('Content-Range', self.range_header)
+        self.send_header('Content-Length', str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+        self.tx_bytes += len(payload)
+
+        totals = self.server.stats.request(rx_bytes, self.tx_bytes)
+        print(f"{self.client_address[0]}: {self.command} {self.path.split('?')[0]} {status}, "
+              f"{rx_bytes} bytes in, {self.tx_bytes} bytes out, "
+              f"{(time.monotonic() - start) * 1000:.1f} ms, "
+              f"request {self.connection_requests} on connection {self.connection_id}")
+        print(f"  {totals}")
+
+    def route(self, body):
+        auth = self.headers.get('Authorization', '')
+        if not auth.startswith('Bearer '):
+            return 401, 'text/plain', b'Missing JWT'
+        lifetime = self.server.jwt_lifetime
+        if lifetime and self.server.stats.token_age(auth) > lifetime:
+            return 401, 'text/plain', b'Expired JWT'
+
+        path = self.path.split('?')[0]
+        if path == AGNSS_PATH:
+            return self.ranged(self.server.agnss)
+        if path == PGPS_PATH:
+            host = self.headers.get('Host', 'localhost').split(':')[0]
+            location = {'host': host, 'path': PGPS_FILE_PATH.lstrip('/')}
+            return 200, 'application/json', json.dumps(location).encode()
+        if path == PGPS_FILE_PATH:
+            return 200, 'application/octet-stream', self.server.pgps
+        return 404, 'text/plain', b'Not found'
+
+    def ranged(self, payload):
+        """Answers a Range request with 206, as the device gets A-GNSS data in fragments."""
+        match = re.fullmatch(r'bytes=(\d+)-(\d*)', self.headers.get('Range', ''))
+        if not match:
+            return 200, 'application/octet-stream', payload
+        first = int(match.group(1))
+        last = min(int(match.group(2) or len(payload) - 1), len(payload) - 1)
+        if first >= len(payload):
+            self.range_header = f"bytes */{len(payload)}"
+            return 416, 'text/plain', b'Range not satisfiable'
+        self.range_header = f"bytes {first}-{last}/{len(payload)}"
+        return 206, 'application/octet-stream', payload[first:last + 1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local stand-in for the nRF Cloud REST API.")
+    parser.add_argument('--host', default='0.0.0.0', help='Address to listen on')
+    parser.add_argument('--port', type=int, default=443)
+    parser.add_argument('--cert', help='Server certificate, PEM. Plain HTTP without')
+    parser.add_argument('--key', help='Server private key, PEM')
+    parser.add_argument('--agnss', metavar='FILE', help='A-GNSS response body')
+    parser.add_argument('--pgps', metavar='FILE', help='P-GPS predictions file')
+    parser.add_argument('--idle-timeout', type=float, default=60.0,
+                        help='Close connections idle for this many seconds')
+    parser.add_argument('--jwt-lifetime', type=float, default=0.0,
+                        help='Refuse a JWT used for longer than this many seconds, 0 never')
+    args = parser.parse_args()
+
+    RestHandler.timeout = args.idle_timeout
+    server = ThreadingHTTPServer((args.host, args.port), RestHandler)
+    server.daemon_threads = True
+    server.stats = Stats()
+    server.jwt_lifetime = args.jwt_lifetime
+    server.agnss = open(args.agnss, 'rb').read() if args.agnss else DEFAULT_AGNSS
+    server.pgps = open(args.pgps, 'rb').read() if args.pgps else b''
+
+    scheme = 'http'
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        scheme = 'https'
+
+    print(f"Listening on {scheme}://{args.host}:{args.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Generates the kernel benchmark inputs and reference results.
+
+The inputs are taken from the telemetry log (bus_data.csv): acceleration
+windows synthesized the same way as for the native_sim replay trace, see
+gen_replay_trace.py, and consecutive positions of the recorded route.
+
+The reference results are calculated here in double precision with the same
+formulas as the firmware, so that the benchmark also checks that the kernels
+still return the right values:
+
+- calculate_stats(): mean, variance and the p1/p10/p90/p99 samples.
+- distance_calculate(): haversine distance to the next position.
+- lat_convert()/lon_convert(): GNSS integer coordinates, rounded as the
+  firmware does in single precision.
+"""
+
+import argparse
+import csv
+import math
+import os
+import struct
+import sys
+
+from gen_replay_trace import read_log
+
+WINDOW_SIZE = 60	# 3 s at 20 Hz, ACCEL_BUF_SIZE in main.c
+WINDOWS = 16
+POSITIONS = 64
+EARTH_RADIUS_METERS = 6371.0 * 1000.0
+LAT_CONV = 8388608.0 / 90.0
+LON_CONV = 16777216.0 / 360.0
+
+
+def f32(value):
+    """Rounds a value to single precision."""
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+def stats(window):
+    """Same as calculate_stats(): returns mean, variance, p1, p10, p90, p99."""
+    total = 0.0
+    total_sq = 0.0
+    for v in window:
+        total += v
+        total_sq += v * v
+    count = len(window)
+    mean = total / count
+    variance = (total_sq / count) - mean * mean
+    ordered = sorted(window)
+    return (mean, variance) + tuple(ordered[int(count * p)] for p in (0.01, 0.10, 0.90, 0.99))
+
+
+def distance(lat1, lon1, lat2, lon2):
+    """Same as distance_calculate()."""
+    d_lat = math.radians(lat2 - lat1)
+    d_lon = math.radians(lon2 - lon1)
+    a = math.sin(d_lat / 2) ** 2 + \
+        math.sin(d_lon / 2) ** 2 * math.cos(math.radians(lat1)) * math.cos(math.radians(lat2))
+    return EARTH_RADIUS_METERS * 2 * math.asin(math.sqrt(a))
+
+
+def coord_convert(value, conv):
+    """Same as lat_convert()/lon_convert(), in single precision."""
+    return int(f32(f32(value) * f32(conv)))
+
+
+def windows(accel):
+    """Returns WINDOWS windows spread over the trace, cycling through the magnitude and axes."""
+    count = len(accel) // WINDOW_SIZE
+    if count < WINDOWS:
+        sys.exit(f'trace too short, {count} windows of {WINDOW_SIZE} samples')
+    out = []
+    for i in range(WINDOWS):
+        start = (i * count // WINDOWS) * WINDOW_SIZE
+        samples = accel[start:start + WINDOW_SIZE]
+        kind = i % 4
+        if kind == 0:
+            out.append([math.sqrt(x * x + y * y + z * z) for x, y, z in samples])
+        else:
+            out.append([sample[kind - 1] for sample in samples])
+    return out
+
+
+def positions(fixes):
+    """Returns POSITIONS consecutive positions of the route, skipping the ones without a fix."""
+    valid = [(lat, lon) for _, lat, lon in fixes if lat is not None]
+    # Skip the first positions, the bus is usually parked while the device starts.
+    start = max(min(len(valid) // 4, len(valid) - POSITIONS - 1), 0)
+    out = valid[start:start + POSITIONS + 1]
+    if len(out) < POSITIONS + 1:
+        sys.exit(f'trace too short, {len(valid)} positions')
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--input', required=True, help='Telemetry log')
+    parser.add_argument('--output', required=True, help='Generated C include file')
+    args = parser.parse_args()
+
+    with open(args.input, newline='') as f:
+        rows = list(csv.DictReader(f))
+    if not rows or 'accel_stats_x_p1' not in rows[0]:
+        sys.exit(f'{args.input}: not a telemetry log')
+
+    # Gaps are kept, only the samples and positions themselves are used.
+    _, accel, fixes = read_log(rows, sys.maxsize)
+    wins = windows(accel)
+    pos = positions(fixes)
+
+    out = []
+    out.append(f'/* Generated by {os.path.basename(sys.argv[0])} from '
+               f'{os.path.basename(args.input)}, do not edit. */')
+    out.append('')
+    out.append(f'#define KERNEL_BENCH_WINDOW_SIZE {WINDOW_SIZE}')
+    out.append(f'#define KERNEL_BENCH_WINDOWS {WINDOWS}')
+    out.append(f'#define KERNEL_BENCH_POSITIONS {POSITIONS}')
+    out.append('')
+    out.append('static const double bench_windows[KERNEL_BENCH_WINDOWS]'
+               '[KERNEL_BENCH_WINDOW_SIZE] = {')
+    for window in wins:
+        out.append('\t{')
+        for i in range(0, WINDOW_SIZE, 4):
+            out.append('\t\t' + ' '.join(f'{v!r},' for v in window[i:i + 4]))
+        out.append('\t},')
+    out.append('};')
+    out.append('')
+    out.append('/* mean, variance, p1, p10, p90, p99 */')
+    out.append('static const double bench_window_stats[KERNEL_BENCH_WINDOWS][6] = {')
+    for window in wins:
+        out.append('\t{ ' + ', '.join(repr(v) for v in stats(window)) + ' },')
+    out.append('};')
+    out.append('')
+    out.append('/* Latitude, longitude, distance to the next position in meters, GNSS latitude and')
+    out.append(' * longitude. The last position is only the end point of the previous distance.')
+    out.append(' */')
+    out.append('static const struct bench_position bench_positions[KERNEL_BENCH_POSITIONS + 1] = {')
+    for i, (lat, lon) in enumerate(pos):
+        dist = distance(lat, lon, *pos[i + 1]) if i + 1 < len(pos) else 0.0
+        out.append(f'\t{{ {lat!r}, {lon!r}, {dist!r}, {coord_convert(lat, LAT_CONV)}, '
+                   f'{coord_convert(lon, LON_CONV)} }},')
+    out.append('};')
+    out.append('')
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Generates the native_sim replay trace from a recorded CSV file.
+
+Two inputs are accepted, told apart by their header row:
+
+- The telemetry log uploaded by serial_to_api.py (bus_data.csv), one row per
+  report with the local time, position and the acceleration summary of the
+  report window. The raw samples are not in the log, so 20 Hz samples are
+  synthesized for each row that follow the p1/p10/p90/p99 percentiles of each
+  axis.
+- A raw sample capture with the columns t_ms, x, y, z (m/s^2) and optionally
+  lat, lon (degrees). It is resampled to 20 Hz.
+
+The output defines REPLAY_ACCEL_RATE_HZ, REPLAY_START_UTC_S, the fixed rate
+replay_accel[] samples in mm/s^2 and the replay_fixes[] positions with the
+speed and heading derived from consecutive positions. Gaps in the recording
+longer than --max-gap seconds are cut out.
+"""
+
+import argparse
+import bisect
+import csv
+import datetime
+import math
+import os
+import random
+import sys
+from zoneinfo import ZoneInfo
+
+ACCEL_RATE_HZ = 20
+# Timestamps in the telemetry log are in the local time of serial_to_api.py.
+LOG_TIMEZONE = ZoneInfo('America/New_York')
+EARTH_RADIUS_METERS = 6371.0 * 1000.0
+NO_FIX = -2**31
+PERCENTILES = (0.01, 0.10, 0.90, 0.99)
+
+
+def distance_bearing(lat1, lon1, lat2, lon2):
+    """Returns the distance in meters and the bearing in degrees between two positions."""
+    phi1, phi2 = math.radians(lat1), math.radians(lat2)
+    d_phi = phi2 - phi1
+    d_lambda = math.radians(lon2 - lon1)
+    a = math.sin(d_phi / 2) ** 2 + math.cos(phi1) * math.cos(phi2) * math.sin(d_lambda / 2) ** 2
+    distance = 2 * EARTH_RADIUS_METERS * math.asin(math.sqrt(a))
+    y = math.sin(d_lambda) * math.cos(phi2)
+    x = math.cos(phi1) * math.sin(phi2) - math.sin(phi1) * math.cos(phi2) * math.cos(d_lambda)
+    return distance, (math.degrees(math.atan2(y, x)) + 360.0) % 360.0
+
+
+def quantile(pcts, q):
+    """Inverts the piecewise linear distribution through the given percentiles."""
+    q = min(max(q, PERCENTILES[0]), PERCENTILES[-1])
+    i = max(bisect.bisect_left(PERCENTILES, q), 1)
+    q0, q1 = PERCENTILES[i - 1], PERCENTILES[i]
+    return pcts[i - 1] + (pcts[i] - pcts[i - 1]) * (q - q0) / (q1 - q0)
+
+
+def compress_gaps(times_ms, max_gap_ms, step_ms):
+    """Returns the times with every gap longer than max_gap_ms shortened to step_ms."""
+    out = []
+    shift = 0
+    for i, t in enumerate(times_ms):
+        if i > 0 and t - times_ms[i - 1] > max_gap_ms:
+            shift += t - times_ms[i - 1] - step_ms
+        out.append(t - shift)
+    return out
+
+
+def read_log(rows, max_gap_ms):
+    """Reads the telemetry log, returns the start time, accel samples and fixes."""
+    rows = sorted(rows, key=lambda row: row['timestamp'])
+    stamps = [datetime.datetime.strptime(row['timestamp'], '%Y-%m-%d %H:%M:%S')
+              .replace(tzinfo=LOG_TIMEZONE) for row in rows]
+    start = stamps[0]
+    times_ms = [int((stamp - start).total_seconds() * 1000) for stamp in stamps]
+    steps = sorted(b - a for a, b in zip(times_ms, times_ms[1:]) if b > a)
+    step_ms = steps[len(steps) // 2] if steps else 3000
+    times_ms = compress_gaps(times_ms, max_gap_ms, step_ms)
+
+    accel = []
+    fixes = []
+    for i, row in enumerate(rows):
+        end_ms = times_ms[i + 1] if i + 1 < len(rows) else times_ms[i] + step_ms
+        count = max((end_ms - times_ms[i]) * ACCEL_RATE_HZ // 1000, 0)
+        # Stratified quantiles in a fixed shuffled order, so the window reproduces the
+        # percentiles while the trace stays the same from build to build.
+        order = list(range(count))
+        random.Random(i).shuffle(order)
+        axes = []
+        for axis in 'xyz':
+            pcts = [float(row[f'accel_stats_{axis}_p{p}']) for p in (1, 10, 90, 99)]
+            axes.append([quantile(pcts, (k + 0.5) / count) for k in order])
+        accel.extend(zip(*axes))
+
+        lat, lon = float(row['latitude']), float(row['longitude'])
+        fixes.append((times_ms[i], lat, lon) if lat or lon else (times_ms[i], None, None))
+
+    return start, accel, fixes
+
+
+def read_capture(rows, max_gap_ms):
+    """Reads a raw sample capture, returns the start time, accel samples and fixes."""
+    times_ms = [int(float(row['t_ms'])) for row in rows]
+    times_ms = compress_gaps([t - times_ms[0] for t in times_ms], max_gap_ms,
+                             1000 // ACCEL_RATE_HZ)
+
+    accel = []
+    k = 0
+    for t in range(0, times_ms[-1] + 1, 1000 // ACCEL_RATE_HZ):
+        while k + 1 < len(times_ms) and times_ms[k + 1] <= t:
+            k += 1
+        accel.append(tuple(float(rows[k][axis]) for axis in 'xyz'))
+
+    fixes = []
+    if 'lat' in rows[0] and 'lon' in rows[0]:
+        last_s = None
+        for t, row in zip(times_ms, rows):
+            # One fix per second is enough, GNSS gives no more.
+            if last_s == t // 1000 or not row['lat']:
+                continue
+            last_s = t // 1000
+            fixes.append((t, float(row['lat']), float(row['lon'])))
+
+    return datetime.datetime.now(datetime.timezone.utc).replace(microsecond=0), accel, fixes
+
+
+def fix_rows(fixes):
+    """Adds the speed in cm/s and heading in centidegrees towards the next fix."""
+    out = []
+    for i, (t, lat, lon) in enumerate(fixes):
+        speed = heading = 0
+        if lat is not None and i + 1 < len(fixes) and fixes[i + 1][1] is not None:
+            t2, lat2, lon2 = fixes[i + 1]
+            distance, bearing = distance_bearing(lat, lon, lat2, lon2)
+            if t2 > t:
+                speed = min(round(distance / ((t2 - t) / 1000) * 100), 2**16 - 1)
+            heading = round(bearing * 100) % 36000
+        if lat is None:
+            out.append((t, NO_FIX, NO_FIX, 0, 0))
+        else:
+            out.append((t, round(lat * 1e7), round(lon * 1e7), speed, heading))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--input', required=True, help='Telemetry log or raw sample capture')
+    parser.add_argument('--output', required=True, help='Generated C include file')
+    parser.add_argument('--max-gap', type=float, default=30.0,
+                        help='Gaps longer than this (seconds) are cut out')
+    args = parser.parse_args()
+
+    with open(args.input, newline='') as f:
+        rows = list(csv.DictReader(f))
+    if not rows:
+        sys.exit(f'{args.input}: no rows')
+
+    max_gap_ms = int(args.max_gap * 1000)
+    if 'accel_stats_x_p1' in rows[0]:
+        start, accel, fixes = read_log(rows, max_gap_ms)
+    elif {'t_ms', 'x', 'y', 'z'} <= rows[0].keys():
+        start, accel, fixes = read_capture(rows, max_gap_ms)
+    else:
+        sys.exit(f'{args.input}: unknown format, expected a telemetry log or t_ms,x,y,z')
+
+    out = []
+    out.append(f'/* Generated by {os.path.basename(sys.argv[0])} from '
+               f'{os.path.basename(args.input)}, do not edit. */')
+    out.append('')
+    out.append(f'#define REPLAY_ACCEL_RATE_HZ {ACCEL_RATE_HZ}')
+    out.append(f'#define REPLAY_START_UTC_S {int(start.timestamp())}')
+    out.append(f'#define REPLAY_ACCEL_COUNT {len(accel)}')
+    out.append(f'#define REPLAY_FIX_COUNT {len(fixes)}')
+    out.append('')
+    out.append('static const struct replay_accel replay_accel[REPLAY_ACCEL_COUNT] = {')
+    for x, y, z in accel:
+        mm = [max(min(round(v * 1000), 2**15 - 1), -2**15) for v in (x, y, z)]
+        out.append(f'\t{{ {mm[0]}, {mm[1]}, {mm[2]} }},')
+    out.append('};')
+    out.append('')
+    out.append(f'static const struct replay_fix replay_fixes[MAX(REPLAY_FIX_COUNT, 1)] = {{')
+    for t, lat, lon, speed, heading in fix_rows(fixes):
+        out.append(f'\t{{ {t}, {lat}, {lon}, {speed}, {heading} }},')
+    out.append('};')
+    out.append('')
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
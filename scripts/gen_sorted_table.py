@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Generates a key-sorted C lookup table from a CSV file.
+
+The table is emitted in a struct-of-arrays layout: the keys go into one sorted
+array that is binary searched, and the payloads into a second array in the same
+order. The search then only touches the compact key array, and the payload is
+read once the key has been found.
+
+Example, for the MCC location table:
+
+    gen_sorted_table.py --input mcc_location_table.csv --output mcc_location_table.inc \\
+        --name mcc_table --key mcc:uint16_t \\
+        --fields confidence,unc_semiminor,unc_semimajor,orientation,lat:f,lon:f \\
+        --comment country
+
+which emits MCC_TABLE_SIZE, mcc_table_keys[] and mcc_table_payload[], the
+latter of type struct mcc_table. Rows with a duplicate key are dropped with a
+warning, keeping the first one.
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+KEY_TYPES = {
+    'uint8_t': (0, 2**8 - 1),
+    'uint16_t': (0, 2**16 - 1),
+    'uint32_t': (0, 2**32 - 1),
+    'int16_t': (-2**15, 2**15 - 1),
+    'int32_t': (-2**31, 2**31 - 1),
+}
+
+
+def parse_field(spec):
+    """Splits a "column[:f]" field spec, ":f" marks a float column."""
+    name, _, kind = spec.partition(':')
+    if kind not in ('', 'f'):
+        raise ValueError(f'Unknown field type "{kind}" for field "{name}"')
+    return name, kind == 'f'
+
+
+def format_value(value, is_float):
+    if is_float:
+        text = repr(float(value))
+        return text + 'f'
+    return str(int(value, 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--input', required=True, help='CSV file with a header row')
+    parser.add_argument('--output', required=True, help='Generated C include file')
+    parser.add_argument('--name', required=True,
+                        help='Table name, also the payload struct name')
+    parser.add_argument('--key', required=True, help='Key column and C type, e.g. mcc:uint16_t')
+    parser.add_argument('--fields', required=True,
+                        help='Comma separated payload columns in struct order, '
+                             'with ":f" for float columns')
+    parser.add_argument('--comment', help='Column copied into a comment on each row')
+    args = parser.parse_args()
+
+    key_column, _, key_type = args.key.partition(':')
+    if key_type not in KEY_TYPES:
+        parser.error(f'Unsupported key type "{key_type}"')
+    key_min, key_max = KEY_TYPES[key_type]
+    fields = [parse_field(spec) for spec in args.fields.split(',')]
+
+    rows = {}
+    with open(args.input, newline='') as f:
+        for line, row in enumerate(csv.DictReader(f), start=2):
+            key = int(row[key_column], 0)
+            if not key_min <= key <= key_max:
+                sys.exit(f'{args.input}:{line}: key {key} does not fit in {key_type}')
+            if key in rows:
+                print(f'{args.input}:{line}: duplicate key {key}, ignored', file=sys.stderr)
+                continue
+            rows[key] = row
+
+    keys = sorted(rows)
+    name = args.name
+    size_macro = f'{name.upper()}_SIZE'
+
+    out = []
+    out.append(f'/* Generated by {os.path.basename(sys.argv[0])} from '
+               f'{os.path.basename(args.input)}, do not edit. */')
+    out.append('')
+    out.append(f'#define {size_macro} {len(keys)}')
+    out.append('')
+    out.append(f'static const {key_type} {name}_keys[{size_macro}] = {{')
+    for i in range(0, len(keys), 12):
+        out.append('\t' + ', '.join(str(key) for key in keys[i:i + 12]) + ',')
+    out.append('};')
+    out.append('')
+    out.append(f'static const struct {name} {name}_payload[{size_macro}] = {{')
+    for key in keys:
+        row = rows[key]
+        values = ', '.join(format_value(row[column], is_float) for column, is_float in fields)
+        comment = f' /* {key}: {row[args.comment]} */' if args.comment else ''
+        out.append(f'\t{{ {values} }},{comment}')
+    out.append('};')
+    out.append('')
+
+    text = '\n'.join(out)
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,242 @@
+"""
+Decoder for the framed serial output of the device (CONFIG_STINGSENSE_OUTPUT_FRAMED).
+
+Each frame is COBS encoded and sent between zero bytes. Decoded it holds the type (1 byte), a
+sequence number (2 bytes), the payload and a CRC-16/CCITT-FALSE (2 bytes) over all that, little
+endian, see src/frame.h. A corrupt frame only loses that frame, and gaps in the sequence numbers
+show lost frames.
+
+Run as a script to pretty-print the records and log messages of a device:
+
+    python serial_frames.py COM3 [--dictionary build/zephyr/log_dictionary.json]
+"""
+
+import argparse
+import binascii
+import datetime
+import struct
+from zoneinfo import ZoneInfo
+
+FRAME_TYPE_SENSOR = 1
+FRAME_TYPE_HEALTH = 2
+FRAME_TYPE_LOG = 3
+
+# Records are stamped in UTC on the device; local time is only derived here
+LOCAL_TIMEZONE = ZoneInfo('America/New_York')
+
+# struct sensor_record in src/sensor_record.h
+SENSOR_RECORD = struct.Struct('<IiiffhhhhhhhhhhhhhHHHHBB')
+SENSOR_RECORD_COORD_SCALE = 10000000.0
+SENSOR_RECORD_ACCEL_SCALE = 256.0
+SENSOR_RECORD_ALT_SCALE = 10.0
+SENSOR_RECORD_SPEED_SCALE = 100.0
+SENSOR_RECORD_BEARING_SCALE = 100.0
+SENSOR_RECORD_FLAG_FIX_VALID = 1 << 0
+SENSOR_RECORD_FLAG_STATS_VALID = 1 << 1
+SENSOR_RECORD_FLAG_TIME_VALID = 1 << 2
+
+# struct health_record in src/health.h, in the order of enum health_thread, health_msgq and
+# health_workq
+HEALTH_THREADS = ('main', 'gnss_wq', 'assist_wq', 'sysworkq')
+HEALTH_MSGQS = ('nmea',)
+HEALTH_WORKQS = ('gnss_wq', 'assist_wq', 'sysworkq')
+
+
+def cobs_decode(data):
+    """Returns the COBS decoded frame, or None if the encoding is broken."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as crc16_itu_t(0xffff, ...) on the device."""
+    return binascii.crc_hqx(data, 0xffff)
+
+
+class FrameDecoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.next_seq = None
+        self.frames = 0
+        self.errors = 0
+        self.lost = 0
+
+    def feed(self, data):
+        """Adds bytes received from the device, returns the (type, payload) of complete frames."""
+        self.buf.extend(data)
+        frames = []
+        while True:
+            end = self.buf.find(0)
+            if end < 0:
+                break
+            encoded = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if not encoded:
+                continue
+
+            frame = cobs_decode(encoded)
+            if frame is None or len(frame) < 5 or \
+               crc16(frame[:-2]) != struct.unpack_from('<H', frame, len(frame) - 2)[0]:
+                self.errors += 1
+                continue
+
+            frame_type, seq = struct.unpack_from('<BH', frame)
+            if self.next_seq is not None and seq != self.next_seq:
+                self.lost += (seq - self.next_seq) & 0xffff
+            self.next_seq = (seq + 1) & 0xffff
+            self.frames += 1
+            frames.append((frame_type, frame[3:-2]))
+        return frames
+
+
+def decode_sensor_record(payload):
+    """Returns a sensor record in the form of the text telemetry parsed by serial_to_api.py."""
+    fields = SENSOR_RECORD.unpack(payload)
+    time_s, lat, lon, mean, variance = fields[:5]
+    pct = fields[5:17]
+    altitude, speed, bearing, since_fix, time_ms, flags, fix_quality = fields[17:]
+
+    if flags & SENSOR_RECORD_FLAG_TIME_VALID:
+        epoch = time_s + time_ms / 1000.0
+        when = datetime.datetime.fromtimestamp(epoch, tz=datetime.timezone.utc)
+    else:
+        epoch = None
+        when = datetime.datetime.now(tz=datetime.timezone.utc)
+
+    data = {
+        "timestamp": when.astimezone(LOCAL_TIMEZONE).strftime('%Y-%m-%d %H:%M:%S'),
+        "epoch": epoch,
+        "gps_fix_valid": bool(flags & SENSOR_RECORD_FLAG_FIX_VALID),
+        "latitude": 0.0,
+        "longitude": 0.0,
+        "altitude": 0.0,
+        "speed": 0.0,
+        "bearing": 0.0,
+        "seconds_since_fix": since_fix,
+        "fix_quality": fix_quality,
+    }
+    if flags & SENSOR_RECORD_FLAG_FIX_VALID:
+        data.update({
+            "latitude": lat / SENSOR_RECORD_COORD_SCALE,
+            "longitude": lon / SENSOR_RECORD_COORD_SCALE,
+            "altitude": altitude / SENSOR_RECORD_ALT_SCALE,
+            "speed": speed / SENSOR_RECORD_SPEED_SCALE,
+            "bearing": bearing / SENSOR_RECORD_BEARING_SCALE,
+        })
+    if flags & SENSOR_RECORD_FLAG_STATS_VALID:
+        data["accel_mean"] = round(mean, 3)
+        data["accel_variance"] = round(variance, 3)
+        for axis, name in enumerate('xyz'):
+            values = pct[axis * 4:axis * 4 + 4]
+            data[f"accel_stats_{name}"] = {
+                key: round(value / SENSOR_RECORD_ACCEL_SCALE, 3)
+                for key, value in zip(("p1", "p10", "p90", "p99"), values)}
+    return data
+
+
+def decode_health_record(payload):
+    """Returns a health record in the form of parse_health() in serial_to_api.py."""
+    threads = len(HEALTH_THREADS)
+    msgqs = len(HEALTH_MSGQS)
+    workqs = len(HEALTH_WORKQS)
+    fmt = f'<I{threads}H{threads}HHH{msgqs}H{msgqs}B{msgqs}BHH{workqs}I{workqs}I'
+    fields = struct.unpack(fmt, payload[:struct.calcsize(fmt)])
+    sizes = fields[1:1 + threads]
+    unused = fields[1 + threads:1 + 2 * threads]
+    heap_free, heap_max_used = fields[1 + 2 * threads:3 + 2 * threads]
+    drops = fields[3 + 2 * threads:3 + 2 * threads + msgqs]
+    peaks = fields[3 + 2 * threads + msgqs:3 + 2 * threads + 2 * msgqs]
+    queue_sizes = fields[3 + 2 * threads + 2 * msgqs:3 + 2 * threads + 3 * msgqs]
+    gnss_pvts, gnss_blocked = fields[3 + 2 * threads + 3 * msgqs:5 + 2 * threads + 3 * msgqs]
+    latency_max = fields[5 + 2 * threads + 3 * msgqs:5 + 2 * threads + 3 * msgqs + workqs]
+    latency_mean = fields[5 + 2 * threads + 3 * msgqs + workqs:]
+    return {
+        "uptime_s": fields[0],
+        "heap_free": heap_free,
+        "heap_max_used": heap_max_used,
+        "stacks": {name: {"unused": unused[i], "size": sizes[i]}
+                   for i, name in enumerate(HEALTH_THREADS) if sizes[i]},
+        "queues": {name: {"peak": peaks[i], "size": queue_sizes[i], "drops": drops[i]}
+                   for i, name in enumerate(HEALTH_MSGQS)},
+        "gnss_pvts": {"blocked": gnss_blocked, "total": gnss_pvts},
+        "workq_latency_us": {name: {"max": latency_max[i], "mean": latency_mean[i]}
+                             for i, name in enumerate(HEALTH_WORKQS)},
+    }
+
+
+def serial_records(ser, log_decoder=None, log=print):
+    """
+    Yields the sensor records read from the serial port, decoded. A health record is added to
+    the sensor record that follows it. Log messages are decoded with the dictionary log decoder
+    if there is one and passed to log line by line.
+    """
+    frames = FrameDecoder()
+    health = None
+    while True:
+        for frame_type, payload in frames.feed(ser.read(max(ser.in_waiting, 1))):
+            try:
+                if frame_type == FRAME_TYPE_SENSOR:
+                    record = decode_sensor_record(payload)
+                    if health is not None:
+                        record["health"] = health
+                        health = None
+                    yield record
+                elif frame_type == FRAME_TYPE_HEALTH:
+                    health = decode_health_record(payload)
+                elif frame_type == FRAME_TYPE_LOG and log_decoder is not None:
+                    for line in log_decoder.feed(payload):
+                        log(line)
+            except struct.error:
+                # Layout of a different firmware version
+                frames.errors += 1
+
+
+def print_record(record):
+    """Prints a sensor record the way the text telemetry shows it."""
+    print("-" * 79)
+    print(f"Timestamp: {record['timestamp']}")
+    if record["gps_fix_valid"]:
+        print(f"GPS: Lat: {record['latitude']:.7f}, Lon: {record['longitude']:.7f}, "
+              f"Alt: {record['altitude']:.1f}")
+        print(f"Speed: {record['speed']:.2f} m/s, Bearing: {record['bearing']:.1f}°")
+    else:
+        print(f"GPS: Searching (No fix for {record['seconds_since_fix']} seconds)")
+    if "health" in record:
+        print(f"Health: {record['health']}")
+    if "accel_mean" in record:
+        print(f"  Mean (Magnitude): {record['accel_mean']:.3f} (m/s²)")
+        print(f"  Variance (Magnitude): {record['accel_variance']:.3f} (m/s²)²")
+        for axis in 'xyz':
+            pct = record[f"accel_stats_{axis}"]
+            print(f"    {axis.upper()}-Axis: p1={pct['p1']:.3f}, p10={pct['p10']:.3f}, "
+                  f"p90={pct['p90']:.3f}, p99={pct['p99']:.3f} (m/s²)")
+
+
+if __name__ == '__main__':
+    import serial
+
+    parser = argparse.ArgumentParser(description="Pretty-prints the framed serial output of the device.")
+    parser.add_argument('port', help='Serial port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--dictionary', metavar='LOG_DICTIONARY_JSON',
+                        help='Decode the log messages with this database (build/zephyr/log_dictionary.json)')
+    parser.add_argument('--zephyr-base', help='Zephyr tree with the dictionary log parser (default: $ZEPHYR_BASE)')
+    args = parser.parse_args()
+
+    log_decoder = None
+    if args.dictionary:
+        from dictionary_log import DictionaryLogDecoder
+        log_decoder = DictionaryLogDecoder(args.dictionary, args.zephyr_base)
+
+    with serial.Serial(args.port, args.baud, timeout=1) as ser:
+        for record in serial_records(ser, log_decoder):
+            print_record(record)
@@ -6,11 +6,15 @@ from flask import Flask, jsonify
 from flask_cors import CORS
 import boto3 # For AWS S3
 import json # For S3 data
-import datetime # For S3 filenames
+import datetime
+from zoneinfo import ZoneInfo # For S3 filenames
 from botocore.exceptions import NoCredentialsError, PartialCredentialsError # For AWS errors
 
 import argparse
 
+from dictionary_log import DictionaryLogDecoder, serial_lines
+from serial_frames import serial_records
+
 # --- Configuration ---
 SERIAL_PORT = 'COM3'  # Adjust to your serial port
 BAUD_RATE = 115200    # Match the baud rate of your Icarus device
@@ -27,10 +31,14 @@ s3_client = boto3.client('s3', region_name=AWS_S3_REGION)
 
 S3_BUS_TYPE_PREFIX = "default_bus_type"
 
+# Records are stamped in UTC on the device; local time is only derived here
+LOCAL_TIMEZONE = ZoneInfo('America/New_York')
+
 # --- Globals to store the latest sensor data ---
 # "raw_lines" is removed from here, so it won't be part of the local API response
 latest_data = {
     "timestamp": None,
+    "epoch": None,
     "gps_fix_valid": False,
     "latitude": None,
     "longitude": None,
@@ -38,6 +46,7 @@ latest_data = {
     "speed": None,
     "bearing": None,
     "seconds_since_fix": None,
+    "fix_quality": None,
     "accel_mean": None,
     "accel_variance": None,
     "accel_stats_x": {},
@@ -104,6 +113,19 @@ def send_to_external_storage(data_to_send):
         print(f"AWS S3 Error: Failed to upload data to S3: {e}")
 
 
+# --- Dictionary Log Decoding ---
+# Set with --dictionary when the firmware is built with binary dictionary logging
+LOG_DICTIONARY = None
+ZEPHYR_BASE = None
+# Set with --framed when the firmware is built with CONFIG_STINGSENSE_OUTPUT_FRAMED
+FRAMED = False
+
+def make_log_decoder():
+    """Returns a decoder for the binary log stream, or None if the device logs text."""
+    if LOG_DICTIONARY is None:
+        return None
+    return DictionaryLogDecoder(LOG_DICTIONARY, ZEPHYR_BASE)
+
 # --- Serial Data Reader and Parser Thread ---
 def read_serial_data():
     global latest_data
@@ -113,10 +135,19 @@ def read_serial_data():
             print(f"Attempting to connect to serial port {SERIAL_PORT} at {BAUD_RATE} bps...")
             with serial.Serial(SERIAL_PORT, BAUD_RATE, timeout=1) as ser:
                 print(f"Connected to {SERIAL_PORT}. Reading data...")
+                if FRAMED:
+                    # Binary records, a corrupt frame only loses itself
+                    for parsed_block in serial_records(ser, make_log_decoder()):
+                        with data_lock:
+                            latest_data.update(parsed_block)
+                        send_to_external_storage(parsed_block.copy())
+                    continue
+
                 current_block_lines = []
+                lines = serial_lines(ser, make_log_decoder())
                 while True:
                     try:
-                        line = ser.readline().decode('utf-8', errors='ignore').strip()
+                        line = next(lines)
                     except serial.SerialException as e:
                         print(f"Serial error: {e}. Reconnecting...")
                         break # Break inner loop to reconnect
@@ -153,6 +184,26 @@ def read_serial_data():
             print(f"An unexpected error occurred in serial thread: {e}")
             time.sleep(5)
 
+def parse_timestamp(line):
+    """
+    Converts a device timestamp line ("Timestamp: <unix seconds>.<ms> UTC") to local time.
+    Before the device has GNSS or network time the line reads "uptime" instead of "UTC",
+    in which case the host receive time is used.
+    """
+    match = re.search(r"Timestamp: (\d+)\.(\d{3}) (UTC|uptime)", line)
+    if not match:
+        return None
+    if match.group(3) == "UTC":
+        epoch = int(match.group(1)) + int(match.group(2)) / 1000.0
+        when = datetime.datetime.fromtimestamp(epoch, tz=datetime.timezone.utc)
+    else:
+        epoch = None
+        when = datetime.datetime.now(tz=datetime.timezone.utc)
+    return {
+        "timestamp": when.astimezone(LOCAL_TIMEZONE).strftime('%Y-%m-%d %H:%M:%S'),
+        "epoch": epoch,
+    }
+
 def parse_percentiles(line):
     match = re.search(r"p1=([\d.-]+), p10=([\d.-]+), p90=([\d.-]+), p99=([\d.-]+)", line)
     if match:
@@ -164,16 +215,46 @@ def parse_percentiles(line):
         }
     return {}
 
+def parse_health(line, health):
+    """
+    Adds a line of the periodic health record to the health dictionary. The record spans a
+    "Health (uptime N s): ..." line followed by indented stack, queue, GNSS, work queue and
+    profile lines.
+    """
+    match = re.search(r"Health \(uptime (\d+) s\): heap free (\d+), max used (\d+) of (\d+) bytes", line)
+    if match:
+        health.update({
+            "uptime_s": int(match.group(1)),
+            "heap_free": int(match.group(2)),
+            "heap_max_used": int(match.group(3)),
+            "heap_size": int(match.group(4)),
+        })
+    elif "Stack unused/size" in line:
+        health["stacks"] = {name: {"unused": int(unused), "size": int(size)}
+                            for name, unused, size in re.findall(r"(\w+)=(\d+)/(\d+)", line)}
+    elif "Queue peak/size/drops" in line:
+        health["queues"] = {name: {"peak": int(peak), "size": int(size), "drops": int(drops)}
+                            for name, peak, size, drops in re.findall(r"(\w+)=(\d+)/(\d+)/(\d+)", line)}
+    elif "GNSS PVT blocked/total" in line:
+        match = re.search(r"(\d+)/(\d+)", line)
+        if match:
+            health["gnss_pvts"] = {"blocked": int(match.group(1)), "total": int(match.group(2))}
+    elif "Work queue latency" in line:
+        health["workq_latency_us"] = {name: {"max": int(max_us), "mean": int(mean_us)}
+                                      for name, max_us, mean_us in re.findall(r"(\w+)=(\d+)/(\d+)", line)}
+    elif "Profile p99" in line:
+        health["profile_p99_us"] = {name: int(us) for name, us in re.findall(r"(\w+)=(\d+)", line)}
+
 def parse_sensor_block(block_lines):
     # This function now returns a dictionary that ONLY contains the parsed sensor values.
     # It does NOT include 'raw_lines'.
     data = {}
     try:
         for line in block_lines:
-            if "Date/Time:" in line:
-                match = re.search(r"(\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2})", line)
-                if match:
-                    data["timestamp"] = match.group(1)
+            if "Timestamp:" in line:
+                stamp = parse_timestamp(line)
+                if stamp:
+                    data.update(stamp)
             elif "GPS: Lat:" in line:
                 match = re.search(r"Lat: ([\d.-]+), Lon: ([\d.-]+), Alt: ([\d.-]+)", line)
                 if match:
@@ -186,6 +267,10 @@ def parse_sensor_block(block_lines):
                 if match:
                     data["speed"] = float(match.group(1))
                     data["bearing"] = float(match.group(2))
+            elif "Fix quality:" in line:
+                match = re.search(r"Fix quality: (\d+)/100", line)
+                if match:
+                    data["fix_quality"] = int(match.group(1))
             elif "GPS: Searching" in line:
                 data["gps_fix_valid"] = False
                 match = re.search(r"No fix for (\d+) seconds", line)
@@ -205,6 +290,9 @@ def parse_sensor_block(block_lines):
                 data["accel_stats_y"] = parse_percentiles(line)
             elif "Z-Axis:" in line:
                 data["accel_stats_z"] = parse_percentiles(line)
+            elif "Health (uptime" in line or line.startswith(("Stack unused", "Queue peak", "GNSS PVT", "Work queue", "Profile p99")):
+                # Health record, in one block every CONFIG_STINGSENSE_HEALTH_INTERVAL seconds
+                parse_health(line, data.setdefault("health", {}))
         
         if not data.get("gps_fix_valid", False):
             data.setdefault("latitude", 0.0)
@@ -224,10 +312,19 @@ def parse_sensor_block(block_lines):
 if __name__ == '__main__':
     parser = argparse.ArgumentParser(description="Serial to API bridge with S3 upload. Takes bus_type as an argument.")
     parser.add_argument('bus_type', type=str, help='Identifier for the bus type/trip (e.g., "gold", "blue"). This will be used in the S3 path.')
+    parser.add_argument('--dictionary', metavar='LOG_DICTIONARY_JSON',
+                        help='Decode binary dictionary logging with this database (build/zephyr/log_dictionary.json)')
+    parser.add_argument('--zephyr-base', help='Zephyr tree with the dictionary log parser (default: $ZEPHYR_BASE)')
+    parser.add_argument('--framed', action='store_true',
+                        help='Read framed binary records (CONFIG_STINGSENSE_OUTPUT_FRAMED) instead of the text screen')
     args = parser.parse_args()
 
     # Set the global S3_BUS_TYPE_PREFIX from the command line argument
     S3_BUS_TYPE_PREFIX = args.bus_type
+    LOG_DICTIONARY = args.dictionary
+    ZEPHYR_BASE = args.zephyr_base
+    FRAMED = args.framed
+    make_log_decoder()  # Fail early on a missing or mismatched database
 
     print("Starting sensor data to API bridge with S3 upload.")
     print(f"Configured for bus type: {S3_BUS_TYPE_PREFIX}")
@@ -40,4 +40,10 @@ void get_accelerometer_data(double *x_accel, double *y_accel, double *z_accel)
 	struct sensor_value value_z;
 	sensor_channel_get(accel, SENSOR_CHAN_ACCEL_Z, &value_z);
 	*z_accel = sensor_value_to_double(&value_z);
-}
\ No newline at end of file
+}
+
+void get_accelerometer_sample(struct accel_sample *sample)
+{
+	get_accelerometer_data(&sample->x, &sample->y, &sample->z);
+	sample->ticks = k_uptime_ticks();
+}
@@ -9,7 +9,15 @@
 
 #include <zephyr/kernel.h>
 
+struct accel_sample {
+	double x;
+	double y;
+	double z;
+	int64_t ticks; /* Uptime in ticks when the sample was fetched */
+};
+
 bool init_accelerometer(void);
 void get_accelerometer_data(double *x_accel, double *y_accel, double *z_accel);
+void get_accelerometer_sample(struct accel_sample *sample);
 
 #endif // _ACCELEROMETER_H_
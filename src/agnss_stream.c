@@ -0,0 +1,274 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <net/nrf_cloud_agnss.h>
+
+#include "agnss_stream.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* nRF Cloud A-GNSS binary schema version 1: the schema version, then runs of elements of one
+ * type, each run starting with the type and the little-endian element count.
+ */
+#define SCHEMA_VERSION		1
+#define HEADER_SIZE		3
+
+#define TYPE_GPS_TOWS		6
+#define TYPE_GPS_SYSTEM_CLOCK	7
+
+/* Packed element sizes by type, 0 for the types not in the schema. */
+static const uint8_t element_sizes[] = {
+	[1] = 14,	/* UTC parameters */
+	[2] = 62,	/* GPS ephemeris */
+	[3] = 31,	/* GPS almanac */
+	[4] = 8,	/* Klobuchar ionospheric correction */
+	[5] = 8,	/* NeQuick ionospheric correction */
+	[6] = 3,	/* GPS TOW, one per satellite */
+	[7] = 12,	/* GPS system clock, without the TOWs */
+	[8] = 15,	/* Location */
+	[9] = 4,	/* GPS integrity */
+	[11] = 62,	/* QZSS ephemeris */
+	[12] = 31,	/* QZSS almanac */
+	[13] = 4,	/* QZSS integrity */
+};
+
+/* Schema version and elements, in the format nrf_cloud_agnss_process() takes. */
+struct chunk {
+	char buf[128];
+	size_t len;
+};
+
+/* One element at a time, as a run of one. */
+static struct chunk element_chunk;
+/* The TOW and system clock runs as received, they are combined into one injection. */
+static struct chunk time_chunk;
+static bool time_tows;
+static bool time_clock;
+
+static bool schema_read;
+static uint8_t header[HEADER_SIZE];
+static size_t header_len;
+static uint8_t type;
+static size_t element_size;
+static uint16_t elements_left;
+static size_t element_len;
+
+static uint32_t elements;
+static uint32_t injections;
+static size_t bytes;
+/* Bytes up to the end of the last complete header or element. */
+static size_t complete;
+static int64_t start_ms;
+static int64_t first_ms;
+
+static void chunk_reset(struct chunk *chunk)
+{
+	chunk->buf[0] = SCHEMA_VERSION;
+	chunk->len = 1;
+}
+
+static void chunk_append(struct chunk *chunk, const void *data, size_t len)
+{
+	memcpy(&chunk->buf[chunk->len], data, len);
+	chunk->len += len;
+}
+
+static int chunk_flush(struct chunk *chunk)
+{
+	int err;
+
+	if (chunk->len <= 1) {
+		return 0;
+	}
+
+	err = nrf_cloud_agnss_process(chunk->buf, chunk->len);
+	if (err) {
+		LOG_ERR("Failed to process A-GNSS element, type: %u, error: %d", type, err);
+	} else if (injections++ == 0) {
+		first_ms = k_uptime_get();
+	}
+	chunk_reset(chunk);
+
+	return err;
+}
+
+static int time_flush(void)
+{
+	time_tows = false;
+	time_clock = false;
+
+	return chunk_flush(&time_chunk);
+}
+
+/* Called when the header of a run has been received. */
+static int run_start(void)
+{
+	uint16_t count = header[1] | (header[2] << 8);
+
+	type = header[0];
+	element_size = (type < ARRAY_SIZE(element_sizes)) ? element_sizes[type] : 0;
+	if (element_size == 0) {
+		LOG_ERR("Unsupported A-GNSS element type: %u", type);
+		return -EBADMSG;
+	}
+
+	if (type == TYPE_GPS_TOWS || type == TYPE_GPS_SYSTEM_CLOCK) {
+		/* The run is kept as is, the TOWs are matched to satellites by their order. */
+		if (time_chunk.len + HEADER_SIZE + count * element_size > sizeof(time_chunk.buf)) {
+			LOG_ERR("Too many A-GNSS elements, type: %u, count: %u", type, count);
+			return -EBADMSG;
+		}
+		chunk_append(&time_chunk, header, HEADER_SIZE);
+	}
+
+	elements_left = count;
+	element_len = 0;
+
+	return 0;
+}
+
+/* Called when an element has been received. */
+static int element_end(void)
+{
+	elements++;
+	element_len = 0;
+	elements_left--;
+
+	if (type == TYPE_GPS_TOWS || type == TYPE_GPS_SYSTEM_CLOCK) {
+		if (elements_left > 0) {
+			return 0;
+		}
+		if (type == TYPE_GPS_TOWS) {
+			time_tows = true;
+		} else {
+			time_clock = true;
+		}
+
+		return (time_tows && time_clock) ? time_flush() : 0;
+	}
+
+	return chunk_flush(&element_chunk);
+}
+
+void agnss_stream_start(void)
+{
+	chunk_reset(&element_chunk);
+	chunk_reset(&time_chunk);
+	time_tows = false;
+	time_clock = false;
+	schema_read = false;
+	header_len = 0;
+	elements_left = 0;
+	element_len = 0;
+	elements = 0;
+	injections = 0;
+	bytes = 0;
+	complete = 0;
+	start_ms = k_uptime_get();
+	first_ms = start_ms;
+}
+
+size_t agnss_stream_resume(void)
+{
+	if (element_len > 0) {
+		if (type == TYPE_GPS_TOWS || type == TYPE_GPS_SYSTEM_CLOCK) {
+			time_chunk.len -= element_len;
+		} else {
+			chunk_reset(&element_chunk);
+		}
+		element_len = 0;
+	}
+	header_len = 0;
+	bytes = complete;
+
+	return complete;
+}
+
+int agnss_stream_write(const char *data, size_t len)
+{
+	int err;
+
+	while (len > 0) {
+		size_t n;
+
+		if (!schema_read) {
+			if (data[0] != SCHEMA_VERSION) {
+				LOG_ERR("Unsupported A-GNSS schema version: %u", (uint8_t)data[0]);
+				return -EBADMSG;
+			}
+			schema_read = true;
+			data++;
+			len--;
+			bytes++;
+			complete = bytes;
+			continue;
+		}
+
+		if (elements_left == 0) {
+			n = MIN(HEADER_SIZE - header_len, len);
+			memcpy(&header[header_len], data, n);
+			header_len += n;
+			data += n;
+			len -= n;
+			bytes += n;
+
+			if (header_len == HEADER_SIZE) {
+				header_len = 0;
+				err = run_start();
+				if (err) {
+					return err;
+				}
+				complete = bytes;
+			}
+			continue;
+		}
+
+		struct chunk *chunk = &time_chunk;
+
+		if (type != TYPE_GPS_TOWS && type != TYPE_GPS_SYSTEM_CLOCK) {
+			chunk = &element_chunk;
+			if (element_len == 0) {
+				const uint8_t run_of_one[HEADER_SIZE] = { type, 1, 0 };
+
+				chunk_append(chunk, run_of_one, HEADER_SIZE);
+			}
+		}
+
+		n = MIN(element_size - element_len, len);
+		chunk_append(chunk, data, n);
+		element_len += n;
+		data += n;
+		len -= n;
+		bytes += n;
+
+		if (element_len == element_size) {
+			/* Also when the injection fails, the element is not sent twice. */
+			err = element_end();
+			complete = bytes;
+			if (err) {
+				return err;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int agnss_stream_end(void)
+{
+	int err;
+
+	if (!schema_read || header_len > 0 || elements_left > 0) {
+		LOG_ERR("A-GNSS response truncated after %zu bytes", bytes);
+		return -EBADMSG;
+	}
+
+	err = time_flush();
+
+	LOG_INF("A-GNSS: %u elements in %u injections from %zu bytes, first after %u ms of %u ms",
+		elements, injections, bytes, (uint32_t)(first_ms - start_ms),
+		(uint32_t)(k_uptime_get() - start_ms));
+
+	return err;
+}
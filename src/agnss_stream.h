@@ -0,0 +1,53 @@
+#ifndef AGNSS_STREAM_H_
+#define AGNSS_STREAM_H_
+
+#include <stddef.h>
+
+/**
+ * Streaming A-GNSS response processing.
+ *
+ * The nRF Cloud A-GNSS response is written in fragments as they are received. Each element is
+ * passed to nrf_cloud_agnss_process() as soon as it is complete, so that only one element is
+ * buffered instead of the whole response, and the first elements reach GNSS before the rest of
+ * the response has been received. The GPS system clock and TOW elements are injected together,
+ * once both have been received.
+ */
+
+/**
+ * @brief Starts processing a new response.
+ */
+void agnss_stream_start(void);
+
+/**
+ * @brief Prepares to continue the response after a failed request.
+ *
+ * @details Drops a partly received header or element. The elements received before it have
+ *          been injected already, the response is requested again from the returned offset so
+ *          that they are not injected twice. Returns 0 right after agnss_stream_start().
+ *
+ * @return Offset in the response of the first byte not processed.
+ */
+size_t agnss_stream_resume(void);
+
+/**
+ * @brief Processes the next fragment of the response.
+ *
+ * @param[in] data Fragment.
+ * @param[in] len  Fragment length, may split elements anywhere.
+ *
+ * @retval 0 on success.
+ * @retval -EBADMSG if the response is not in the supported schema.
+ * @retval -errno if an element could not be injected.
+ */
+int agnss_stream_write(const char *data, size_t len);
+
+/**
+ * @brief Ends the response, injects the elements still buffered.
+ *
+ * @retval 0 on success.
+ * @retval -EBADMSG if the response ended in the middle of an element.
+ * @retval -errno if an element could not be injected.
+ */
+int agnss_stream_end(void);
+
+#endif /* AGNSS_STREAM_H_ */
@@ -4,12 +4,14 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  */
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <modem/modem_info.h>
 #include <modem/modem_jwt.h>
 #include <net/nrf_cloud_rest.h>
+#include <net/rest_client.h>
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
 #include <net/nrf_cloud_agnss.h>
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
@@ -17,15 +19,28 @@
 #include <net/nrf_cloud_pgps.h>
 #endif /* CONFIG_NRF_CLOUD_PGPS */
 
+#include "agnss_stream.h"
 #include "assistance.h"
+#include "modem_cache.h"
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+#include "pgps_sched.h"
+#endif
+#include "profile.h"
+#include "rest_session.h"
 
 LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
-static char jwt_buf[600];
-static char rx_buf[2048];
-
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
-static char agnss_data_buf[3500];
+#define AGNSS_PATH		"/v1/location/agnss"
+#define HTTPS_PORT		443
+#define HTTP_OK			200
+#define HTTP_PARTIAL_CONTENT	206
+#define HTTP_RANGE_NOT_SATISFIABLE 416
+
+#define AGNSS_FRAGMENT_SIZE	CONFIG_GNSS_SAMPLE_NRF_CLOUD_FRAGMENT_SIZE
+
+/* Request body, the requested element types and the serving cell. */
+static char agnss_body[192];
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
 
 #if defined(CONFIG_NRF_CLOUD_PGPS)
@@ -34,110 +49,67 @@ static struct gps_pgps_request pgps_request;
 static struct nrf_cloud_pgps_prediction *prediction;
 static struct k_work get_pgps_data_work;
 static struct k_work inject_pgps_data_work;
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+static struct k_work prefetch_pgps_data_work;
+#endif
 #endif /* CONFIG_NRF_CLOUD_PGPS */
 
 static struct k_work_q *work_q;
-static volatile bool assistance_active;
-
-#if defined(CONFIG_NRF_CLOUD_AGNSS)
-static int serving_cell_info_get(struct lte_lc_cell *serving_cell)
-{
-	int err;
-
-	err = modem_info_init();
-	if (err) {
-		return err;
-	}
 
-	char resp_buf[MODEM_INFO_MAX_RESPONSE_SIZE];
-
-	err = modem_info_string_get(MODEM_INFO_CELLID,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
-
-	serving_cell->id = strtol(resp_buf, NULL, 16);
-
-	err = modem_info_string_get(MODEM_INFO_AREA_CODE,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
-
-	serving_cell->tac = strtol(resp_buf, NULL, 16);
+#if defined(CONFIG_NRF_CLOUD_PGPS)
+struct pgps_rest_response {
+	char *data;
+	size_t len;
+};
 
-	/* Request for MODEM_INFO_MNC returns both MNC and MCC in the same string. */
-	err = modem_info_string_get(MODEM_INFO_OPERATOR,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
+static int pgps_rest_get(struct nrf_cloud_rest_context *rest_ctx, void *arg)
+{
+	struct pgps_rest_response *response = arg;
+	struct nrf_cloud_rest_pgps_request request = {
+		.pgps_req = &pgps_request
+	};
+	int err = nrf_cloud_rest_pgps_data_get(rest_ctx, &request);
 
-	serving_cell->mnc = strtol(&resp_buf[3], NULL, 10);
-	/* Null-terminate MCC, read and store it. */
-	resp_buf[3] = '\0';
-	serving_cell->mcc = strtol(resp_buf, NULL, 10);
+	response->data = rest_ctx->response;
+	response->len = rest_ctx->response_len;
 
-	return 0;
+	return err;
 }
-#endif /* CONFIG_NRF_CLOUD_AGNSS */
 
-#if defined(CONFIG_NRF_CLOUD_PGPS)
 static void get_pgps_data_work_fn(struct k_work *work)
 {
 	ARG_UNUSED(work);
 
 	int err;
 
-	assistance_active = true;
+	PROFILE_START(PROFILE_PGPS_WORK);
 
 	LOG_INF("Sending request for P-GPS predictions to nRF Cloud...");
 
-	err = nrf_cloud_jwt_generate(0, jwt_buf, sizeof(jwt_buf));
-	if (err) {
-		LOG_ERR("Failed to generate JWT, error: %d", err);
-
-		goto exit;
-	}
-
-	struct nrf_cloud_rest_context rest_ctx = {
-		.connect_socket = -1,
-		.keep_alive = false,
-		.timeout_ms = NRF_CLOUD_REST_TIMEOUT_NONE,
-		.auth = jwt_buf,
-		.rx_buf = rx_buf,
-		.rx_buf_len = sizeof(rx_buf),
-		.fragment_size = 0, /* Defaults to CONFIG_NRF_CLOUD_REST_FRAGMENT_SIZE when 0 */
-		.status = 0,
-		.response = NULL,
-		.response_len = 0,
-		.total_response_len = 0
-	};
-
-	struct nrf_cloud_rest_pgps_request request = {
-		.pgps_req = &pgps_request
-	};
+	struct pgps_rest_response response = { 0 };
 
-	err = nrf_cloud_rest_pgps_data_get(&rest_ctx, &request);
+	err = rest_session_request("P-GPS", pgps_rest_get, &response);
 	if (err) {
 		LOG_ERR("Failed to send P-GPS request, error: %d", err);
 
 		nrf_cloud_pgps_request_reset();
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+		pgps_sched_fetch_done(false);
+#endif
 
 		goto exit;
 	}
 
 	LOG_INF("Processing P-GPS response");
 
-	err = nrf_cloud_pgps_process(rest_ctx.response, rest_ctx.response_len);
+	err = nrf_cloud_pgps_process(response.data, response.len);
 	if (err) {
 		LOG_ERR("Failed to process P-GPS response, error: %d", err);
 
 		nrf_cloud_pgps_request_reset();
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+		pgps_sched_fetch_done(false);
+#endif
 
 		goto exit;
 	}
@@ -145,7 +117,7 @@ static void get_pgps_data_work_fn(struct k_work *work)
 	LOG_INF("P-GPS response processed");
 
 exit:
-	assistance_active = false;
+	PROFILE_END(PROFILE_PGPS_WORK);
 }
 
 static void inject_pgps_data_work_fn(struct k_work *work)
@@ -154,7 +126,7 @@ static void inject_pgps_data_work_fn(struct k_work *work)
 
 	int err;
 
-	assistance_active = true;
+	PROFILE_START(PROFILE_PGPS_WORK);
 
 	LOG_INF("Injecting P-GPS ephemerides");
 
@@ -163,14 +135,37 @@ static void inject_pgps_data_work_fn(struct k_work *work)
 		LOG_ERR("Failed to inject P-GPS ephemerides");
 	}
 
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+	/* The expired predictions are replaced when the scheduler finds a good window. */
+	pgps_sched_check();
+#else
 	err = nrf_cloud_pgps_preemptive_updates();
 	if (err) {
 		LOG_ERR("Failed to request P-GPS updates");
 	}
+#endif
+
+	PROFILE_END(PROFILE_PGPS_WORK);
+}
+
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+static void prefetch_pgps_data_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
 
-	assistance_active = false;
+	/* Requests the expired predictions, the request comes back as PGPS_EVT_REQUEST. */
+	if (nrf_cloud_pgps_preemptive_updates() != 0) {
+		LOG_ERR("Failed to request P-GPS updates");
+	}
 }
 
+static void pgps_fetch(bool request_pending)
+{
+	k_work_submit_to_queue(work_q, request_pending ? &get_pgps_data_work :
+							 &prefetch_pgps_data_work);
+}
+#endif /* CONFIG_STINGSENSE_PGPS_PREFETCH */
+
 static void pgps_event_handler(struct nrf_cloud_pgps_event *event)
 {
 	switch (event->type) {
@@ -183,17 +178,24 @@ static void pgps_event_handler(struct nrf_cloud_pgps_event *event)
 	case PGPS_EVT_REQUEST:
 		memcpy(&pgps_request, event->request, sizeof(pgps_request));
 
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+		if (pgps_sched_request()) {
+			/* Sent from pgps_fetch() in a good window. */
+			break;
+		}
+#endif
 		k_work_submit_to_queue(work_q, &get_pgps_data_work);
 		break;
 
 	case PGPS_EVT_LOADING:
 		LOG_INF("Loading P-GPS predictions");
-		assistance_active = true;
 		break;
 
 	case PGPS_EVT_READY:
 		LOG_INF("P-GPS predictions ready");
-		assistance_active = false;
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+		pgps_sched_fetch_done(true);
+#endif
 		break;
 
 	default:
@@ -204,6 +206,124 @@ static void pgps_event_handler(struct nrf_cloud_pgps_event *event)
 #endif /* CONFIG_NRF_CLOUD_PGPS */
 
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
+/* Appends to the request body, the length keeps counting when the body does not fit. */
+static size_t body_append(size_t len, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	len += vsnprintf(&agnss_body[MIN(len, sizeof(agnss_body))],
+			 sizeof(agnss_body) - MIN(len, sizeof(agnss_body)), fmt, args);
+	va_end(args);
+
+	return len;
+}
+
+/* Writes the JSON body of a custom A-GNSS request, as nrf_cloud_rest_agnss_data_get() does. */
+static int agnss_body_build(const struct nrf_cloud_rest_agnss_request *request)
+{
+	enum nrf_cloud_agnss_type types[16];
+	int count = nrf_cloud_agnss_type_array_get(request->agnss_req, types, ARRAY_SIZE(types));
+	size_t len = 0;
+
+	if (count <= 0) {
+		return -EINVAL;
+	}
+
+	len = body_append(len, "{\"requestType\":\"custom\",\"types\":[");
+	for (int i = 0; i < count; i++) {
+		len = body_append(len, "%s%d", i ? "," : "", types[i]);
+	}
+	len = body_append(len, "]");
+
+	if (request->net_info != NULL) {
+		const struct lte_lc_cell *cell = &request->net_info->current_cell;
+
+		len = body_append(len, ",\"mcc\":%d,\"mnc\":%d,\"tac\":%u,\"eci\":%u",
+				  cell->mcc, cell->mnc, cell->tac, cell->id);
+	}
+	if (request->filtered) {
+		len = body_append(len, ",\"filtered\":true,\"mask\":%u", request->mask_angle);
+	}
+	len = body_append(len, "}");
+
+	return (len < sizeof(agnss_body)) ? 0 : -ENOMEM;
+}
+
+/* Gets the A-GNSS data in ranges of AGNSS_FRAGMENT_SIZE on the session connection, and hands
+ * each range to the stream as it arrives, so that the response is never buffered whole. When
+ * the session sends the request again, it continues after the last complete element.
+ */
+static int agnss_rest_stream(struct nrf_cloud_rest_context *rest_ctx, void *arg)
+{
+	ARG_UNUSED(arg);
+
+	char range[40];
+	/* http_client sends the header fields one after the other, so the JWT is sent as is. */
+	const char *headers[] = {
+		"Content-Type: application/json\r\n",
+		"Authorization: Bearer ", rest_ctx->auth, "\r\n",
+		range,
+		NULL
+	};
+	struct rest_client_req_context req;
+	struct rest_client_resp_context resp;
+	size_t offset = agnss_stream_resume();
+	int err;
+
+	if (offset > 0) {
+		LOG_INF("Resuming A-GNSS response at byte %zu", offset);
+	}
+
+	do {
+		snprintf(range, sizeof(range), "Range: bytes=%zu-%zu\r\n", offset,
+			 offset + AGNSS_FRAGMENT_SIZE - 1);
+
+		rest_client_request_defaults_set(&req);
+		req.connect_socket = rest_ctx->connect_socket;
+		req.keep_alive = true;
+		req.sec_tag = CONFIG_NRF_CLOUD_SEC_TAG;
+		req.http_method = HTTP_POST;
+		req.url = AGNSS_PATH;
+		req.host = CONFIG_NRF_CLOUD_REST_HOST_NAME;
+		req.port = HTTPS_PORT;
+		req.header_fields = headers;
+		req.body = agnss_body;
+		req.timeout_ms = rest_ctx->timeout_ms;
+		req.resp_buff = rest_ctx->rx_buf;
+		req.resp_buff_len = rest_ctx->rx_buf_len;
+
+		memset(&resp, 0, sizeof(resp));
+		err = rest_client_request(&req, &resp);
+		rest_ctx->connect_socket = resp.used_socket_is_alive ? resp.used_socket_id : -1;
+		rest_ctx->status = resp.http_status_code;
+		if (err) {
+			return err;
+		}
+
+		if (resp.http_status_code == HTTP_RANGE_NOT_SATISFIABLE && offset > 0) {
+			/* The previous range ended exactly at the end of the data. */
+			break;
+		}
+		if (resp.http_status_code != HTTP_OK &&
+		    resp.http_status_code != HTTP_PARTIAL_CONTENT) {
+			LOG_ERR("A-GNSS request failed, HTTP status: %d", resp.http_status_code);
+			return -EBADMSG;
+		}
+
+		err = agnss_stream_write(resp.response, resp.response_len);
+		if (err) {
+			return err;
+		}
+
+		offset += resp.response_len;
+		rest_ctx->total_response_len = offset;
+	} while (resp.http_status_code == HTTP_PARTIAL_CONTENT &&
+		 resp.response_len == AGNSS_FRAGMENT_SIZE);
+
+	return agnss_stream_end();
+}
+
 static const char *get_system_string(uint8_t system_id)
 {
 	switch (system_id) {
@@ -225,10 +345,15 @@ static const char *get_system_string(uint8_t system_id)
 int assistance_init(struct k_work_q *assistance_work_q)
 {
 	work_q = assistance_work_q;
+	rest_session_init(assistance_work_q);
 
 #if defined(CONFIG_NRF_CLOUD_PGPS)
 	k_work_init(&get_pgps_data_work, get_pgps_data_work_fn);
 	k_work_init(&inject_pgps_data_work, inject_pgps_data_work_fn);
+#if defined(CONFIG_STINGSENSE_PGPS_PREFETCH)
+	k_work_init(&prefetch_pgps_data_work, prefetch_pgps_data_work_fn);
+	(void)pgps_sched_init(pgps_fetch);
+#endif
 
 	struct nrf_cloud_pgps_init_param pgps_param = {
 		.event_handler = pgps_event_handler,
@@ -268,57 +393,26 @@ int assistance_request(struct nrf_modem_gnss_agnss_data_frame *agnss_request)
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
 #endif /* CONFIG_NRF_CLOUD_PGPS */
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
-	assistance_active = true;
-
-	err = nrf_cloud_jwt_generate(0, jwt_buf, sizeof(jwt_buf));
-	if (err) {
-		LOG_ERR("Failed to generate JWT, error: %d", err);
-		goto agnss_exit;
-	}
-
-	struct nrf_cloud_rest_context rest_ctx = {
-		.connect_socket = -1,
-		.keep_alive = false,
-		.timeout_ms = NRF_CLOUD_REST_TIMEOUT_NONE,
-		.auth = jwt_buf,
-		.rx_buf = rx_buf,
-		.rx_buf_len = sizeof(rx_buf),
-		.fragment_size = 0, /* Defaults to CONFIG_NRF_CLOUD_REST_FRAGMENT_SIZE when 0 */
-		.status = 0,
-		.response = NULL,
-		.response_len = 0,
-		.total_response_len = 0
-	};
-
 	struct nrf_cloud_rest_agnss_request request = {
 		.type = NRF_CLOUD_REST_AGNSS_REQ_CUSTOM,
 		.agnss_req = agnss_request,
 		.net_info = NULL,
-#if defined(CONFIG_NRF_CLOUD_AGNSS_FILTERED_RUNTIME)
+#if defined(CONFIG_NRF_CLOUD_AGNSS_FILTERED_RUNTIME) || defined(CONFIG_NRF_CLOUD_AGNSS_FILTERED)
 		.filtered = true,
 		/* Note: if you change the mask angle here, you may want to
 		 * also change it to match in gnss_init_and_start() in main.c.
 		 */
 		.mask_angle = CONFIG_NRF_CLOUD_AGNSS_ELEVATION_MASK
-		/* Note: if CONFIG_NRF_CLOUD_AGNSS_FILTERED is enabled but
-		 * CONFIG_NRF_CLOUD_AGNSS_FILTERED_RUNTIME is not,
-		 * the nrf_cloud_rest library will set the above fields to
-		 * true and CONFIG_NRF_CLOUD_AGNSS_ELEVATION_MASK respectively.
-		 * When CONFIG_NRF_CLOUD_AGNSS_FILTERED is disabled, it will
-		 * set them to false and 0.
+		/* Note: the request is built by agnss_body_build(), not by the
+		 * nrf_cloud_rest library, so CONFIG_NRF_CLOUD_AGNSS_FILTERED is
+		 * applied here. When it is disabled, the fields are false and 0.
 		 */
 #endif
 	};
 
-	struct nrf_cloud_rest_agnss_result result = {
-		.buf = agnss_data_buf,
-		.buf_sz = sizeof(agnss_data_buf),
-		.agnss_sz = 0
-	};
-
 	struct lte_lc_cells_info net_info = { 0 };
 
-	err = serving_cell_info_get(&net_info.current_cell);
+	err = modem_cache_cell_get(&net_info.current_cell);
 	if (err) {
 		LOG_ERR("Could not get cell info, error: %d", err);
 	} else {
@@ -334,24 +428,23 @@ int assistance_request(struct nrf_modem_gnss_agnss_data_frame *agnss_request)
 			agnss_request->system[i].sv_mask_alm);
 	}
 
-	err = nrf_cloud_rest_agnss_data_get(&rest_ctx, &request, &result);
+	err = agnss_body_build(&request);
 	if (err) {
-		LOG_ERR("Failed to get A-GNSS data, error: %d", err);
+		LOG_ERR("Failed to build A-GNSS request, error: %d", err);
 		goto agnss_exit;
 	}
 
-	LOG_INF("Processing A-GNSS data");
-
-	err = nrf_cloud_agnss_process(result.buf, result.agnss_sz);
+	/* The elements are processed as they are received. */
+	agnss_stream_start();
+	err = rest_session_request("A-GNSS", agnss_rest_stream, NULL);
 	if (err) {
-		LOG_ERR("Failed to process A-GNSS data, error: %d", err);
+		LOG_ERR("Failed to get A-GNSS data, error: %d", err);
 		goto agnss_exit;
 	}
 
 	LOG_INF("A-GNSS data processed");
 
 agnss_exit:
-	assistance_active = false;
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
 
 #if defined(CONFIG_NRF_CLOUD_PGPS)
@@ -360,8 +453,3 @@ agnss_exit:
 
 	return err;
 }
-
-bool assistance_is_active(void)
-{
-	return assistance_active;
-}
@@ -33,13 +33,28 @@ int assistance_init(struct k_work_q *assistance_work_q);
  */
 int assistance_request(struct nrf_modem_gnss_agnss_data_frame *agnss_request);
 
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+/** @brief Source of the injected location assistance. */
+enum assistance_location_source {
+	ASSISTANCE_LOCATION_NONE,
+	ASSISTANCE_LOCATION_MCC,
+	ASSISTANCE_LOCATION_CELL,
+	ASSISTANCE_LOCATION_STORED_FIX,
+	ASSISTANCE_LOCATION_SOURCE_COUNT
+};
+
 /**
- * @brief Returns assistance module state.
+ * @brief Returns the source of the location injected since the previous call.
  *
- * @retval true if assistance module is downloading data.
- * @retval false if assistance module is idle.
+ * @retval ASSISTANCE_LOCATION_NONE if no location has been injected.
+ */
+enum assistance_location_source assistance_location_source_get(void);
+
+/**
+ * @brief Returns a printable name of a location source.
  */
-bool assistance_is_active(void);
+const char *assistance_location_source_str(enum assistance_location_source source);
+#endif /* CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL */
 
 #ifdef __cplusplus
 }
@@ -18,6 +18,14 @@
 #include "factory_almanac_v2.h"
 #include "factory_almanac_v3.h"
 #include "mcc_location_table.h"
+#include "modem_cache.h"
+#if defined(CONFIG_GNSS_SAMPLE_FIX_STORE)
+#include "fix_store.h"
+#include "timebase.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+#include "cell_cache.h"
+#endif
 
 LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
@@ -28,7 +36,6 @@ LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 #define SEC_PER_HOUR			(MIN_PER_HOUR * SEC_PER_MIN)
 #define SEC_PER_DAY			(HOUR_PER_DAY * SEC_PER_HOUR)
 #define DAYS_PER_WEEK			(7UL)
-#define PLMN_STR_MAX_LEN		8 /* MCC + MNC + quotes */
 
 enum almanac_version {
 	FACTORY_ALMANAC_V2 = 2,
@@ -36,6 +43,7 @@ enum almanac_version {
 };
 
 static char current_alm_checksum[64];
+static enum assistance_location_source location_source;
 
 static int set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
 {
@@ -68,18 +76,8 @@ static struct settings_handler assistance_settings = {
 
 static enum almanac_version factory_almanac_version_get(void)
 {
-	char resp[32];
-
-	if (nrf_modem_at_cmd(resp, sizeof(resp), "AT+CGMM") == 0) {
-		/* nRF9160 uses factory almanac file format version 2, while nRF91x1 uses
-		 * version 3.
-		 */
-		if (strstr(resp, "nRF9160") != NULL) {
-			return FACTORY_ALMANAC_V2;
-		}
-	}
-
-	return FACTORY_ALMANAC_V3;
+	/* nRF9160 uses factory almanac file format version 2, while nRF91x1 uses version 3. */
+	return modem_cache_identity()->factory_almanac_v3 ? FACTORY_ALMANAC_V3 : FACTORY_ALMANAC_V2;
 }
 
 static void factory_almanac_write(void)
@@ -139,15 +137,12 @@ static void gps_sec_to_day_time(int64_t gps_sec,
 	*gps_time_of_day = (uint32_t)(gps_sec % SEC_PER_DAY);
 }
 
-static void time_inject(void)
+/* Reads the current UTC time from the modem. */
+static int modem_utc_get(int64_t *utc_sec)
 {
 	int ret;
 	struct tm date_time;
-	int64_t utc_sec;
-	int64_t gps_sec;
-	struct nrf_modem_gnss_agnss_gps_data_system_time_and_sv_tow gps_time = { 0 };
 
-	/* Read current UTC time from the modem. */
 	ret = nrf_modem_at_scanf("AT+CCLK?",
 		"+CCLK: \"%u/%u/%u,%u:%u:%u",
 		&date_time.tm_year,
@@ -158,8 +153,7 @@ static void time_inject(void)
 		&date_time.tm_sec
 	);
 	if (ret != 6) {
-		LOG_WRN("Couldn't read current time from modem, time assistance unavailable");
-		return;
+		return -ENODATA;
 	}
 
 	/* Convert to struct tm format. */
@@ -167,7 +161,23 @@ static void time_inject(void)
 	date_time.tm_mon--; /* months since January */
 
 	/* Convert time to seconds since Unix time epoch (1.1.1970). */
-	utc_sec = timeutil_timegm64(&date_time);
+	*utc_sec = timeutil_timegm64(&date_time);
+
+	return 0;
+}
+
+static void time_inject(void)
+{
+	int ret;
+	int64_t utc_sec;
+	int64_t gps_sec;
+	struct nrf_modem_gnss_agnss_gps_data_system_time_and_sv_tow gps_time = { 0 };
+
+	if (modem_utc_get(&utc_sec) != 0) {
+		LOG_WRN("Couldn't read current time from modem, time assistance unavailable");
+		return;
+	}
+
 	/* Convert time to seconds since GPS time epoch (6.1.1980). */
 	gps_sec = utc_to_gps_sec(utc_sec);
 
@@ -184,72 +194,142 @@ static void time_inject(void)
 		gps_time.date_day, gps_time.time_full_s);
 }
 
-static void location_inject(void)
+static void reference_altitude_set(struct nrf_modem_gnss_agnss_data_location *location)
 {
-	int err;
-	char plmn_str[PLMN_STR_MAX_LEN + 1];
-	uint16_t mcc;
-	const struct mcc_table *mcc_info;
-	struct nrf_modem_gnss_agnss_data_location location = { 0 };
-
-	/* Read PLMN string from modem to get the MCC. */
-	err = nrf_modem_at_scanf(
-		"AT%XMONITOR",
-		"%%XMONITOR: "
-		"%*d"                                  /* <reg_status>: ignored */
-		",%*[^,]"                              /* <full_name>: ignored */
-		",%*[^,]"                              /* <short_name>: ignored */
-		",%"STRINGIFY(PLMN_STR_MAX_LEN)"[^,]", /* <plmn> */
-		plmn_str);
-	if (err != 1) {
-		LOG_WRN("Couldn't read PLMN from modem, location assistance unavailable");
-		return;
-	}
-
-	/* NULL terminate MCC and read it. */
-	plmn_str[4] = '\0';
-	mcc = strtol(plmn_str + 1, NULL, 10);
-
-	mcc_info = mcc_lookup(mcc);
-	if (mcc_info == NULL) {
-		LOG_WRN("No location found for MCC %u", mcc);
-		return;
-	}
-
-	location.latitude = lat_convert(mcc_info->lat);
-	location.longitude = lon_convert(mcc_info->lon);
-	location.unc_semimajor = mcc_info->unc_semimajor;
-	location.unc_semiminor = mcc_info->unc_semiminor;
-	location.orientation_major = mcc_info->orientation;
-	location.confidence = mcc_info->confidence;
-
 #if defined(CONFIG_GNSS_SAMPLE_LOW_ACCURACY)
 	if (CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT != -32767) {
 		/* Use reference altitude to enable 3-sat first fix. */
 		LOG_INF("Using reference altitude %d meters",
 			CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT);
-		location.altitude = CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT;
+		location->altitude = CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT;
 		/* The altitude uncertainty has to be less than 100 meters (coded number K has to
 		 * be less than 48) for the altitude to be used for a 3-sat fix. GNSS increases
 		 * the uncertainty depending on the age of the altitude and whether the device is
 		 * stationary or moving. The uncertainty is set to 0 (meaning 0 meters), so that
 		 * it remains usable for a 3-sat fix for as long as possible.
 		 */
-		location.unc_altitude = 0;
+		location->unc_altitude = 0;
 	} else
 #endif
 	{
-		location.unc_altitude = 255; /* altitude not used */
+		location->unc_altitude = 255; /* altitude not used */
+	}
+}
+
+#if defined(CONFIG_GNSS_SAMPLE_FIX_STORE)
+static bool stored_location_get(struct nrf_modem_gnss_agnss_data_location *location,
+				uint32_t *unc_m)
+{
+	int err;
+	int64_t utc_sec;
+	uint32_t sec;
+	uint16_t ms;
+
+	/* The time base is only synced once GNSS has had a fix, so use network time before that. */
+	if (timebase_now(&sec, &ms)) {
+		utc_sec = sec;
+	} else if (modem_utc_get(&utc_sec) != 0) {
+		LOG_WRN("Couldn't read current time from modem, stored fix unavailable");
+		return false;
+	}
+
+	err = fix_store_location_get(utc_sec, location, unc_m);
+	if (err == -ETIME) {
+		LOG_INF("Stored fix is older than %d hours, not using it",
+			CONFIG_GNSS_SAMPLE_FIX_STORE_MAX_AGE);
+	}
+
+	return err == 0;
+}
+#endif /* CONFIG_GNSS_SAMPLE_FIX_STORE */
+
+static void location_inject(void)
+{
+	int err;
+	bool cell_valid;
+	struct lte_lc_cell cell;
+	uint16_t mcc;
+	uint32_t unc_m = UINT32_MAX;
+	const struct mcc_table *mcc_info;
+	struct nrf_modem_gnss_agnss_data_location location = { 0 };
+	enum assistance_location_source source = ASSISTANCE_LOCATION_NONE;
+
+	/* MCC, MNC, TAC and cell ID of the serving cell, unavailable when the device isn't
+	 * registered to a network.
+	 */
+	cell_valid = (modem_cache_cell_get(&cell) == 0);
+
+#if defined(CONFIG_GNSS_SAMPLE_FIX_STORE)
+	/* The last fix is far more accurate than the MCC location if the bus hasn't moved much. */
+	if (stored_location_get(&location, &unc_m)) {
+		source = ASSISTANCE_LOCATION_STORED_FIX;
+	}
+#endif
+
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+	if (cell_valid) {
+		struct nrf_modem_gnss_agnss_data_location cell_location = { 0 };
+		uint32_t cell_unc_m;
+
+		/* LTE is usually deactivated right after this, let the cache learn from the
+		 * first fixes.
+		 */
+		cell_cache_serving_cell_set(cell.id, cell.tac);
+
+		/* Prefer the learned cell position over an old stored fix. */
+		if (cell_cache_location_get(cell.id, cell.tac, &cell_location, &cell_unc_m) == 0 &&
+		    cell_unc_m < unc_m) {
+			location = cell_location;
+			unc_m = cell_unc_m;
+			source = ASSISTANCE_LOCATION_CELL;
+		}
+	}
+#endif
+
+	if (source == ASSISTANCE_LOCATION_NONE) {
+		if (!cell_valid) {
+			LOG_WRN("Couldn't read PLMN from modem, location assistance unavailable");
+			return;
+		}
+
+		mcc = cell.mcc;
+
+		mcc_info = mcc_lookup(mcc);
+		if (mcc_info == NULL) {
+			LOG_WRN("No location found for MCC %u", mcc);
+			return;
+		}
+
+		location.latitude = lat_convert(mcc_info->lat);
+		location.longitude = lon_convert(mcc_info->lon);
+		location.unc_semimajor = mcc_info->unc_semimajor;
+		location.unc_semiminor = mcc_info->unc_semiminor;
+		location.orientation_major = mcc_info->orientation;
+		location.confidence = mcc_info->confidence;
+		source = ASSISTANCE_LOCATION_MCC;
+	}
+
+	/* The stored fix comes with its own altitude. */
+	if (source != ASSISTANCE_LOCATION_STORED_FIX) {
+		reference_altitude_set(&location);
 	}
 
 	err = nrf_modem_gnss_agnss_write(
 		&location, sizeof(location), NRF_MODEM_GNSS_AGNSS_LOCATION);
 	if (err) {
-		LOG_ERR("Failed to inject location for MCC %u, error %d", mcc, err);
+		LOG_ERR("Failed to inject %s location, error %d",
+			assistance_location_source_str(source), err);
 		return;
 	}
 
-	LOG_INF("Injected location for MCC %u", mcc);
+	location_source = source;
+
+	if (source == ASSISTANCE_LOCATION_MCC) {
+		LOG_INF("Injected location for MCC %u", mcc);
+	} else {
+		LOG_INF("Injected %s location with uncertainty %u m",
+			assistance_location_source_str(source), unc_m);
+	}
 }
 
 int assistance_init(struct k_work_q *assistance_work_q)
@@ -294,8 +374,28 @@ int assistance_request(struct nrf_modem_gnss_agnss_data_frame *agnss_request)
 	return 0;
 }
 
-bool assistance_is_active(void)
+enum assistance_location_source assistance_location_source_get(void)
 {
-	/* Always return false because assistance_request() doesn't take much time. */
-	return false;
+	enum assistance_location_source source = location_source;
+
+	location_source = ASSISTANCE_LOCATION_NONE;
+
+	return source;
+}
+
+const char *assistance_location_source_str(enum assistance_location_source source)
+{
+	switch (source) {
+	case ASSISTANCE_LOCATION_MCC:
+		return "MCC";
+
+	case ASSISTANCE_LOCATION_CELL:
+		return "cell";
+
+	case ASSISTANCE_LOCATION_STORED_FIX:
+		return "stored fix";
+
+	default:
+		return "no";
+	}
 }
@@ -5,7 +5,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/net/socket.h>
 #include <supl_os_client.h>
@@ -21,7 +23,32 @@ LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 BUILD_ASSERT(sizeof(CONFIG_GNSS_SAMPLE_SUPL_HOSTNAME) > 1, "Server hostname must be configured");
 
 static int supl_fd = -1;
-static volatile bool assistance_active;
+
+/* Address the last connection was made to, resolved again when the TTL has passed. */
+static struct sockaddr_storage server_addr;
+static socklen_t server_addrlen;
+static int64_t server_expiry_ms;
+
+/* Serializes the sessions and the closing of the idle connection. */
+static K_MUTEX_DEFINE(supl_mutex);
+static struct k_work_q *work_q;
+static struct k_work_delayable idle_work;
+
+/* Of the session in progress. */
+static size_t session_tx_bytes;
+static size_t session_rx_bytes;
+
+/* Since boot. */
+static uint32_t sessions;
+static uint32_t sessions_skipped;
+static uint32_t failures;
+static uint32_t connections;
+static uint32_t retries;
+static uint32_t dns_lookups;
+static uint32_t ephe_requested;
+static uint64_t tx_bytes;
+static uint64_t rx_bytes;
+static uint64_t session_ms_sum;
 
 static ssize_t supl_read(void *p_buff, size_t nbytes, void *user_data)
 {
@@ -29,6 +56,10 @@ static ssize_t supl_read(void *p_buff, size_t nbytes, void *user_data)
 
 	ssize_t rc = recv(supl_fd, p_buff, nbytes, 0);
 
+	if (rc > 0) {
+		session_rx_bytes += rc;
+	}
+
 	if (rc < 0 && (errno == EAGAIN)) {
 		/* Return 0 to indicate a timeout. */
 		rc = 0;
@@ -44,7 +75,13 @@ static ssize_t supl_write(const void *p_buff, size_t nbytes, void *user_data)
 {
 	ARG_UNUSED(user_data);
 
-	return send(supl_fd, p_buff, nbytes, 0);
+	ssize_t rc = send(supl_fd, p_buff, nbytes, 0);
+
+	if (rc > 0) {
+		session_tx_bytes += rc;
+	}
+
+	return rc;
 }
 
 static int inject_agnss_type(void *agnss, size_t agnss_size, uint16_t type, void *user_data)
@@ -86,6 +123,52 @@ static int supl_logger(int level, const char *fmt, ...)
 	return ret;
 }
 
+static int connect_supl_socket(const struct sockaddr *sa, socklen_t addrlen)
+{
+	int err;
+	char ip[INET6_ADDRSTRLEN] = { 0 };
+
+	supl_fd = socket(sa->sa_family, SOCK_STREAM, IPPROTO_TCP);
+	if (supl_fd < 0) {
+		LOG_ERR("Failed to create socket, errno %d", errno);
+		return -1;
+	}
+
+	/* The SUPL library expects a 1 second timeout for the read function. */
+	struct timeval timeout = {
+		.tv_sec = 1,
+		.tv_usec = 0,
+	};
+
+	err = setsockopt(supl_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (err) {
+		LOG_ERR("Failed to set socket timeout, errno %d", errno);
+		goto error;
+	}
+
+	inet_ntop(sa->sa_family,
+		  (void *)&((struct sockaddr_in *)sa)->sin_addr,
+		  ip,
+		  INET6_ADDRSTRLEN);
+	LOG_INF("Connecting to %s port %d", ip, SUPL_SERVER_PORT);
+
+	err = connect(supl_fd, sa, addrlen);
+	if (err) {
+		LOG_WRN("Connecting to server failed, errno %d", errno);
+		goto error;
+	}
+
+	connections++;
+
+	return 0;
+
+error:
+	close(supl_fd);
+	supl_fd = -1;
+
+	return -1;
+}
+
 static int open_supl_socket(void)
 {
 	int err;
@@ -98,8 +181,17 @@ static int open_supl_socket(void)
 		.ai_socktype = SOCK_STREAM
 	};
 
+	/* The cached address skips the DNS lookup, it is resolved again if it fails. */
+	if (k_uptime_get() < server_expiry_ms) {
+		if (connect_supl_socket((struct sockaddr *)&server_addr, server_addrlen) == 0) {
+			return 0;
+		}
+		server_expiry_ms = 0;
+	}
+
 	snprintf(port, sizeof(port), "%d", SUPL_SERVER_PORT);
 
+	dns_lookups++;
 	err = getaddrinfo(SUPL_SERVER, port, &hints, &info);
 	if (err) {
 		LOG_ERR("Failed to resolve hostname %s, error: %d", SUPL_SERVER, err);
@@ -111,56 +203,22 @@ static int open_supl_socket(void)
 	err = -1;
 
 	for (struct addrinfo *addr = info; addr != NULL; addr = addr->ai_next) {
-		char ip[INET6_ADDRSTRLEN] = { 0 };
-		struct sockaddr *const sa = addr->ai_addr;
-
-		supl_fd = socket(sa->sa_family, SOCK_STREAM, IPPROTO_TCP);
-		if (supl_fd < 0) {
-			LOG_ERR("Failed to create socket, errno %d", errno);
-			goto cleanup;
-		}
-
-		/* The SUPL library expects a 1 second timeout for the read function. */
-		struct timeval timeout = {
-			.tv_sec = 1,
-			.tv_usec = 0,
-		};
-
-		err = setsockopt(supl_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-		if (err) {
-			LOG_ERR("Failed to set socket timeout, errno %d", errno);
-			goto cleanup;
-		}
-
-		inet_ntop(sa->sa_family,
-			  (void *)&((struct sockaddr_in *)sa)->sin_addr,
-			  ip,
-			  INET6_ADDRSTRLEN);
-		LOG_INF("Connecting to %s port %d", ip, SUPL_SERVER_PORT);
-
-		err = connect(supl_fd, sa, addr->ai_addrlen);
-		if (err) {
-			close(supl_fd);
-			supl_fd = -1;
-
-			/* Try the next address. */
-			LOG_WRN("Connecting to server failed, errno %d", errno);
-		} else {
-			/* Connected. */
+		err = connect_supl_socket(addr->ai_addr, addr->ai_addrlen);
+		if (err == 0) {
+			server_addrlen = MIN(addr->ai_addrlen, sizeof(server_addr));
+			memcpy(&server_addr, addr->ai_addr, server_addrlen);
+			server_expiry_ms = k_uptime_get() +
+					   CONFIG_GNSS_SAMPLE_SUPL_DNS_TTL * MSEC_PER_SEC;
 			break;
 		}
+
+		/* Try the next address. */
 	}
 
-cleanup:
 	freeaddrinfo(info);
 
 	if (err) {
-		/* Unable to connect, close socket. */
 		LOG_ERR("Could not connect to SUPL server");
-		if (supl_fd > -1) {
-			close(supl_fd);
-			supl_fd = -1;
-		}
 		return -1;
 	}
 
@@ -169,14 +227,72 @@ cleanup:
 
 static void close_supl_socket(void)
 {
+	if (supl_fd < 0) {
+		return;
+	}
+
 	if (close(supl_fd) < 0) {
 		LOG_ERR("Failed to close SUPL socket");
 	}
+	supl_fd = -1;
+}
+
+/* Returns true if the open connection can be used for the next session. */
+static bool supl_socket_alive(void)
+{
+	char byte;
+	ssize_t rc;
+
+	if (supl_fd < 0) {
+		return false;
+	}
+
+	/* A closed connection reads 0, and unsolicited data would be taken as a response. */
+	rc = recv(supl_fd, &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT);
+	if (rc < 0 && errno == EAGAIN) {
+		return true;
+	}
+
+	close_supl_socket();
+
+	return false;
+}
+
+static void idle_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&supl_mutex, K_FOREVER);
+	if (supl_fd >= 0) {
+		LOG_DBG("Closing idle SUPL connection");
+		close_supl_socket();
+	}
+	k_mutex_unlock(&supl_mutex);
+}
+
+/* GNSS asks only for the ephemerides it lacks or that are about to expire, so the request is
+ * sent as it is. Returns false if nothing is requested.
+ */
+static bool request_needed(const struct nrf_modem_gnss_agnss_data_frame *agnss_request)
+{
+	bool needed = (agnss_request->data_flags != 0);
+
+	for (int i = 0; i < agnss_request->system_count; i++) {
+		if (agnss_request->system[i].system_id == NRF_MODEM_GNSS_SYSTEM_GPS) {
+			ephe_requested += __builtin_popcountll(agnss_request->system[i].sv_mask_ephe);
+		}
+
+		needed |= (agnss_request->system[i].sv_mask_ephe != 0 ||
+			   agnss_request->system[i].sv_mask_alm != 0);
+	}
+
+	return needed;
 }
 
 int assistance_init(struct k_work_q *assistance_work_q)
 {
-	ARG_UNUSED(assistance_work_q);
+	work_q = assistance_work_q;
+	k_work_init_delayable(&idle_work, idle_work_fn);
 
 	static struct supl_api supl_api = {
 		.read       = supl_read,
@@ -196,27 +312,112 @@ int assistance_init(struct k_work_q *assistance_work_q)
 
 int assistance_request(struct nrf_modem_gnss_agnss_data_frame *agnss_request)
 {
-	int err;
+	int err = 0;
 
-	assistance_active = true;
+	k_mutex_lock(&supl_mutex, K_FOREVER);
+	(void)k_work_cancel_delayable(&idle_work);
 
-	err = open_supl_socket();
-	if (err) {
+	if (!request_needed(agnss_request)) {
+		LOG_INF("No assistance data needed, no SUPL session");
+		sessions_skipped++;
 		goto exit;
 	}
 
-	LOG_INF("Starting SUPL session");
-	err = supl_session(agnss_request);
-	LOG_INF("Done");
-	close_supl_socket();
+	for (int attempt = 0;; attempt++) {
+		bool reused = supl_socket_alive();
+		int64_t start;
+		uint32_t session_ms;
+
+		if (!reused) {
+			err = open_supl_socket();
+			if (err) {
+				break;
+			}
+		}
+
+		session_tx_bytes = 0;
+		session_rx_bytes = 0;
+		start = k_uptime_get();
+
+		LOG_INF("Starting SUPL session");
+		err = supl_session(agnss_request);
+		session_ms = k_uptime_get() - start;
+
+		sessions++;
+		tx_bytes += session_tx_bytes;
+		rx_bytes += session_rx_bytes;
+		session_ms_sum += session_ms;
+
+		LOG_INF("SUPL session: %s, %zu bytes sent, %zu bytes received in %u ms on a %s "
+			"connection", err ? "failed" : "done", session_tx_bytes, session_rx_bytes,
+			session_ms, reused ? "reused" : "new");
+
+		if (err == 0) {
+			break;
+		}
+
+		failures++;
+		close_supl_socket();
+
+		/* The server may have closed the idle connection. */
+		if (attempt > 0 || !reused) {
+			break;
+		}
+
+		retries++;
+		LOG_WRN("Retrying SUPL session with a new connection");
+	}
+
+	if (supl_fd >= 0) {
+		k_work_reschedule_for_queue(work_q, &idle_work,
+					    K_SECONDS(CONFIG_GNSS_SAMPLE_SUPL_KEEP_ALIVE));
+	}
 
 exit:
-	assistance_active = false;
+	k_mutex_unlock(&supl_mutex);
 
 	return err;
 }
 
-bool assistance_is_active(void)
+#if defined(CONFIG_SHELL)
+static int cmd_supl(const struct shell *sh, size_t argc, char **argv)
 {
-	return assistance_active;
+	uint32_t snapshot_sessions;
+	uint32_t snapshot_skipped;
+	uint32_t snapshot_failures;
+	uint32_t snapshot_connections;
+	uint32_t snapshot_retries;
+	uint32_t snapshot_dns_lookups;
+	uint32_t snapshot_ephe_requested;
+	uint64_t snapshot_tx_bytes;
+	uint64_t snapshot_rx_bytes;
+	uint64_t snapshot_session_ms_sum;
+
+	k_mutex_lock(&supl_mutex, K_FOREVER);
+	snapshot_sessions = sessions;
+	snapshot_skipped = sessions_skipped;
+	snapshot_failures = failures;
+	snapshot_connections = connections;
+	snapshot_retries = retries;
+	snapshot_dns_lookups = dns_lookups;
+	snapshot_ephe_requested = ephe_requested;
+	snapshot_tx_bytes = tx_bytes;
+	snapshot_rx_bytes = rx_bytes;
+	snapshot_session_ms_sum = session_ms_sum;
+	k_mutex_unlock(&supl_mutex);
+
+	shell_print(sh, "sessions,skipped,failures,connections,retries,dns_lookups,tx_bytes,"
+			"rx_bytes,mean_ms,ephe_requested");
+	shell_print(sh, "%u,%u,%u,%u,%u,%u,%llu,%llu,%llu,%u", snapshot_sessions,
+		    snapshot_skipped, snapshot_failures, snapshot_connections, snapshot_retries,
+		    snapshot_dns_lookups, snapshot_tx_bytes, snapshot_rx_bytes,
+		    snapshot_sessions ? snapshot_session_ms_sum / snapshot_sessions : 0,
+		    snapshot_ephe_requested);
+
+	return 0;
 }
+
+SHELL_CMD_REGISTER(supl, NULL,
+		   "Print the SUPL sessions, connections, bytes and ephemerides requested since boot "
+		   "as CSV", cmd_supl);
+#endif /* CONFIG_SHELL */
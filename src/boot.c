@@ -0,0 +1,78 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+
+#include "boot.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+	[BOOT_PHASE_MODEM_LIB] = "modem_lib",
+	[BOOT_PHASE_ACCEL] = "accel",
+	[BOOT_PHASE_GNSS_START] = "gnss_start",
+	[BOOT_PHASE_FIRST_RECORD] = "first_record",
+	[BOOT_PHASE_LTE] = "lte",
+	[BOOT_PHASE_TIME] = "time",
+	[BOOT_PHASE_FIRST_FIX] = "first_fix",
+};
+
+static struct k_spinlock lock;
+/* Raised once per phase, with the uptime in milliseconds as the result. */
+static struct k_poll_signal signals[BOOT_PHASE_COUNT];
+
+void boot_init(void)
+{
+	for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+		k_poll_signal_init(&signals[i]);
+	}
+}
+
+void boot_phase_done(enum boot_phase phase)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t uptime_ms = k_uptime_get_32();
+	unsigned int signaled;
+	int result;
+
+	k_poll_signal_check(&signals[phase], &signaled, &result);
+	if (!signaled) {
+		k_poll_signal_raise(&signals[phase], uptime_ms);
+	}
+	k_spin_unlock(&lock, key);
+
+	if (!signaled) {
+		LOG_INF("Boot: %s after %u ms", phase_names[phase], uptime_ms);
+	}
+}
+
+bool boot_phase_wait(enum boot_phase phase, k_timeout_t timeout)
+{
+	struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+							     K_POLL_MODE_NOTIFY_ONLY,
+							     &signals[phase]);
+
+	return k_poll(&event, 1, timeout) == 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_boot(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "phase,ms");
+	for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+		unsigned int signaled;
+		int result;
+
+		k_poll_signal_check(&signals[i], &signaled, &result);
+		if (signaled) {
+			shell_print(sh, "%s,%u", phase_names[i], (uint32_t)result);
+		} else {
+			shell_print(sh, "%s,", phase_names[i]);
+		}
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(boot, NULL, "Print the uptime at which each boot phase completed as CSV",
+		   cmd_boot);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,50 @@
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * Boot phases.
+ *
+ * The sources of a record are brought up independently: the accelerometer and the report tick
+ * first, then GNSS, while LTE attaches and the network time is fetched in the background. Each
+ * phase is marked done once, with the uptime at which it completed, so that the time to the
+ * first record and to the first fix can be compared across releases. Code that needs a phase,
+ * such as the A-GNSS fetch needing LTE, waits for it instead of holding up the whole boot.
+ */
+
+enum boot_phase {
+	BOOT_PHASE_MODEM_LIB,		/* Modem library initialized */
+	BOOT_PHASE_ACCEL,		/* Accelerometer ready, sampling started */
+	BOOT_PHASE_GNSS_START,		/* GNSS configured and started */
+	BOOT_PHASE_FIRST_RECORD,	/* First record emitted */
+	BOOT_PHASE_LTE,			/* Registered to the LTE network */
+	BOOT_PHASE_TIME,		/* Network time obtained */
+	BOOT_PHASE_FIRST_FIX,		/* First accepted fix */
+	BOOT_PHASE_COUNT
+};
+
+/**
+ * @brief Initializes the boot phases, called first in main().
+ */
+void boot_init(void);
+
+/**
+ * @brief Marks a boot phase done, only the first call for a phase is recorded.
+ *
+ * @details Can be called from an ISR.
+ */
+void boot_phase_done(enum boot_phase phase);
+
+/**
+ * @brief Waits for a boot phase.
+ *
+ * @param[in] phase   Phase to wait for.
+ * @param[in] timeout How long to wait.
+ *
+ * @retval true if the phase is done.
+ * @retval false on timeout.
+ */
+bool boot_phase_wait(enum boot_phase phase, k_timeout_t timeout);
+
+#endif /* BOOT_H_ */
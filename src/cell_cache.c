@@ -0,0 +1,272 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+
+#include "cell_cache.h"
+#include "mcc_location_table.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define CELL_CACHE_SIZE			CONFIG_GNSS_SAMPLE_CELL_CACHE_SIZE
+#define EARTH_RADIUS_METERS		(6371.0 * 1000.0)
+#define DEG_TO_RAD			(3.14159265358979323846 / 180.0)
+#define COORD_TO_METERS			(1e-7 * DEG_TO_RAD * EARTH_RADIUS_METERS)
+
+/* Fixes are still learned for the last serving cell this long after LTE has gone down. */
+#define CELL_CACHE_LOST_TIMEOUT_MS	(60 * MSEC_PER_SEC)
+/* Cells with fewer fixes than this are not used for assistance. */
+#define CELL_CACHE_MIN_FIXES		10
+/* The fix count saturates here, after which the estimate follows a moving average so that it
+ * adapts if the operator moves or reconfigures a cell.
+ */
+#define CELL_CACHE_MAX_FIXES		1000
+/* The fixes only cover the roads driven in the cell, so never claim better than this. */
+#define CELL_CACHE_MIN_UNC_M		250.0f
+#define CELL_CACHE_CONFIDENCE		68
+#define CELL_CACHE_NONE			-1
+
+struct cell_entry {
+	uint32_t cell_id;
+	uint32_t seq;			/* Larger is more recently used, 0 if the entry is empty */
+	int32_t latitude;		/* Mean, 1e-7 degrees */
+	int32_t longitude;		/* Mean, 1e-7 degrees */
+	float m2;			/* Sum of squared distances from the mean, m^2 */
+	uint16_t tac;
+	uint16_t count;
+};
+
+static struct k_spinlock lock;
+static struct cell_entry cells[CELL_CACHE_SIZE];
+static uint32_t seq;
+
+static uint32_t serving_cell_id;
+static uint16_t serving_tac;
+static bool serving_valid;
+static bool serving_lost;
+static int64_t serving_lost_ms;
+
+/* Entry with changes not yet written to settings, and when settings were last written. */
+static int dirty = CELL_CACHE_NONE;
+static int64_t last_save_ms;
+
+static int cell_cache_set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
+{
+	int len;
+	unsigned long slot;
+	char *end;
+
+	if (!key) {
+		return -ENOENT;
+	}
+
+	slot = strtoul(key, &end, 10);
+	if (end == key || *end != '\0' || slot >= CELL_CACHE_SIZE) {
+		/* Entries beyond a reduced cache size are dropped. */
+		return 0;
+	}
+
+	if (len_rd != sizeof(cells[slot])) {
+		return 0;
+	}
+
+	len = read_cb(cb_arg, &cells[slot], sizeof(cells[slot]));
+	if (len != sizeof(cells[slot])) {
+		LOG_ERR("Failed to read cell %lu from settings", slot);
+		memset(&cells[slot], 0, sizeof(cells[slot]));
+		return 0;
+	}
+
+	seq = MAX(seq, cells[slot].seq);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(cell_cache, "cell_cache", NULL, cell_cache_set, NULL, NULL);
+
+static void cell_save(int slot)
+{
+	int err;
+	char key[sizeof("cell_cache/") + 4];
+	struct cell_entry entry;
+	k_spinlock_key_t lock_key;
+
+	lock_key = k_spin_lock(&lock);
+	entry = cells[slot];
+	k_spin_unlock(&lock, lock_key);
+
+	snprintf(key, sizeof(key), "cell_cache/%d", slot);
+
+	err = settings_save_one(key, &entry, sizeof(entry));
+	if (err) {
+		LOG_ERR("Failed to write cell to settings, error %d", err);
+	}
+}
+
+/* Must be called with the lock held. */
+static int cell_find(uint32_t cell_id, uint16_t tac)
+{
+	for (int i = 0; i < CELL_CACHE_SIZE; i++) {
+		if (cells[i].seq != 0 && cells[i].cell_id == cell_id && cells[i].tac == tac) {
+			return i;
+		}
+	}
+
+	return CELL_CACHE_NONE;
+}
+
+/* Returns the entry for a cell, evicting the least recently used cell if it isn't cached. Must
+ * be called with the lock held.
+ */
+static int cell_find_or_evict(uint32_t cell_id, uint16_t tac)
+{
+	int slot = cell_find(cell_id, tac);
+
+	if (slot != CELL_CACHE_NONE) {
+		return slot;
+	}
+
+	slot = 0;
+	for (int i = 1; i < CELL_CACHE_SIZE; i++) {
+		if (cells[i].seq < cells[slot].seq) {
+			slot = i;
+		}
+	}
+
+	cells[slot] = (struct cell_entry) {
+		.cell_id = cell_id,
+		.tac = tac,
+	};
+
+	return slot;
+}
+
+void cell_cache_serving_cell_set(uint32_t cell_id, uint16_t tac)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	serving_cell_id = cell_id;
+	serving_tac = tac;
+	serving_valid = true;
+	serving_lost = false;
+
+	k_spin_unlock(&lock, key);
+}
+
+void cell_cache_serving_cell_lost(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (serving_valid && !serving_lost) {
+		serving_lost = true;
+		serving_lost_ms = k_uptime_get();
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void cell_cache_fix_add(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	int32_t latitude = (int32_t)lround(pvt->latitude * 1e7);
+	int32_t longitude = (int32_t)lround(pvt->longitude * 1e7);
+	double lon_scale = cos(pvt->latitude * DEG_TO_RAD);
+	int64_t now = k_uptime_get();
+	int slot = CELL_CACHE_NONE;
+	int flush = CELL_CACHE_NONE;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	if (serving_valid && serving_lost && now - serving_lost_ms > CELL_CACHE_LOST_TIMEOUT_MS) {
+		serving_valid = false;
+	}
+
+	if (serving_valid) {
+		struct cell_entry *cell;
+		double d_lat;
+		double d_lon;
+
+		slot = cell_find_or_evict(serving_cell_id, serving_tac);
+		cell = &cells[slot];
+
+		if (cell->count == CELL_CACHE_MAX_FIXES) {
+			cell->m2 -= cell->m2 / cell->count;
+		} else {
+			cell->count++;
+		}
+
+		/* Welford's update, with the distances in meters on a local flat earth. */
+		d_lat = (latitude - cell->latitude) * COORD_TO_METERS;
+		d_lon = (longitude - cell->longitude) * COORD_TO_METERS * lon_scale;
+		if (cell->count == 1) {
+			cell->latitude = latitude;
+			cell->longitude = longitude;
+			cell->m2 = 0.0f;
+		} else {
+			cell->latitude += (int32_t)lround((double)(latitude - cell->latitude) /
+							  cell->count);
+			cell->longitude += (int32_t)lround((double)(longitude - cell->longitude) /
+							   cell->count);
+			cell->m2 += d_lat * (latitude - cell->latitude) * COORD_TO_METERS +
+				    d_lon * (longitude - cell->longitude) * COORD_TO_METERS * lon_scale;
+		}
+
+		if (cell->seq == 0 || cell->seq != seq) {
+			cell->seq = ++seq;
+		}
+	}
+
+	/* Write the previous cell when the serving cell changes, and the current one regularly. */
+	if (dirty != CELL_CACHE_NONE &&
+	    (dirty != slot ||
+	     now - last_save_ms >= CONFIG_GNSS_SAMPLE_CELL_CACHE_SAVE_INTERVAL * MSEC_PER_SEC)) {
+		flush = dirty;
+		dirty = CELL_CACHE_NONE;
+	}
+	if (slot != CELL_CACHE_NONE && slot != flush) {
+		dirty = slot;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (flush != CELL_CACHE_NONE) {
+		cell_save(flush);
+		last_save_ms = now;
+	}
+}
+
+int cell_cache_location_get(uint32_t cell_id, uint16_t tac,
+			    struct nrf_modem_gnss_agnss_data_location *location, uint32_t *unc_m)
+{
+	struct cell_entry cell;
+	int slot;
+	float unc;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	slot = cell_find(cell_id, tac);
+	if (slot != CELL_CACHE_NONE) {
+		cell = cells[slot];
+	}
+	k_spin_unlock(&lock, key);
+
+	if (slot == CELL_CACHE_NONE || cell.count < CELL_CACHE_MIN_FIXES) {
+		return -ENOENT;
+	}
+
+	unc = MAX(sqrtf(cell.m2 / cell.count), CELL_CACHE_MIN_UNC_M);
+
+	location->latitude = lat_convert(cell.latitude / 1e7f);
+	location->longitude = lon_convert(cell.longitude / 1e7f);
+	location->unc_semimajor = unc_convert(unc);
+	location->unc_semiminor = location->unc_semimajor;
+	location->orientation_major = 0;
+	location->confidence = CELL_CACHE_CONFIDENCE;
+
+	*unc_m = (uint32_t)unc;
+
+	return 0;
+}
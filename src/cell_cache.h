@@ -0,0 +1,50 @@
+#ifndef CELL_CACHE_H_
+#define CELL_CACHE_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * @brief Sets the LTE cell the device is camped on.
+ *
+ * @param[in] cell_id E-UTRAN cell ID.
+ * @param[in] tac     Tracking area code.
+ */
+void cell_cache_serving_cell_set(uint32_t cell_id, uint16_t tac);
+
+/**
+ * @brief Tells the cache that the device is no longer camped on the serving cell.
+ *
+ * @details Fixes are still learned for the last serving cell for a short while, because LTE is
+ *          often deactivated right after assistance data has been fetched.
+ */
+void cell_cache_serving_cell_lost(void);
+
+/**
+ * @brief Adds a valid fix to the position estimate of the serving cell.
+ *
+ * @details The cell position is the running mean of the fixes seen while camped on the cell, and
+ *          its uncertainty the RMS distance of the fixes from the mean. The least recently used
+ *          cell is evicted when the cache is full. Changed cells are written to settings when
+ *          the serving cell changes and every CONFIG_GNSS_SAMPLE_CELL_CACHE_SAVE_INTERVAL
+ *          seconds.
+ *
+ * @param[in] pvt PVT with a valid fix.
+ */
+void cell_cache_fix_add(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Returns the learned position of a cell as location assistance.
+ *
+ * @param[in]  cell_id  E-UTRAN cell ID.
+ * @param[in]  tac      Tracking area code.
+ * @param[out] location Location assistance data, altitude is not set.
+ * @param[out] unc_m    Horizontal uncertainty in meters.
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if the cell is not known or has too few fixes.
+ */
+int cell_cache_location_get(uint32_t cell_id, uint16_t tac,
+			    struct nrf_modem_gnss_agnss_data_location *location, uint32_t *unc_m);
+
+#endif /* CELL_CACHE_H_ */
@@ -0,0 +1,314 @@
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "fix_filter.h"
+#include "gnss_quality.h"
+#include "stats.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define EARTH_RADIUS_M		6371000.0
+#define DEG_TO_RAD		(M_PI / 180.0)
+
+/* Acceleration noise of the constant velocity model in (m/s^2)^2 per second, buses rarely
+ * accelerate or brake harder than 1.5 m/s^2.
+ */
+#define ACCEL_NOISE		1.0
+/* Squared normalized distance of a fix from the prediction above which it is down-weighted,
+ * the 99th percentile for two degrees of freedom.
+ */
+#define DOWNWEIGHT_GATE		9.21
+/* Rejected jumps in a row after which the filter restarts from the new fix, the filtered
+ * position is more likely wrong than all of them. A filter started from a single fix is
+ * restarted on the first jump, the two fixes are equally likely wrong.
+ */
+#define RESET_REJECTS		5
+/* Accepted fixes before the filtered fix is used, a single fix can be an outlier itself. */
+#define CONFIRM_FIXES		2
+/* The filter restarts after a gap this long without an accepted fix. */
+#define MAX_GAP_MS		(60 * MSEC_PER_SEC)
+/* The filtered fix is current for this long after the last accepted fix. */
+#define STALE_MS		(5 * MSEC_PER_SEC)
+/* The plane origin is moved to the estimate beyond this distance. */
+#define ORIGIN_MAX_M		10000.0
+/* Velocity variance without a velocity measurement. */
+#define VELOCITY_UNKNOWN_VAR	100.0
+/* Below this speed the heading is noise, the previous one is kept. */
+#define HEADING_MIN_SPEED	1.0
+
+/* One axis of the constant velocity model: position, velocity and their covariance. */
+struct axis {
+	double p;
+	double v;
+	double pp;
+	double pv;
+	double vv;
+};
+
+static struct k_spinlock lock;
+static bool initialized;
+static double origin_lat;
+static double origin_lon;
+static double origin_cos;
+static struct axis east;
+static struct axis north;
+static double heading;
+static float altitude;
+static int64_t last_update_ms;
+static uint32_t rejects_in_row;
+static uint32_t fixes_since_reset;
+static uint32_t results[FIX_FILTER_RESULT_COUNT];
+
+static void axis_predict(struct axis *a, double dt)
+{
+	a->p += a->v * dt;
+	a->pp += dt * (2.0 * a->pv + dt * a->vv) + ACCEL_NOISE * dt * dt * dt / 3.0;
+	a->pv += dt * a->vv + ACCEL_NOISE * dt * dt / 2.0;
+	a->vv += ACCEL_NOISE * dt;
+}
+
+static void axis_update_position(struct axis *a, double z, double r)
+{
+	double s = a->pp + r;
+	double kp = a->pp / s;
+	double kv = a->pv / s;
+	double innovation = z - a->p;
+
+	a->p += kp * innovation;
+	a->v += kv * innovation;
+	a->vv -= kv * a->pv;
+	a->pv -= kp * a->pv;
+	a->pp -= kp * a->pp;
+}
+
+static void axis_update_velocity(struct axis *a, double z, double r)
+{
+	double s = a->vv + r;
+	double kp = a->pv / s;
+	double kv = a->vv / s;
+	double innovation = z - a->v;
+
+	a->p += kp * innovation;
+	a->v += kv * innovation;
+	a->pp -= kp * a->pv;
+	a->pv -= kp * a->vv;
+	a->vv -= kv * a->vv;
+}
+
+/* Squared innovation of a position over its variance. */
+static double axis_distance2(const struct axis *a, double z, double r)
+{
+	double innovation = z - a->p;
+
+	return innovation * innovation / (a->pp + r);
+}
+
+static void plane_origin_set(double latitude, double longitude)
+{
+	origin_lat = latitude;
+	origin_lon = longitude;
+	origin_cos = cos(latitude * DEG_TO_RAD);
+}
+
+static void plane_from_coord(double latitude, double longitude, double *x, double *y)
+{
+	*x = (longitude - origin_lon) * DEG_TO_RAD * EARTH_RADIUS_M * origin_cos;
+	*y = (latitude - origin_lat) * DEG_TO_RAD * EARTH_RADIUS_M;
+}
+
+static void plane_to_coord(double x, double y, double *latitude, double *longitude)
+{
+	*latitude = origin_lat + y / (EARTH_RADIUS_M * DEG_TO_RAD);
+	*longitude = origin_lon + x / (EARTH_RADIUS_M * DEG_TO_RAD * origin_cos);
+}
+
+static void filter_reset(const struct nrf_modem_gnss_pvt_data_frame *pvt, double r)
+{
+	bool velocity_valid = (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_VELOCITY_VALID);
+	double speed = velocity_valid ? pvt->speed : 0.0;
+	double v_var = velocity_valid ? MAX((double)pvt->speed_accuracy * pvt->speed_accuracy, 0.01)
+				      : VELOCITY_UNKNOWN_VAR;
+
+	plane_origin_set(pvt->latitude, pvt->longitude);
+	east = (struct axis){ .v = speed * sin(pvt->heading * DEG_TO_RAD), .pp = r, .vv = v_var };
+	north = (struct axis){ .v = speed * cos(pvt->heading * DEG_TO_RAD), .pp = r, .vv = v_var };
+	initialized = true;
+	fixes_since_reset = 1;
+}
+
+/* Returns true if the fix is further from the filtered position than a bus can go. */
+static bool filter_jump(const struct nrf_modem_gnss_pvt_data_frame *pvt, int64_t uptime_ms)
+{
+	double latitude;
+	double longitude;
+	double dt = (uptime_ms - last_update_ms) / (double)MSEC_PER_SEC;
+	double distance;
+
+	plane_to_coord(east.p, north.p, &latitude, &longitude);
+	distance = distance_calculate(latitude, longitude, pvt->latitude, pvt->longitude);
+
+	return distance > CONFIG_STINGSENSE_FIX_FILTER_MAX_SPEED * dt + 3.0 * pvt->accuracy;
+}
+
+/* Sets restarted to the fixes in a row away from the filtered position that restarted the
+ * filter, 0 if it did not restart on a jump.
+ */
+static enum fix_filter_result filter_update(const struct nrf_modem_gnss_pvt_data_frame *pvt,
+					    int64_t uptime_ms, uint32_t *restarted)
+{
+	/* The accuracy is the 1-sigma horizontal error, split over two axes. */
+	double r = (double)pvt->accuracy * pvt->accuracy / 2.0;
+	enum fix_filter_result result = FIX_FILTER_ACCEPTED;
+	double dt;
+	double x;
+	double y;
+	double d2;
+
+	if (initialized && filter_jump(pvt, uptime_ms)) {
+		if (++rejects_in_row < MIN(RESET_REJECTS, fixes_since_reset)) {
+			return FIX_FILTER_REJECTED_JUMP;
+		}
+		*restarted = rejects_in_row;
+		initialized = false;
+	}
+
+	rejects_in_row = 0;
+	altitude = pvt->altitude;
+
+	if (!initialized || uptime_ms - last_update_ms > MAX_GAP_MS) {
+		filter_reset(pvt, r);
+		last_update_ms = uptime_ms;
+		return FIX_FILTER_RESET;
+	}
+
+	dt = (uptime_ms - last_update_ms) / (double)MSEC_PER_SEC;
+	axis_predict(&east, dt);
+	axis_predict(&north, dt);
+
+	plane_from_coord(pvt->latitude, pvt->longitude, &x, &y);
+	d2 = axis_distance2(&east, x, r) + axis_distance2(&north, y, r);
+	if (d2 > DOWNWEIGHT_GATE) {
+		r *= d2 / DOWNWEIGHT_GATE;
+		result = FIX_FILTER_DOWNWEIGHTED;
+	}
+
+	axis_update_position(&east, x, r);
+	axis_update_position(&north, y, r);
+
+	if (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_VELOCITY_VALID) {
+		double rv = MAX((double)pvt->speed_accuracy * pvt->speed_accuracy, 0.01);
+
+		axis_update_velocity(&east, pvt->speed * sin(pvt->heading * DEG_TO_RAD), rv);
+		axis_update_velocity(&north, pvt->speed * cos(pvt->heading * DEG_TO_RAD), rv);
+	}
+
+	if (fabs(east.p) > ORIGIN_MAX_M || fabs(north.p) > ORIGIN_MAX_M) {
+		double latitude;
+		double longitude;
+
+		plane_to_coord(east.p, north.p, &latitude, &longitude);
+		plane_origin_set(latitude, longitude);
+		east.p = 0.0;
+		north.p = 0.0;
+	}
+
+	last_update_ms = uptime_ms;
+	fixes_since_reset++;
+
+	return result;
+}
+
+enum fix_filter_result fix_filter_update(const struct nrf_modem_gnss_pvt_data_frame *pvt,
+					 int64_t uptime_ms)
+{
+	struct gnss_quality quality;
+	enum fix_filter_result result;
+	uint32_t restarted = 0;
+	k_spinlock_key_t key;
+
+	gnss_quality_get(&quality);
+
+	if (pvt->accuracy > CONFIG_STINGSENSE_FIX_FILTER_MAX_ACCURACY) {
+		result = FIX_FILTER_REJECTED_ACCURACY;
+	} else if (quality.hdop > CONFIG_STINGSENSE_FIX_FILTER_MAX_HDOP * 10) {
+		result = FIX_FILTER_REJECTED_HDOP;
+	} else if (quality.used < CONFIG_STINGSENSE_FIX_FILTER_MIN_SATELLITES) {
+		result = FIX_FILTER_REJECTED_SATELLITES;
+	} else {
+		result = FIX_FILTER_ACCEPTED;
+	}
+
+	key = k_spin_lock(&lock);
+	if (result == FIX_FILTER_ACCEPTED) {
+		result = filter_update(pvt, uptime_ms, &restarted);
+	}
+	results[result]++;
+	k_spin_unlock(&lock, key);
+
+	if (restarted > 0) {
+		LOG_DBG("%u fixes in a row away from the filtered position, restarting", restarted);
+	}
+
+	return result;
+}
+
+bool fix_filter_get(struct fix_filter_fix *fix)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool current = initialized && fixes_since_reset >= CONFIRM_FIXES &&
+		       (k_uptime_get() - last_update_ms <= STALE_MS);
+
+	if (current) {
+		double speed = hypot(east.v, north.v);
+
+		if (speed >= HEADING_MIN_SPEED) {
+			heading = atan2(east.v, north.v) / DEG_TO_RAD;
+			if (heading < 0.0) {
+				heading += 360.0;
+			}
+		}
+
+		plane_to_coord(east.p, north.p, &fix->latitude, &fix->longitude);
+		fix->altitude = altitude;
+		fix->speed = speed;
+		fix->heading = heading;
+	}
+	k_spin_unlock(&lock, key);
+
+	return current;
+}
+
+#if defined(CONFIG_SHELL)
+static const char *const result_names[FIX_FILTER_RESULT_COUNT] = {
+	[FIX_FILTER_ACCEPTED] = "accepted",
+	[FIX_FILTER_DOWNWEIGHTED] = "downweighted",
+	[FIX_FILTER_RESET] = "reset",
+	[FIX_FILTER_REJECTED_ACCURACY] = "accuracy",
+	[FIX_FILTER_REJECTED_HDOP] = "hdop",
+	[FIX_FILTER_REJECTED_SATELLITES] = "satellites",
+	[FIX_FILTER_REJECTED_JUMP] = "jump",
+};
+
+static int cmd_fix_filter(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t snapshot[FIX_FILTER_RESULT_COUNT];
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	memcpy(snapshot, results, sizeof(snapshot));
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "result,fixes");
+	for (int i = 0; i < FIX_FILTER_RESULT_COUNT; i++) {
+		shell_print(sh, "%s,%u", result_names[i], snapshot[i]);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(fix_filter, NULL, "Print the fixes accepted and rejected by reason as CSV",
+		   cmd_fix_filter);
+#endif /* CONFIG_SHELL */
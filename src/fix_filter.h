@@ -0,0 +1,68 @@
+#ifndef FIX_FILTER_H_
+#define FIX_FILTER_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * GNSS fix filter.
+ *
+ * Every valid PVT is gated on its accuracy, HDOP and satellites used (gnss_quality.h). A fix
+ * that implies a jump faster than CONFIG_STINGSENSE_FIX_FILTER_MAX_SPEED from the filtered
+ * position is rejected as an outlier, one that is merely unlikely is down-weighted. The
+ * accepted fixes, position and velocity, feed a constant velocity Kalman filter in a local east
+ * and north plane, and the records take the filtered position. The altitude is not filtered,
+ * it is taken from the last accepted fix.
+ */
+
+enum fix_filter_result {
+	FIX_FILTER_ACCEPTED,
+	FIX_FILTER_DOWNWEIGHTED,	/* Accepted with a reduced weight */
+	FIX_FILTER_RESET,		/* Accepted as the new starting point of the filter */
+	FIX_FILTER_REJECTED_ACCURACY,
+	FIX_FILTER_REJECTED_HDOP,
+	FIX_FILTER_REJECTED_SATELLITES,
+	FIX_FILTER_REJECTED_JUMP,
+	FIX_FILTER_RESULT_COUNT
+};
+
+struct fix_filter_fix {
+	double latitude;
+	double longitude;
+	float altitude;		/* Meters, of the last accepted fix, not filtered */
+	float speed;		/* m/s */
+	float heading;		/* Degrees from north */
+};
+
+/**
+ * @brief Feeds a PVT with a valid fix to the filter.
+ *
+ * @details Call gnss_quality_pvt() with the same PVT first.
+ *
+ * @param[in] pvt       PVT with NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID set.
+ * @param[in] uptime_ms Uptime when the PVT was received.
+ *
+ * @return Whether the fix was used, a FIX_FILTER_REJECTED_* result if not.
+ */
+enum fix_filter_result fix_filter_update(const struct nrf_modem_gnss_pvt_data_frame *pvt,
+					 int64_t uptime_ms);
+
+/**
+ * @brief Returns true if the result is an accepted fix.
+ */
+static inline bool fix_filter_accepted(enum fix_filter_result result)
+{
+	return result < FIX_FILTER_REJECTED_ACCURACY;
+}
+
+/**
+ * @brief Returns the filtered fix.
+ *
+ * @param[out] fix Filtered position and velocity.
+ *
+ * @retval true if a fix has been accepted recently.
+ * @retval false if there is no current fix, fix is not set.
+ */
+bool fix_filter_get(struct fix_filter_fix *fix);
+
+#endif /* FIX_FILTER_H_ */
@@ -0,0 +1,199 @@
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/timeutil.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+
+#include "fix_store.h"
+#include "mcc_location_table.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define FIX_STORE_KEY			"fix_store/fix"
+#define EARTH_RADIUS_METERS		(6371.0 * 1000.0)
+#define DEG_TO_RAD			(3.14159265358979323846 / 180.0)
+#define SEC_PER_HOUR			(MIN_PER_HOUR * SEC_PER_MIN)
+
+/* Speed hysteresis for detecting when the bus stops, in m/s. */
+#define FIX_STORE_MOVING_SPEED		3.0f
+#define FIX_STORE_STOPPED_SPEED		0.5f
+/* Fixes closer than this to the stored one are not written, to save flash. */
+#define FIX_STORE_MIN_DISTANCE_M	50.0
+/* A parked bus still refreshes the time of the stored fix at this interval. */
+#define FIX_STORE_REFRESH_S		SEC_PER_HOUR
+/* Assumed road grade for growing the altitude uncertainty with the horizontal one. */
+#define FIX_STORE_ALT_UNC_GRADE		0.05
+#define FIX_STORE_CONFIDENCE		68
+
+struct stored_fix {
+	uint32_t time;			/* Seconds since the Unix epoch (UTC), 0 if not valid */
+	int32_t latitude;		/* 1e-7 degrees */
+	int32_t longitude;		/* 1e-7 degrees */
+	int16_t altitude;		/* Meters */
+	uint16_t accuracy;		/* Meters */
+	uint16_t altitude_accuracy;	/* Meters */
+	uint16_t speed;			/* cm/s */
+};
+
+static struct k_spinlock lock;
+/* Latest fix, and the fix last written to (or read from) settings. */
+static struct stored_fix fix;
+static struct stored_fix saved;
+static int64_t last_save_ms;
+static bool moving;
+static volatile bool inject_enabled = true;
+
+static int fix_store_set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
+{
+	int len;
+
+	if (!key || strcmp(key, "fix")) {
+		return -ENOENT;
+	}
+
+	if (len_rd != sizeof(saved)) {
+		LOG_WRN("Ignoring stored fix with unexpected size %u", (unsigned int)len_rd);
+		return 0;
+	}
+
+	len = read_cb(cb_arg, &saved, sizeof(saved));
+	if (len != sizeof(saved)) {
+		LOG_ERR("Failed to read stored fix from settings");
+		memset(&saved, 0, sizeof(saved));
+		return 0;
+	}
+
+	fix = saved;
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(fix_store, "fix_store", NULL, fix_store_set, NULL, NULL);
+
+static double distance_approx(const struct stored_fix *a, const struct stored_fix *b)
+{
+	double lat = a->latitude / 1e7 * DEG_TO_RAD;
+	double d_lat = (a->latitude - b->latitude) / 1e7 * DEG_TO_RAD;
+	double d_lon = (a->longitude - b->longitude) / 1e7 * DEG_TO_RAD * cos(lat);
+
+	return EARTH_RADIUS_METERS * sqrt(d_lat * d_lat + d_lon * d_lon);
+}
+
+static uint16_t saturate_u16(float value)
+{
+	return (uint16_t)CLAMP(value, 0.0f, (float)UINT16_MAX);
+}
+
+void fix_store_update(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	struct tm tm = {
+		.tm_year = pvt->datetime.year - 1900,
+		.tm_mon = pvt->datetime.month - 1,
+		.tm_mday = pvt->datetime.day,
+		.tm_hour = pvt->datetime.hour,
+		.tm_min = pvt->datetime.minute,
+		.tm_sec = pvt->datetime.seconds,
+	};
+	struct stored_fix new_fix = {
+		.time = (uint32_t)timeutil_timegm64(&tm),
+		.latitude = (int32_t)lround(pvt->latitude * 1e7),
+		.longitude = (int32_t)lround(pvt->longitude * 1e7),
+		.altitude = (int16_t)CLAMP(pvt->altitude, INT16_MIN, INT16_MAX),
+		.accuracy = saturate_u16(ceilf(pvt->accuracy)),
+		.altitude_accuracy = saturate_u16(ceilf(pvt->altitude_accuracy)),
+		.speed = saturate_u16(pvt->speed * 100.0f),
+	};
+	bool stopped = false;
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+	int err;
+
+	key = k_spin_lock(&lock);
+	fix = new_fix;
+	k_spin_unlock(&lock, key);
+
+	if (moving && pvt->speed < FIX_STORE_STOPPED_SPEED) {
+		moving = false;
+		stopped = true;
+	} else if (!moving && pvt->speed > FIX_STORE_MOVING_SPEED) {
+		moving = true;
+	}
+
+	if (saved.time != 0) {
+		bool moved = distance_approx(&new_fix, &saved) >= FIX_STORE_MIN_DISTANCE_M;
+		bool due = last_save_ms == 0 ||
+			   now - last_save_ms >= CONFIG_GNSS_SAMPLE_FIX_STORE_INTERVAL * MSEC_PER_SEC;
+
+		if (!(moved && (stopped || due)) &&
+		    !(due && new_fix.time - saved.time >= FIX_STORE_REFRESH_S)) {
+			return;
+		}
+	}
+
+	err = settings_save_one(FIX_STORE_KEY, &new_fix, sizeof(new_fix));
+	if (err) {
+		LOG_ERR("Failed to write fix to settings, error %d", err);
+		return;
+	}
+
+	saved = new_fix;
+	last_save_ms = now;
+
+	LOG_DBG("Stored fix%s", stopped ? " on stop" : "");
+}
+
+int fix_store_location_get(int64_t utc_sec, struct nrf_modem_gnss_agnss_data_location *location,
+			   uint32_t *unc_m)
+{
+	struct stored_fix current;
+	int64_t age;
+	double speed;
+	double unc;
+	double unc_altitude;
+	k_spinlock_key_t key;
+
+	if (!inject_enabled) {
+		return -ENOENT;
+	}
+
+	key = k_spin_lock(&lock);
+	current = fix;
+	k_spin_unlock(&lock, key);
+
+	if (current.time == 0) {
+		return -ENOENT;
+	}
+
+	age = MAX(utc_sec - (int64_t)current.time, 0);
+	if (age > (int64_t)CONFIG_GNSS_SAMPLE_FIX_STORE_MAX_AGE * SEC_PER_HOUR) {
+		return -ETIME;
+	}
+
+	/* A fix stored while moving means the device was reset on the road, otherwise the bus
+	 * was parked and is not expected to have moved much.
+	 */
+	speed = MAX(current.speed / 100.0,
+		    CONFIG_GNSS_SAMPLE_FIX_STORE_UNC_GROWTH / (double)SEC_PER_HOUR);
+	unc = current.accuracy + age * speed;
+	unc_altitude = current.altitude_accuracy +
+		       (unc - current.accuracy) * FIX_STORE_ALT_UNC_GRADE;
+
+	location->latitude = lat_convert(current.latitude / 1e7f);
+	location->longitude = lon_convert(current.longitude / 1e7f);
+	location->altitude = current.altitude;
+	location->unc_semimajor = unc_convert(unc);
+	location->unc_semiminor = location->unc_semimajor;
+	location->orientation_major = 0;
+	location->unc_altitude = unc_altitude_convert(unc_altitude);
+	location->confidence = FIX_STORE_CONFIDENCE;
+
+	*unc_m = (uint32_t)MIN(unc, UINT32_MAX);
+
+	return 0;
+}
+
+void fix_store_inject_enable(bool enable)
+{
+	inject_enabled = enable;
+}
@@ -0,0 +1,41 @@
+#ifndef FIX_STORE_H_
+#define FIX_STORE_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * @brief Updates the stored fix with a valid PVT.
+ *
+ * @details The fix is kept in RAM and written to settings every
+ *          CONFIG_GNSS_SAMPLE_FIX_STORE_INTERVAL seconds while the position changes, and when
+ *          the bus comes to a stop. The device loses power with the ignition, so the fix written
+ *          at the last stop is the one used after the next boot.
+ *
+ * @param[in] pvt PVT with a valid fix.
+ */
+void fix_store_update(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Returns the stored fix as location assistance.
+ *
+ * @details The uncertainty of the stored fix grows with its age, with the speed of the bus when
+ *          it was stored or with CONFIG_GNSS_SAMPLE_FIX_STORE_UNC_GROWTH for a parked bus.
+ *
+ * @param[in]  utc_sec  Current time in seconds since the Unix epoch.
+ * @param[out] location Location assistance data.
+ * @param[out] unc_m    Horizontal uncertainty in meters.
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if no fix has been stored or injecting it has been disabled.
+ * @retval -ETIME if the stored fix is older than CONFIG_GNSS_SAMPLE_FIX_STORE_MAX_AGE.
+ */
+int fix_store_location_get(int64_t utc_sec, struct nrf_modem_gnss_agnss_data_location *location,
+			   uint32_t *unc_m);
+
+/**
+ * @brief Enables or disables injecting the stored fix, used to compare TTFF with and without it.
+ */
+void fix_store_inject_enable(bool enable);
+
+#endif /* FIX_STORE_H_ */
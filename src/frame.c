@@ -0,0 +1,185 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_output.h>
+#include <zephyr/logging/log_output_dict.h>
+
+#include "frame.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define FRAME_HEADER_SIZE	3
+#define FRAME_CRC_SIZE		2
+#define FRAME_RAW_MAX		(FRAME_HEADER_SIZE + FRAME_PAYLOAD_MAX + FRAME_CRC_SIZE)
+/* COBS adds one byte per 254 bytes and one at the start, plus the zero delimiters. */
+#define FRAME_ENCODED_MAX	(FRAME_RAW_MAX + FRAME_RAW_MAX / 254 + 3)
+
+static const struct device *const uart = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+static K_MUTEX_DEFINE(frame_mutex);
+static uint8_t raw[FRAME_RAW_MAX];
+static uint8_t encoded[FRAME_ENCODED_MAX];
+static uint16_t sequence;
+/* After a panic frames are written from the panicking context, without locking. */
+static bool panic_mode;
+
+/* COBS encodes len bytes of src into dst and returns the encoded length. */
+static size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+	size_t code_pos = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+
+	for (size_t i = 0; i < len; i++) {
+		if (src[i] == 0) {
+			dst[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+			continue;
+		}
+
+		dst[out++] = src[i];
+		if (++code == 0xff) {
+			dst[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+		}
+	}
+	dst[code_pos] = code;
+
+	return out;
+}
+
+int frame_send(enum frame_type type, const void *payload, size_t len)
+{
+	bool locked = !panic_mode;
+	size_t raw_len;
+	size_t encoded_len;
+
+	if (len > FRAME_PAYLOAD_MAX) {
+		return -EMSGSIZE;
+	}
+
+	/* An interrupt can't take the mutex, and may have preempted a thread in the middle of a
+	 * frame in the shared buffers.
+	 */
+	if (locked && k_is_in_isr()) {
+		return -EWOULDBLOCK;
+	}
+
+	if (locked) {
+		k_mutex_lock(&frame_mutex, K_FOREVER);
+	}
+
+	raw[0] = type;
+	sys_put_le16(sequence++, &raw[1]);
+	memcpy(&raw[FRAME_HEADER_SIZE], payload, len);
+	raw_len = FRAME_HEADER_SIZE + len;
+	sys_put_le16(crc16_itu_t(0xffff, raw, raw_len), &raw[raw_len]);
+	raw_len += FRAME_CRC_SIZE;
+
+	/* A leading delimiter as well, so that text written in between frames (shell, AT host)
+	 * doesn't take the next frame with it.
+	 */
+	encoded[0] = 0;
+	encoded_len = 1 + cobs_encode(raw, raw_len, &encoded[1]);
+	encoded[encoded_len++] = 0;
+
+	for (size_t i = 0; i < encoded_len; i++) {
+		uart_poll_out(uart, encoded[i]);
+	}
+
+	if (locked) {
+		k_mutex_unlock(&frame_mutex);
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_LOG)
+/* Log backend that sends each dictionary log message in a frame of its own, in place of the
+ * UART backend that would write the messages unframed in between.
+ */
+
+static uint8_t log_msg[FRAME_PAYLOAD_MAX];
+static size_t log_msg_len;
+static uint8_t log_output_buf[64];
+
+static int log_msg_out(uint8_t *data, size_t length, void *ctx)
+{
+	size_t copy = MIN(length, sizeof(log_msg) - log_msg_len);
+
+	ARG_UNUSED(ctx);
+
+	memcpy(&log_msg[log_msg_len], data, copy);
+	log_msg_len += copy;
+
+	return length;
+}
+
+LOG_OUTPUT_DEFINE(frame_log_output, log_msg_out, log_output_buf, sizeof(log_output_buf));
+
+/* Messages are processed one at a time by the log thread, or by the panicking context. */
+static void log_msg_send(void)
+{
+	log_output_flush(&frame_log_output);
+	if (log_msg_len < sizeof(log_msg)) {
+		(void)frame_send(FRAME_TYPE_LOG, log_msg, log_msg_len);
+	}
+	/* A message that doesn't fit in a frame is lost, the host sees a broken sequence. */
+	log_msg_len = 0;
+}
+
+static void frame_log_process(const struct log_backend *const backend,
+			      union log_msg_generic *msg)
+{
+	log_dict_output_msg_process(&frame_log_output, &msg->log, 0);
+	log_msg_send();
+}
+
+static void frame_log_dropped(const struct log_backend *const backend, uint32_t cnt)
+{
+	log_dict_output_dropped_process(&frame_log_output, cnt);
+	log_msg_send();
+}
+
+static void frame_log_panic(const struct log_backend *const backend)
+{
+	panic_mode = true;
+}
+
+static const struct log_backend_api frame_log_api = {
+	.process = frame_log_process,
+	.dropped = frame_log_dropped,
+	.panic = frame_log_panic,
+};
+
+LOG_BACKEND_DEFINE(frame_log_backend, frame_log_api, true);
+
+static int frame_init(void)
+{
+	const struct log_backend *uart_backend = log_backend_get_by_name("log_backend_uart");
+
+	/* Start the backends first, they are started by the log thread otherwise, which would
+	 * start the UART backend again.
+	 */
+	log_init();
+	if (uart_backend != NULL) {
+		log_backend_disable(uart_backend);
+	}
+
+	return 0;
+}
+
+/* Runs before main() and before the log thread first runs, so that no message is written
+ * unframed.
+ */
+SYS_INIT(frame_init, APPLICATION, 0);
+#endif /* CONFIG_LOG */
@@ -0,0 +1,45 @@
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * Framed serial output.
+ *
+ * Every frame is COBS encoded and sent between zero bytes, so the host finds the start of the
+ * next frame after any corruption. Before encoding a frame holds:
+ *
+ *   type (1) | sequence number (2) | payload | CRC-16 (2)
+ *
+ * Multi-byte fields are little endian. The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, seed
+ * 0xffff) over the type, sequence number and payload. The sequence number counts all frames, so
+ * the host detects lost frames of any type. See serial_frames.py for the host decoder.
+ */
+
+/** @brief Payload types. */
+enum frame_type {
+	FRAME_TYPE_SENSOR = 1,	/* struct sensor_record */
+	FRAME_TYPE_HEALTH = 2,	/* struct health_record */
+	FRAME_TYPE_LOG = 3,	/* Binary dictionary log message */
+};
+
+/* Largest payload of a frame. */
+#define FRAME_PAYLOAD_MAX	256
+
+/**
+ * @brief Sends a frame on the console UART.
+ *
+ * @details Frames are written whole, also when sent from several threads. Callable from
+ *          interrupt context after a panic only.
+ *
+ * @param[in] type    Payload type.
+ * @param[in] payload Payload.
+ * @param[in] len     Payload length, at most FRAME_PAYLOAD_MAX.
+ *
+ * @retval 0 on success.
+ * @retval -EMSGSIZE if the payload is too long.
+ * @retval -EWOULDBLOCK if called from interrupt context before a panic, nothing is sent.
+ */
+int frame_send(enum frame_type type, const void *payload, size_t len);
+
+#endif /* FRAME_H_ */
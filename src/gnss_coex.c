@@ -0,0 +1,143 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "gnss_coex.h"
+#include "tx_sched.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* A periodic gap is closed this long before the predicted wakeup, so that the LTE activity
+ * started in the gap is over when GNSS starts searching.
+ */
+#define GAP_WAKEUP_MARGIN_MS	5000
+/* A duty cycled gap lasts until the next PVT is due, with some slack. */
+#define GAP_PVT_MS		1500
+/* GNSS that has not slept for this many fix intervals runs without gaps. */
+#define GAP_EXPECTED_INTERVALS	3
+/* GNSS that has not produced a PVT for this long is not running. */
+#define PVT_TIMEOUT_MS		5000
+
+#define PVT_BLOCKED_MASK	(NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED | \
+				 NRF_MODEM_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME)
+
+static struct k_spinlock lock;
+static uint32_t fix_interval_ms = MSEC_PER_SEC;
+static bool sleeping;		/* Between a sleep event and the next PVT */
+static int64_t wakeup_ms;	/* First PVT of the current fix */
+static int64_t gap_until_ms;
+static int64_t last_gap_ms;
+static int64_t last_pvt_ms;
+
+/* Since boot. */
+static uint32_t pvts;
+static uint32_t blocked;
+static uint32_t blocked_connected;	/* Blocked while an RRC connection was up */
+static uint32_t gaps;
+
+/* Opens a gap until the given time. Called with the lock held, returns true for a new gap. */
+static bool gap_open(int64_t now, int64_t until)
+{
+	bool opened = (now >= gap_until_ms);
+
+	if (opened) {
+		gaps++;
+	}
+	gap_until_ms = until;
+	last_gap_ms = now;
+
+	return opened;
+}
+
+void gnss_coex_init(uint16_t fix_interval)
+{
+	fix_interval_ms = MAX(fix_interval, 1) * MSEC_PER_SEC;
+}
+
+void gnss_coex_pvt(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	bool opened = false;
+
+	last_pvt_ms = now;
+	pvts++;
+
+	if (pvt->flags & PVT_BLOCKED_MASK) {
+		blocked++;
+		if (tx_sched_connected()) {
+			blocked_connected++;
+		}
+	}
+
+	if (sleeping) {
+		/* Woke up for the next periodic fix. */
+		sleeping = false;
+		wakeup_ms = now;
+	}
+
+	if (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_SLEEP_BETWEEN_PVT) {
+		/* Duty cycled tracking, GNSS sleeps until the next PVT. */
+		opened = gap_open(now, now + GAP_PVT_MS);
+	} else {
+		gap_until_ms = 0;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (opened) {
+		tx_sched_gap_open();
+	}
+}
+
+void gnss_coex_sleep(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	int64_t next_wakeup = (wakeup_ms > 0 ? wakeup_ms : now) + fix_interval_ms;
+	bool opened;
+
+	sleeping = true;
+	opened = gap_open(now, MAX(next_wakeup - GAP_WAKEUP_MARGIN_MS, now));
+	k_spin_unlock(&lock, key);
+
+	if (opened) {
+		tx_sched_gap_open();
+	}
+}
+
+bool gnss_coex_gap_open(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	bool open = (now < gap_until_ms) ||
+		    (!sleeping && now - last_pvt_ms > PVT_TIMEOUT_MS) ||
+		    (now - last_gap_ms > GAP_EXPECTED_INTERVALS * fix_interval_ms);
+
+	k_spin_unlock(&lock, key);
+
+	return open;
+}
+
+static int cmd_gnss_coex(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t snapshot_pvts = pvts;
+	uint32_t snapshot_blocked = blocked;
+	uint32_t snapshot_blocked_connected = blocked_connected;
+	uint32_t snapshot_gaps = gaps;
+
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "pvts,blocked,blocked_connected,blocked_pct,gaps,gap_open");
+	shell_print(sh, "%u,%u,%u,%.2f,%u,%d", snapshot_pvts, snapshot_blocked,
+		    snapshot_blocked_connected,
+		    snapshot_pvts ? 100.0 * snapshot_blocked / snapshot_pvts : 0.0, snapshot_gaps,
+		    gnss_coex_gap_open());
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(gnss_coex, NULL,
+		   "Print the PVTs blocked by LTE and the GNSS sleep gaps since boot as CSV",
+		   cmd_gnss_coex);
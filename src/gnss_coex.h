@@ -0,0 +1,46 @@
+#ifndef GNSS_COEX_H_
+#define GNSS_COEX_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * GNSS and LTE coexistence.
+ *
+ * GNSS and LTE share the radio, and LTE has priority: while LTE is active GNSS misses its PVT
+ * deadlines (NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED) or gets too little time to track
+ * (NRF_MODEM_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME). GNSS sleeps between fixes in periodic mode,
+ * and between PVTs with duty cycled tracking (NRF_MODEM_GNSS_PVT_FLAG_SLEEP_BETWEEN_PVT). Those
+ * sleep gaps are tracked here, and the transmit scheduler holds back uplinks that have run out
+ * of time to wait for a connection until the next gap opens.
+ */
+
+/**
+ * @brief Sets the GNSS fix schedule.
+ *
+ * @param[in] fix_interval Fix interval in seconds, 1 for continuous tracking.
+ */
+void gnss_coex_init(uint16_t fix_interval);
+
+/**
+ * @brief Tracks the sleep gaps and blocked PVTs from a PVT frame.
+ */
+void gnss_coex_pvt(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Opens a sleep gap until the next periodic fix.
+ *
+ * @details Called on NRF_MODEM_GNSS_EVT_SLEEP_AFTER_FIX and NRF_MODEM_GNSS_EVT_SLEEP_AFTER_TIMEOUT.
+ *          Callable from interrupt context.
+ */
+void gnss_coex_sleep(void);
+
+/**
+ * @brief Returns true if LTE can transmit now without blocking GNSS.
+ *
+ * @details True in a sleep gap, and also when GNSS runs without gaps or not at all, because
+ *          waiting would not help then.
+ */
+bool gnss_coex_gap_open(void);
+
+#endif /* GNSS_COEX_H_ */
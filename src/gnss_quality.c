@@ -0,0 +1,352 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "gnss_quality.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* GSV has up to 4 satellites of 4 fields each, GSA up to 18 fields with the system ID. */
+#define NMEA_MAX_FIELDS		20
+
+/* Fields of $--GSA: PRNs from 3 to 14, then PDOP, HDOP and VDOP. */
+#define GSA_PDOP		15
+#define GSA_HDOP		16
+#define GSA_VDOP		17
+/* Fields of $--GSV: message count and number, satellites in view, then 4 fields per satellite
+ * with the SNR (C/N0 in dB-Hz) last.
+ */
+#define GSV_MSG_COUNT		1
+#define GSV_MSG_NUM		2
+#define GSV_IN_VIEW		3
+#define GSV_SV_FIRST		4
+#define GSV_SV_FIELDS		4
+#define GSV_SV_SNR		3
+
+/* Score ranges: full points from this many satellites, C/N0 and HDOP. */
+#define SCORE_USED_FULL		10
+#define SCORE_CN0_MIN		20
+#define SCORE_CN0_FULL		45
+#define SCORE_HDOP_FULL		100	/* x100 */
+#define SCORE_HDOP_ZERO		600	/* x100 */
+
+static struct k_spinlock lock;
+static uint16_t nmea_mask = CONFIG_STINGSENSE_NMEA_MASK;
+static struct gnss_quality quality;
+
+/* C/N0 of the GSV messages received so far in the current group. */
+static uint16_t gsv_cn0_sum;
+static uint8_t gsv_cn0_count;
+
+uint16_t gnss_quality_nmea_get(void)
+{
+	return nmea_mask;
+}
+
+int gnss_quality_nmea_set(uint16_t mask)
+{
+	int err = nrf_modem_gnss_nmea_mask_set(mask);
+
+	if (err != 0 && nrf_modem_gnss_stop() == 0) {
+		/* Not taken while GNSS is running. The stop fails when GNSS is stopped already, main.c
+		 * then owns the next start, between TTFF runs or in periodic sleep.
+		 */
+		err = nrf_modem_gnss_nmea_mask_set(mask);
+		if (nrf_modem_gnss_start() != 0) {
+			LOG_ERR("Failed to restart GNSS");
+		}
+	}
+
+	if (err != 0) {
+		LOG_ERR("Failed to set GNSS NMEA mask, error: %d", err);
+		return -EIO;
+	}
+
+	nmea_mask = mask;
+
+	return 0;
+}
+
+static uint16_t dop_x100(float dop)
+{
+	return CLAMP(dop * 100.0f + 0.5f, 0, UINT16_MAX);
+}
+
+void gnss_quality_pvt(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t cn0_sum = 0;
+
+	quality.tracked = 0;
+	quality.used = 0;
+	quality.unhealthy = 0;
+
+	for (int i = 0; i < NRF_MODEM_GNSS_MAX_SATELLITES; i++) {
+		if (pvt->sv[i].sv == 0) {
+			continue;
+		}
+
+		quality.tracked++;
+		if (pvt->sv[i].flags & NRF_MODEM_GNSS_SV_FLAG_USED_IN_FIX) {
+			quality.used++;
+			cn0_sum += pvt->sv[i].cn0;	/* 0.1 dB-Hz */
+		}
+		if (pvt->sv[i].flags & NRF_MODEM_GNSS_SV_FLAG_UNHEALTHY) {
+			quality.unhealthy++;
+		}
+	}
+
+	if (!(nmea_mask & NRF_MODEM_GNSS_NMEA_GSV_MASK)) {
+		quality.cn0 = quality.used ? cn0_sum / (10 * quality.used) : 0;
+	}
+	if (!(nmea_mask & NRF_MODEM_GNSS_NMEA_GSA_MASK)) {
+		quality.pdop = dop_x100(pvt->pdop);
+		quality.hdop = dop_x100(pvt->hdop);
+		quality.vdop = dop_x100(pvt->vdop);
+	}
+	k_spin_unlock(&lock, key);
+}
+
+/* Checks the checksum of a sentence and splits it in place at the commas. Returns the number
+ * of fields, the first one being the talker and sentence type, or 0 for a malformed sentence.
+ */
+static int nmea_split(char *sentence, char *fields[], int max_fields)
+{
+	uint8_t checksum = 0;
+	uint8_t high;
+	uint8_t low;
+	char *p;
+	int count;
+
+	if (sentence[0] != '$') {
+		return 0;
+	}
+
+	for (p = sentence + 1; *p != '\0' && *p != '*'; p++) {
+		checksum ^= *p;
+	}
+
+	if (*p != '*' || char2hex(p[1], &high) != 0 || char2hex(p[2], &low) != 0 ||
+	    checksum != ((high << 4) | low)) {
+		return 0;
+	}
+	*p = '\0';
+
+	fields[0] = sentence + 1;
+	count = 1;
+	for (p = sentence + 1; *p != '\0'; p++) {
+		if (*p == ',') {
+			*p = '\0';
+			if (count < max_fields) {
+				fields[count++] = p + 1;
+			}
+		}
+	}
+
+	return count;
+}
+
+/* Parses a decimal field with up to two decimals, times 100. Returns -1 for an empty field. */
+static int32_t nmea_x100(const char *field)
+{
+	int32_t value = 0;
+	int decimals = -1;
+
+	if (*field == '\0') {
+		return -1;
+	}
+
+	for (; *field != '\0' && decimals < 2; field++) {
+		if (*field == '.') {
+			decimals = 0;
+		} else if (*field >= '0' && *field <= '9') {
+			value = value * 10 + (*field - '0');
+			if (decimals >= 0) {
+				decimals++;
+			}
+		} else {
+			return -1;
+		}
+	}
+
+	for (decimals = MAX(decimals, 0); decimals < 2; decimals++) {
+		value *= 10;
+	}
+
+	return MIN(value, UINT16_MAX);
+}
+
+static void gsa_parse(char *fields[], int count)
+{
+	int32_t pdop;
+	int32_t hdop;
+	int32_t vdop;
+
+	if (count <= GSA_VDOP) {
+		return;
+	}
+
+	pdop = nmea_x100(fields[GSA_PDOP]);
+	hdop = nmea_x100(fields[GSA_HDOP]);
+	vdop = nmea_x100(fields[GSA_VDOP]);
+	if (pdop < 0 || hdop < 0 || vdop < 0) {
+		return;
+	}
+
+	quality.pdop = pdop;
+	quality.hdop = hdop;
+	quality.vdop = vdop;
+}
+
+static void gsv_parse(char *fields[], int count)
+{
+	int32_t msg_count;
+	int32_t msg_num;
+
+	if (count <= GSV_IN_VIEW) {
+		return;
+	}
+
+	msg_count = nmea_x100(fields[GSV_MSG_COUNT]) / 100;
+	msg_num = nmea_x100(fields[GSV_MSG_NUM]) / 100;
+
+	if (msg_num == 1) {
+		gsv_cn0_sum = 0;
+		gsv_cn0_count = 0;
+	}
+
+	for (int i = GSV_SV_FIRST + GSV_SV_SNR; i < count; i += GSV_SV_FIELDS) {
+		int32_t snr = nmea_x100(fields[i]);
+
+		if (snr > 0) {
+			gsv_cn0_sum += snr / 100;
+			gsv_cn0_count++;
+		}
+	}
+
+	if (msg_num == msg_count) {
+		quality.in_view = MAX(nmea_x100(fields[GSV_IN_VIEW]) / 100, 0);
+		quality.cn0 = gsv_cn0_count ? gsv_cn0_sum / gsv_cn0_count : 0;
+	}
+}
+
+void gnss_quality_nmea(char *sentence)
+{
+	char *fields[NMEA_MAX_FIELDS];
+	int count = nmea_split(sentence, fields, ARRAY_SIZE(fields));
+	k_spinlock_key_t key;
+
+	/* The talker ID is two characters, GP, GL, GN or QZ. */
+	if (count == 0 || strlen(fields[0]) != 5) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	if (strcmp(fields[0] + 2, "GSA") == 0) {
+		gsa_parse(fields, count);
+	} else if (strcmp(fields[0] + 2, "GSV") == 0) {
+		gsv_parse(fields, count);
+	}
+	k_spin_unlock(&lock, key);
+}
+
+void gnss_quality_get(struct gnss_quality *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*out = quality;
+	k_spin_unlock(&lock, key);
+}
+
+uint8_t gnss_quality_score(void)
+{
+	struct gnss_quality q;
+	uint32_t score;
+
+	gnss_quality_get(&q);
+
+	score = 40 * MIN(q.used, SCORE_USED_FULL) / SCORE_USED_FULL;
+	score += 30 * (CLAMP(q.cn0, SCORE_CN0_MIN, SCORE_CN0_FULL) - SCORE_CN0_MIN) /
+		 (SCORE_CN0_FULL - SCORE_CN0_MIN);
+	if (q.hdop > 0) {
+		score += 30 * (SCORE_HDOP_ZERO - CLAMP(q.hdop, SCORE_HDOP_FULL, SCORE_HDOP_ZERO)) /
+			 (SCORE_HDOP_ZERO - SCORE_HDOP_FULL);
+	}
+
+	return score;
+}
+
+#if defined(CONFIG_SHELL)
+static const struct {
+	const char *name;
+	uint16_t mask;
+} nmea_sentences[] = {
+	{ "gga", NRF_MODEM_GNSS_NMEA_GGA_MASK },
+	{ "gll", NRF_MODEM_GNSS_NMEA_GLL_MASK },
+	{ "gsa", NRF_MODEM_GNSS_NMEA_GSA_MASK },
+	{ "gsv", NRF_MODEM_GNSS_NMEA_GSV_MASK },
+	{ "rmc", NRF_MODEM_GNSS_NMEA_RMC_MASK },
+};
+
+static int cmd_nmea(const struct shell *sh, size_t argc, char **argv)
+{
+	uint16_t mask = 0;
+
+	for (size_t i = 1; i < argc; i++) {
+		size_t j;
+
+		if (strcmp(argv[i], "none") == 0) {
+			continue;
+		}
+		for (j = 0; j < ARRAY_SIZE(nmea_sentences); j++) {
+			if (strcmp(argv[i], nmea_sentences[j].name) == 0) {
+				mask |= nmea_sentences[j].mask;
+				break;
+			}
+		}
+		if (j == ARRAY_SIZE(nmea_sentences)) {
+			shell_error(sh, "Unknown sentence: %s", argv[i]);
+			return -EINVAL;
+		}
+	}
+
+	if (argc > 1 && gnss_quality_nmea_set(mask) != 0) {
+		shell_error(sh, "Failed to set the NMEA mask");
+		return -EIO;
+	}
+
+	mask = gnss_quality_nmea_get();
+	shell_fprintf(sh, SHELL_NORMAL, "NMEA:");
+	for (size_t j = 0; j < ARRAY_SIZE(nmea_sentences); j++) {
+		if (mask & nmea_sentences[j].mask) {
+			shell_fprintf(sh, SHELL_NORMAL, " %s", nmea_sentences[j].name);
+		}
+	}
+	shell_print(sh, "%s", mask ? "" : " none");
+
+	return 0;
+}
+
+static int cmd_gnss_quality(const struct shell *sh, size_t argc, char **argv)
+{
+	struct gnss_quality q;
+
+	gnss_quality_get(&q);
+
+	shell_print(sh, "tracked,used,unhealthy,in_view,cn0,pdop,hdop,vdop,score");
+	shell_print(sh, "%u,%u,%u,%u,%u,%u.%02u,%u.%02u,%u.%02u,%u", q.tracked, q.used,
+		    q.unhealthy, q.in_view, q.cn0, q.pdop / 100, q.pdop % 100, q.hdop / 100,
+		    q.hdop % 100, q.vdop / 100, q.vdop % 100, gnss_quality_score());
+
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(nmea, NULL,
+		       "Print or set the NMEA sentences: nmea [none|gga|gll|gsa|gsv|rmc]...",
+		       cmd_nmea, 1, ARRAY_SIZE(nmea_sentences));
+SHELL_CMD_REGISTER(gnss_quality, NULL, "Print the latest fix quality as CSV",
+		   cmd_gnss_quality);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,72 @@
+#ifndef GNSS_QUALITY_H_
+#define GNSS_QUALITY_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * GNSS fix quality.
+ *
+ * Satellite counts come from the PVT. The dilution of precision and the C/N0 come from the GSA
+ * and GSV sentences when those are enabled in the NMEA mask, and from the PVT otherwise. NMEA
+ * output is off by default, it is set per sentence type at runtime with gnss_quality_nmea_set()
+ * or the "nmea" shell command.
+ */
+
+struct gnss_quality {
+	uint8_t tracked;
+	uint8_t used;		/* Used in the fix */
+	uint8_t unhealthy;
+	uint8_t in_view;	/* From GSV, 0 without */
+	uint8_t cn0;		/* Mean C/N0 in dB-Hz, of the satellites used (PVT) or in view (GSV) */
+	uint16_t pdop;		/* x100 */
+	uint16_t hdop;		/* x100 */
+	uint16_t vdop;		/* x100 */
+};
+
+/**
+ * @brief Returns the NMEA mask, NRF_MODEM_GNSS_NMEA_*_MASK bits.
+ */
+uint16_t gnss_quality_nmea_get(void);
+
+/**
+ * @brief Sets the NMEA sentences output by GNSS.
+ *
+ * @details If the modem does not take the mask while GNSS is running, GNSS is stopped, the mask
+ *          set and GNSS started again. GNSS that was stopped is never started.
+ *
+ * @param[in] mask NRF_MODEM_GNSS_NMEA_*_MASK bits, 0 for no NMEA output.
+ *
+ * @retval 0 on success.
+ * @retval -errno on failure.
+ */
+int gnss_quality_nmea_set(uint16_t mask);
+
+/**
+ * @brief Updates the satellite counts, and the DOP and C/N0 not taken from NMEA, from a PVT.
+ */
+void gnss_quality_pvt(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Parses a GSA or GSV sentence, others are ignored.
+ *
+ * @details The sentence is split in place and is unusable afterwards.
+ *
+ * @param[in,out] sentence NMEA sentence, NUL terminated.
+ */
+void gnss_quality_nmea(char *sentence);
+
+/**
+ * @brief Returns the latest fix quality.
+ */
+void gnss_quality_get(struct gnss_quality *quality);
+
+/**
+ * @brief Returns a fix quality score for the sensor record.
+ *
+ * @details 0 to 100, from the satellites used (up to 40), the C/N0 (up to 30) and the HDOP (up
+ *          to 30). Only meaningful with a valid fix.
+ */
+uint8_t gnss_quality_score(void);
+
+#endif /* GNSS_QUALITY_H_ */
@@ -0,0 +1,289 @@
+#include <stdarg.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/sys_heap.h>
+#include <zephyr/logging/log.h>
+
+#include "health.h"
+#include "profile.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define HEALTH_INTERVAL_MS	(CONFIG_STINGSENSE_HEALTH_INTERVAL * MSEC_PER_SEC)
+#define WORKQ_PROBE_INTERVAL	K_SECONDS(1)
+
+/* Newer kernels define K_HEAP_MEM_POOL_SIZE, which also counts the heap that subsystems ask for. */
+#if defined(K_HEAP_MEM_POOL_SIZE)
+#define HEALTH_HEAP_SIZE	K_HEAP_MEM_POOL_SIZE
+#else
+#define HEALTH_HEAP_SIZE	CONFIG_HEAP_MEM_POOL_SIZE
+#endif
+
+/* The system heap used by k_malloc() is private to the kernel (kernel/mempool.c) and has no
+ * public accessor, so this depends on its name. It only exists when the heap has a size, and its
+ * statistics only with CONFIG_SYS_HEAP_RUNTIME_STATS. Without either, the heap fields stay 0.
+ */
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS) && HEALTH_HEAP_SIZE > 0
+#define HEALTH_HEAP_STATS	1
+extern struct k_heap _system_heap;
+#else
+#define HEALTH_HEAP_STATS	0
+#endif
+
+static const char *const thread_names[HEALTH_THREAD_COUNT] = {
+	[HEALTH_THREAD_MAIN] = "main",
+	[HEALTH_THREAD_GNSS_WORKQ] = "gnss_wq",
+	[HEALTH_THREAD_ASSIST_WORKQ] = "assist_wq",
+	[HEALTH_THREAD_SYSWORKQ] = "sysworkq",
+};
+
+static const char *const workq_names[HEALTH_WORKQ_COUNT] = {
+	[HEALTH_WORKQ_GNSS] = "gnss_wq",
+	[HEALTH_WORKQ_ASSIST] = "assist_wq",
+	[HEALTH_WORKQ_SYS] = "sysworkq",
+};
+
+static const char *const msgq_names[HEALTH_MSGQ_COUNT] = {
+	[HEALTH_MSGQ_NMEA] = "nmea",
+};
+
+static struct k_spinlock lock;
+static k_tid_t threads[HEALTH_THREAD_COUNT];
+static struct k_msgq *msgqs[HEALTH_MSGQ_COUNT];
+static uint32_t msgq_peak[HEALTH_MSGQ_COUNT];
+static uint32_t msgq_drops[HEALTH_MSGQ_COUNT];
+static uint32_t gnss_pvts;
+static uint32_t gnss_blocked;
+static int64_t next_record_ms = HEALTH_INTERVAL_MS;
+
+struct workq_probe {
+	struct k_work work;
+	struct k_work_q *queue;
+	int64_t submitted;	/* Uptime ticks, the 32-bit cycle count wraps within minutes */
+	uint32_t latency_max_us;
+	uint64_t latency_sum_us;
+	uint32_t count;
+};
+
+static struct workq_probe probes[HEALTH_WORKQ_COUNT];
+
+static void probe_work_fn(struct k_work *work)
+{
+	struct workq_probe *probe = CONTAINER_OF(work, struct workq_probe, work);
+	uint32_t latency_us = MIN(k_ticks_to_us_floor64(k_uptime_ticks() - probe->submitted),
+				  UINT32_MAX);
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	probe->latency_max_us = MAX(probe->latency_max_us, latency_us);
+	probe->latency_sum_us += latency_us;
+	probe->count++;
+
+	k_spin_unlock(&lock, key);
+}
+
+static void probe_timer_fn(struct k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	for (int i = 0; i < HEALTH_WORKQ_COUNT; i++) {
+		/* A probe still queued from the previous round keeps its submit time, so a blocked
+		 * work queue shows the whole time it was blocked.
+		 */
+		if (probes[i].queue == NULL || k_work_is_pending(&probes[i].work)) {
+			continue;
+		}
+
+		probes[i].submitted = k_uptime_ticks();
+		(void)k_work_submit_to_queue(probes[i].queue, &probes[i].work);
+	}
+}
+
+static K_TIMER_DEFINE(probe_timer, probe_timer_fn, NULL);
+
+void health_thread_set(enum health_thread id, k_tid_t thread)
+{
+	threads[id] = thread;
+}
+
+void health_workq_set(enum health_workq id, struct k_work_q *queue)
+{
+	k_work_init(&probes[id].work, probe_work_fn);
+	probes[id].queue = queue;
+
+	if (k_timer_remaining_ticks(&probe_timer) == 0) {
+		k_timer_start(&probe_timer, WORKQ_PROBE_INTERVAL, WORKQ_PROBE_INTERVAL);
+	}
+}
+
+void health_msgq_set(enum health_msgq id, struct k_msgq *msgq)
+{
+	msgqs[id] = msgq;
+}
+
+void health_msgq_put(enum health_msgq id, bool ok)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (ok) {
+		msgq_peak[id] = MAX(msgq_peak[id], k_msgq_num_used_get(msgqs[id]));
+	} else {
+		msgq_drops[id]++;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void health_gnss_pvt(bool blocked)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	gnss_pvts++;
+	if (blocked) {
+		gnss_blocked++;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+bool health_record_due(void)
+{
+	int64_t now = k_uptime_get();
+
+	if (now < next_record_ms) {
+		return false;
+	}
+
+	next_record_ms = now + HEALTH_INTERVAL_MS;
+
+	return true;
+}
+
+void health_record_get(struct health_record *record)
+{
+	k_spinlock_key_t key;
+
+	memset(record, 0, sizeof(*record));
+
+	record->uptime_s = (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+
+	for (int i = 0; i < HEALTH_THREAD_COUNT; i++) {
+		size_t unused;
+
+		if (threads[i] == NULL) {
+			continue;
+		}
+
+		/* Scans the stack for the painted pattern, so this takes a while for big stacks. */
+		if (k_thread_stack_space_get(threads[i], &unused) == 0) {
+			record->stack_size[i] = MIN(threads[i]->stack_info.size, UINT16_MAX);
+			record->stack_unused[i] = MIN(unused, UINT16_MAX);
+		}
+	}
+
+#if HEALTH_HEAP_STATS
+	struct sys_memory_stats heap_stats;
+
+	if (sys_heap_runtime_stats_get(&_system_heap.heap, &heap_stats) == 0) {
+		record->heap_free = MIN(heap_stats.free_bytes, UINT16_MAX);
+		record->heap_max_used = MIN(heap_stats.max_allocated_bytes, UINT16_MAX);
+	}
+#endif
+
+	key = k_spin_lock(&lock);
+
+	for (int i = 0; i < HEALTH_MSGQ_COUNT; i++) {
+		if (msgqs[i] == NULL) {
+			continue;
+		}
+
+		record->msgq_size[i] = MIN(msgqs[i]->max_msgs, UINT8_MAX);
+		record->msgq_peak[i] = MIN(msgq_peak[i], UINT8_MAX);
+		record->msgq_drops[i] = MIN(msgq_drops[i], UINT16_MAX);
+		msgq_peak[i] = k_msgq_num_used_get(msgqs[i]);
+		msgq_drops[i] = 0;
+	}
+
+	record->gnss_pvts = MIN(gnss_pvts, UINT16_MAX);
+	record->gnss_blocked = MIN(gnss_blocked, UINT16_MAX);
+	gnss_pvts = 0;
+	gnss_blocked = 0;
+
+	for (int i = 0; i < HEALTH_WORKQ_COUNT; i++) {
+		if (probes[i].count == 0) {
+			continue;
+		}
+
+		record->workq_latency_max_us[i] = probes[i].latency_max_us;
+		record->workq_latency_mean_us[i] = probes[i].latency_sum_us / probes[i].count;
+		probes[i].latency_max_us = 0;
+		probes[i].latency_sum_us = 0;
+		probes[i].count = 0;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+/* Appends to a line and returns its new length, a full line is truncated instead of overrun. */
+static int line_append(char *line, size_t size, int len, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	len += vsnprintk(line + len, size - len, fmt, args);
+	va_end(args);
+
+	return MIN(len, (int)size - 1);
+}
+
+void health_record_print(const struct health_record *record)
+{
+	char line[160];
+	int len;
+
+#if HEALTH_HEAP_STATS
+	printk("Health (uptime %u s): heap free %u, max used %u of %u bytes\n", record->uptime_s,
+	       record->heap_free, record->heap_max_used, HEALTH_HEAP_SIZE);
+#else
+	printk("Health (uptime %u s): no heap statistics\n", record->uptime_s);
+#endif
+
+	len = line_append(line, sizeof(line), 0, "  Stack unused/size (bytes):");
+	for (int i = 0; i < HEALTH_THREAD_COUNT; i++) {
+		if (record->stack_size[i] == 0) {
+			continue;
+		}
+		len = line_append(line, sizeof(line), len, " %s=%u/%u", thread_names[i],
+				  record->stack_unused[i], record->stack_size[i]);
+	}
+	printk("%s\n", line);
+
+	len = line_append(line, sizeof(line), 0, "  Queue peak/size/drops:");
+	for (int i = 0; i < HEALTH_MSGQ_COUNT; i++) {
+		len = line_append(line, sizeof(line), len, " %s=%u/%u/%u", msgq_names[i],
+				  record->msgq_peak[i], record->msgq_size[i], record->msgq_drops[i]);
+	}
+	printk("%s\n", line);
+
+	printk("  GNSS PVT blocked/total: %u/%u\n", record->gnss_blocked, record->gnss_pvts);
+
+	len = line_append(line, sizeof(line), 0, "  Work queue latency max/mean (us):");
+	for (int i = 0; i < HEALTH_WORKQ_COUNT; i++) {
+		len = line_append(line, sizeof(line), len, " %s=%u/%u", workq_names[i],
+				  record->workq_latency_max_us[i], record->workq_latency_mean_us[i]);
+	}
+	printk("%s\n", line);
+
+#if defined(CONFIG_STINGSENSE_PROFILE)
+	uint32_t cycles_per_us = SystemCoreClock / USEC_PER_SEC;
+
+	len = line_append(line, sizeof(line), 0, "  Profile p99 (us):");
+	for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+		struct histogram hist;
+
+		profile_stage_get(i, &hist);
+		len = line_append(line, sizeof(line), len, " %s=%u", profile_stage_str(i),
+				  histogram_percentile(&hist, 99) / cycles_per_us);
+	}
+	printk("%s\n", line);
+#endif
+}
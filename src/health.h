@@ -0,0 +1,110 @@
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/toolchain.h>
+
+/** @brief Threads with a tracked stack watermark. */
+enum health_thread {
+	HEALTH_THREAD_MAIN,
+	HEALTH_THREAD_GNSS_WORKQ,
+	HEALTH_THREAD_ASSIST_WORKQ,
+	HEALTH_THREAD_SYSWORKQ,
+	HEALTH_THREAD_COUNT
+};
+
+/** @brief Work queues with tracked work item latency. */
+enum health_workq {
+	HEALTH_WORKQ_GNSS,
+	HEALTH_WORKQ_ASSIST,
+	HEALTH_WORKQ_SYS,
+	HEALTH_WORKQ_COUNT
+};
+
+/** @brief Message queues with tracked occupancy. */
+enum health_msgq {
+	HEALTH_MSGQ_NMEA,
+	HEALTH_MSGQ_COUNT
+};
+
+/**
+ * Compact health record, emitted every CONFIG_STINGSENSE_HEALTH_INTERVAL seconds with the
+ * telemetry. Stack and heap watermarks are since boot, queue peaks and drops, GNSS PVT counts and
+ * work queue latencies since the previous record. Sizes are in bytes, 0 for a thread that has not
+ * been registered. Latencies are from submitting a probe work item to running it, 0 for a work
+ * queue that has not been registered. The heap fields are 0 without a system heap
+ * (CONFIG_HEAP_MEM_POOL_SIZE) or without CONFIG_SYS_HEAP_RUNTIME_STATS.
+ */
+struct health_record {
+	uint32_t uptime_s;
+	uint16_t stack_size[HEALTH_THREAD_COUNT];
+	uint16_t stack_unused[HEALTH_THREAD_COUNT];	/* Never touched since boot */
+	uint16_t heap_free;
+	uint16_t heap_max_used;
+	uint16_t msgq_drops[HEALTH_MSGQ_COUNT];
+	uint8_t msgq_peak[HEALTH_MSGQ_COUNT];
+	uint8_t msgq_size[HEALTH_MSGQ_COUNT];
+	uint16_t gnss_pvts;
+	uint16_t gnss_blocked;		/* PVTs blocked by LTE */
+	uint32_t workq_latency_max_us[HEALTH_WORKQ_COUNT];
+	uint32_t workq_latency_mean_us[HEALTH_WORKQ_COUNT];
+};
+
+BUILD_ASSERT(sizeof(struct health_record) == 56,
+	     "struct health_record layout changed, update the host decoder");
+
+/**
+ * @brief Registers a thread for stack watermark tracking.
+ */
+void health_thread_set(enum health_thread id, k_tid_t thread);
+
+/**
+ * @brief Registers a work queue for work item latency tracking.
+ *
+ * @details A probe work item is submitted to each registered work queue every second, the time
+ *          until it runs is the latency of the work queue at that point.
+ */
+void health_workq_set(enum health_workq id, struct k_work_q *queue);
+
+/**
+ * @brief Registers a message queue for occupancy tracking.
+ */
+void health_msgq_set(enum health_msgq id, struct k_msgq *msgq);
+
+/**
+ * @brief Records the result of putting a message to a tracked queue.
+ *
+ * @details Updates the peak occupancy after a successful put and counts a drop otherwise.
+ *          Callable from interrupt context.
+ *
+ * @param[in] id Queue.
+ * @param[in] ok True if the message was queued, false if it was dropped.
+ */
+void health_msgq_put(enum health_msgq id, bool ok);
+
+/**
+ * @brief Counts a GNSS PVT.
+ *
+ * @param[in] blocked True if LTE blocked GNSS, the PVT has NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED
+ *                    or NRF_MODEM_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME set.
+ */
+void health_gnss_pvt(bool blocked);
+
+/**
+ * @brief Returns true when the next health record is due.
+ */
+bool health_record_due(void);
+
+/**
+ * @brief Samples the watermarks into a health record and restarts the queue statistics.
+ *
+ * @param[out] record Health record.
+ */
+void health_record_get(struct health_record *record);
+
+/**
+ * @brief Prints a health record as part of the telemetry block.
+ */
+void health_record_print(const struct health_record *record);
+
+#endif /* HEALTH_H_ */
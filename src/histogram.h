@@ -0,0 +1,58 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+/* Number of log2 buckets. Bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i) and
+ * the last bucket also counts everything above its range.
+ */
+#define HISTOGRAM_BUCKETS 24
+
+struct histogram {
+	uint32_t bucket[HISTOGRAM_BUCKETS];
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+};
+
+static inline void histogram_reset(struct histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+static inline void histogram_add(struct histogram *h, uint32_t value)
+{
+	int idx = (value == 0) ? 0 : MIN(32 - __builtin_clz(value), HISTOGRAM_BUCKETS - 1);
+
+	h->bucket[idx]++;
+	h->min = (h->count == 0) ? value : MIN(h->min, value);
+	h->max = MAX(h->max, value);
+	h->sum += value;
+	h->count++;
+}
+
+static inline uint32_t histogram_avg(const struct histogram *h)
+{
+	return (h->count == 0) ? 0 : (uint32_t)(h->sum / h->count);
+}
+
+/* Returns the upper bound of the bucket holding the given percentile, capped to the maximum. */
+static inline uint32_t histogram_percentile(const struct histogram *h, uint32_t pct)
+{
+	uint64_t target = ((uint64_t)h->count * pct + 99) / 100;
+	uint64_t seen = 0;
+
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen >= target && seen > 0) {
+			return (i == 0) ? 0 : MIN(BIT64(i) - 1, h->max);
+		}
+	}
+
+	return h->max;
+}
+
+#endif /* HISTOGRAM_H_ */
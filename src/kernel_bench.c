@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include <cmsis_core.h>
+#endif
+
+#include "kernel_bench.h"
+#include "stats.h"
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+#include "mcc_location_table.h"
+#endif
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+struct bench_position {
+	double latitude;
+	double longitude;
+	double distance;	/* Meters to the next position */
+	int32_t gnss_latitude;	/* lat_convert() */
+	int32_t gnss_longitude;	/* lon_convert() */
+};
+
+/* Generated from bus_data.csv by scripts/gen_kernel_bench.py */
+#include "kernel_bench_inputs.inc"
+
+/* Relative error allowed against the reference results, which are calculated on the host with
+ * a different math library.
+ */
+#define KERNEL_BENCH_REL_TOLERANCE	1e-9
+/* Absolute error allowed, for results close to zero. */
+#define KERNEL_BENCH_ABS_TOLERANCE	1e-9
+
+#define BENCH_PRINT(sh, fmt, ...)						\
+	do {									\
+		if (sh) {							\
+			shell_print(sh, fmt, ##__VA_ARGS__);			\
+		} else {							\
+			printk(fmt "\n", ##__VA_ARGS__);			\
+		}								\
+	} while (0)
+
+/* One call of a kernel on input i, returns the number of wrong results. */
+typedef int (*bench_fn)(uint32_t i);
+
+struct bench_kernel {
+	const char *name;
+	bench_fn fn;
+	/* Part of fn that is not the kernel, subtracted from the result, or NULL. */
+	bench_fn setup_fn;
+};
+
+static double window[KERNEL_BENCH_WINDOW_SIZE];
+static bool cpu_cycles;
+
+static bool equal(double value, double ref)
+{
+	return fabs(value - ref) <= KERNEL_BENCH_ABS_TOLERANCE + fabs(ref) * KERNEL_BENCH_REL_TOLERANCE;
+}
+
+/* calculate_stats() sorts the window in place, so every call starts from a fresh copy. */
+static int window_copy(uint32_t i)
+{
+	memcpy(window, bench_windows[i % KERNEL_BENCH_WINDOWS], sizeof(window));
+
+	return 0;
+}
+
+static int stats_fn(uint32_t i)
+{
+	const double *ref = bench_window_stats[i % KERNEL_BENCH_WINDOWS];
+	struct accel_stats stats;
+
+	window_copy(i);
+	calculate_stats(window, ARRAY_SIZE(window), &stats);
+
+	return !(equal(stats.mean, ref[0]) && equal(stats.variance, ref[1]) &&
+		 stats.p1 == ref[2] && stats.p10 == ref[3] && stats.p90 == ref[4] &&
+		 stats.p99 == ref[5]);
+}
+
+static int distance_fn(uint32_t i)
+{
+	const struct bench_position *from = &bench_positions[i % KERNEL_BENCH_POSITIONS];
+	const struct bench_position *to = from + 1;
+
+	return !equal(distance_calculate(from->latitude, from->longitude,
+					 to->latitude, to->longitude), from->distance);
+}
+
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+/* Float to integer conversion can round either way in the last bit. */
+static int coord_convert_fn(uint32_t i)
+{
+	const struct bench_position *pos = &bench_positions[i % KERNEL_BENCH_POSITIONS];
+
+	return (abs(lat_convert((float)pos->latitude) - pos->gnss_latitude) > 1) +
+	       (abs(lon_convert((float)pos->longitude) - pos->gnss_longitude) > 1);
+}
+#endif
+
+static const struct bench_kernel kernels[] = {
+	{ "calculate_stats", stats_fn, window_copy },
+	{ "distance_calculate", distance_fn, NULL },
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+	{ "lat_lon_convert", coord_convert_fn, NULL },
+#endif
+};
+
+static void cpu_cycles_enable(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	uint32_t start;
+
+	if (DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) {
+		return;
+	}
+
+	/* Left running and not reset, profiling may be using the counter as well. */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	start = DWT->CYCCNT;
+	k_busy_wait(10);
+	cpu_cycles = (DWT->CYCCNT != start);
+#endif
+}
+
+static inline uint32_t cpu_cycles_get(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	return DWT->CYCCNT;
+#else
+	return 0;
+#endif
+}
+
+/* Times iterations calls of fn, returns the wrong results and the time and cycles taken. */
+static int bench_loop(bench_fn fn, uint32_t iterations, uint64_t *ns, uint32_t *cycles)
+{
+	uint32_t start_cyc = k_cycle_get_32();
+	uint32_t start_cpu = cpu_cycles_get();
+	int errors = 0;
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		errors += fn(i);
+	}
+
+	*cycles = cpu_cycles_get() - start_cpu;
+	*ns = k_cyc_to_ns_floor64(k_cycle_get_32() - start_cyc);
+
+	return errors;
+}
+
+int kernel_bench_run(const struct shell *sh, uint32_t iterations)
+{
+	int total_errors = 0;
+
+	cpu_cycles_enable();
+
+	BENCH_PRINT(sh, "kernel,calls,errors,ns_per_call,cycles_per_call");
+
+	for (size_t k = 0; k < ARRAY_SIZE(kernels); k++) {
+		const struct bench_kernel *kernel = &kernels[k];
+		uint64_t ns;
+		uint64_t setup_ns = 0;
+		uint32_t cycles;
+		uint32_t setup_cycles = 0;
+		int errors;
+
+		errors = bench_loop(kernel->fn, iterations, &ns, &cycles);
+		if (kernel->setup_fn) {
+			(void)bench_loop(kernel->setup_fn, iterations, &setup_ns, &setup_cycles);
+		}
+
+		ns = (ns > setup_ns) ? ns - setup_ns : 0;
+		cycles = (cycles > setup_cycles) ? cycles - setup_cycles : 0;
+
+		if (cpu_cycles) {
+			BENCH_PRINT(sh, "%s,%u,%d,%u,%u", kernel->name, iterations, errors,
+				    (uint32_t)(ns / iterations), cycles / iterations);
+		} else {
+			BENCH_PRINT(sh, "%s,%u,%d,%u,", kernel->name, iterations, errors,
+				    (uint32_t)(ns / iterations));
+		}
+
+		total_errors += errors;
+	}
+
+	if (total_errors) {
+		LOG_ERR("Kernel benchmark failed, %d wrong results", total_errors);
+	} else {
+		LOG_INF("Kernel benchmark passed");
+	}
+
+	return total_errors;
+}
+
+static int cmd_kernel_bench(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t iterations = CONFIG_STINGSENSE_KERNEL_BENCH_ITERATIONS;
+
+	if (argc > 1) {
+		iterations = strtoul(argv[1], NULL, 10);
+		if (iterations == 0) {
+			shell_error(sh, "Invalid number of calls: %s", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	return kernel_bench_run(sh, iterations) ? -EIO : 0;
+}
+
+SHELL_CMD_ARG_REGISTER(kernel_bench, NULL,
+		       "Benchmark and check the statistics and geometry kernels, prints CSV. "
+		       "Optional argument: calls per kernel",
+		       cmd_kernel_bench, 1, 1);
@@ -0,0 +1,22 @@
+#ifndef KERNEL_BENCH_H_
+#define KERNEL_BENCH_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+/**
+ * @brief Benchmarks and checks the statistics and geometry kernels.
+ *
+ * @details Runs each kernel over inputs taken from the recorded bus route and compares the
+ *          results against the reference values generated with the inputs. Prints one CSV row
+ *          per kernel with the time and CPU cycles per call and the number of wrong results.
+ *          Takes about a second with the default number of iterations.
+ *
+ * @param[in] sh         Shell to print to, or NULL to print to the console.
+ * @param[in] iterations Calls of each kernel.
+ *
+ * @return Number of wrong results, zero if all kernels returned the reference values.
+ */
+int kernel_bench_run(const struct shell *sh, uint32_t iterations);
+
+#endif /* KERNEL_BENCH_H_ */
@@ -1,5 +1,38 @@
 #include "accelerometer.h"
 #include "rtc.h"
+#include "sensor_record.h"
+#include "stats.h"
+#include "timebase.h"
+#include "gnss_quality.h"
+#include "fix_filter.h"
+#include "sample_timing.h"
+#include "boot.h"
+#include "profile.h"
+#include "health.h"
+#if defined(CONFIG_GNSS_SAMPLE_FIX_STORE)
+#include "fix_store.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+#include "cell_cache.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+#include "ttff_bench.h"
+#endif
+#if defined(CONFIG_STINGSENSE_KERNEL_BENCH)
+#include "kernel_bench.h"
+#endif
+#if defined(CONFIG_STINGSENSE_OUTPUT_FRAMED)
+#include "frame.h"
+#endif
+#if defined(CONFIG_STINGSENSE_TX_SCHED)
+#include "tx_sched.h"
+#endif
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+#include "gnss_coex.h"
+#endif
+#if defined(CONFIG_STINGSENSE_UPLINK)
+#include "uplink.h"
+#endif
 #include <stdio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -17,24 +50,40 @@
 // LOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
 LOG_MODULE_REGISTER(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
-#define PI 3.14159265358979323846
-#define EARTH_RADIUS_METERS (6371.0 * 1000.0)
-
-#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
+#if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
+/* GNSS control only, never behind network I/O. */
 static struct k_work_q gnss_work_q;
 
-#define GNSS_WORKQ_THREAD_STACK_SIZE 2304
-#define GNSS_WORKQ_THREAD_PRIORITY   5
+#define GNSS_WORKQ_THREAD_STACK_SIZE 1280
+#define GNSS_WORKQ_THREAD_PRIORITY   4
 
 K_THREAD_STACK_DEFINE(gnss_workq_stack_area, GNSS_WORKQ_THREAD_STACK_SIZE);
-#endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE || CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
+#endif /* CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
+
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_STINGSENSE_UPLINK)
+/* A-GNSS and P-GPS downloads and uplink batches, which block for seconds on the network. */
+static struct k_work_q assist_work_q;
+
+#define ASSIST_WORKQ_THREAD_STACK_SIZE 2304
+#define ASSIST_WORKQ_THREAD_PRIORITY   7
+
+K_THREAD_STACK_DEFINE(assist_workq_stack_area, ASSIST_WORKQ_THREAD_STACK_SIZE);
+#endif
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
 #include "assistance.h"
+#include "modem_cache.h"
 
 static struct nrf_modem_gnss_agnss_data_frame last_agnss;
 static struct k_work agnss_data_get_work;
-static volatile bool requesting_assistance;
+#if defined(CONFIG_STINGSENSE_TX_SCHED)
+static void agnss_tx_release(struct tx_sched_client *client);
+
+static struct tx_sched_client agnss_tx_client = {
+	.name = "agnss",
+	.release = agnss_tx_release,
+};
+#endif
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
@@ -42,11 +91,21 @@ static struct k_work_delayable ttff_test_got_fix_work;
 static struct k_work_delayable ttff_test_prepare_work;
 static struct k_work ttff_test_start_work;
 static uint32_t time_to_fix;
+static uint32_t time_to_fix_ms;
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+static enum ttff_bench_start ttff_start;
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+/* TTFF sums and test counts by the source of the injected location. */
+static uint32_t ttff_sum[ASSISTANCE_LOCATION_SOURCE_COUNT];
+static uint32_t ttff_count[ASSISTANCE_LOCATION_SOURCE_COUNT];
+#endif
 #endif
 
 static const char update_indicator[] = {'\\', '|', '/', '-'};
 
 static struct nrf_modem_gnss_pvt_data_frame last_pvt;
+static int64_t last_pvt_ticks;
 static uint64_t fix_timestamp;
 static uint32_t time_blocked;
 
@@ -57,7 +116,6 @@ static double ref_longitude;
 
 K_MSGQ_DEFINE(nmea_queue, sizeof(struct nrf_modem_gnss_nmea_data_frame *), 10, 4);
 static K_SEM_DEFINE(pvt_data_sem, 0, 1);
-static K_SEM_DEFINE(time_sem, 0, 1);
 
 static struct k_poll_event events[2] = {
 	K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE,
@@ -82,27 +140,6 @@ BUILD_ASSERT((sizeof(CONFIG_GNSS_SAMPLE_REFERENCE_LATITUDE) == 1 &&
 	     "CONFIG_GNSS_SAMPLE_REFERENCE_LATITUDE and "
 	     "CONFIG_GNSS_SAMPLE_REFERENCE_LONGITUDE must be both either set or empty");
 
-/* Returns the distance between two coordinates in meters. The distance is calculated using the
- * haversine formula.
- */
-static double distance_calculate(double lat1, double lon1,
-				 double lat2, double lon2)
-{
-	double d_lat_rad = (lat2 - lat1) * PI / 180.0;
-	double d_lon_rad = (lon2 - lon1) * PI / 180.0;
-
-	double lat1_rad = lat1 * PI / 180.0;
-	double lat2_rad = lat2 * PI / 180.0;
-
-	double a = pow(sin(d_lat_rad / 2), 2) +
-		   pow(sin(d_lon_rad / 2), 2) *
-		   cos(lat1_rad) * cos(lat2_rad);
-
-	double c = 2 * asin(sqrt(a));
-
-	return EARTH_RADIUS_METERS * c;
-}
-
 static void print_distance_from_reference(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
 {
 	if (!ref_used) {
@@ -115,7 +152,7 @@ static void print_distance_from_reference(struct nrf_modem_gnss_pvt_data_frame *
 	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)) {
 		LOG_INF("Distance from reference: %.01f", distance);
 	} else {
-		printf("\nDistance from reference: %.01f\n", distance);
+		printk("\nDistance from reference: %.01f\n", distance);
 	}
 }
 
@@ -124,10 +161,13 @@ static void gnss_event_handler(int event)
 	int retval;
 	struct nrf_modem_gnss_nmea_data_frame *nmea_data;
 
+	PROFILE_START(PROFILE_GNSS_EVENT);
+
 	switch (event) {
 	case NRF_MODEM_GNSS_EVT_PVT:
 		retval = nrf_modem_gnss_read(&last_pvt, sizeof(last_pvt), NRF_MODEM_GNSS_DATA_PVT);
 		if (retval == 0) {
+			last_pvt_ticks = k_uptime_ticks();
 			k_sem_give(&pvt_data_sem);
 		}
 		break;
@@ -137,7 +177,8 @@ static void gnss_event_handler(int event)
 		/* Time to fix is calculated here, but it's printed from a delayed work to avoid
 		 * messing up the NMEA output.
 		 */
-		time_to_fix = (k_uptime_get() - fix_timestamp) / 1000;
+		time_to_fix_ms = k_uptime_get() - fix_timestamp;
+		time_to_fix = time_to_fix_ms / 1000;
 		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_got_fix_work, K_MSEC(100));
 		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_prepare_work,
 					  K_SECONDS(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_INTERVAL));
@@ -148,6 +189,9 @@ static void gnss_event_handler(int event)
 		nmea_data = k_malloc(sizeof(struct nrf_modem_gnss_nmea_data_frame));
 		if (nmea_data == NULL) {
 			LOG_ERR("Failed to allocate memory for NMEA");
+#if defined(CONFIG_STINGSENSE_HEALTH)
+			health_msgq_put(HEALTH_MSGQ_NMEA, false);
+#endif
 			break;
 		}
 
@@ -156,6 +200,9 @@ static void gnss_event_handler(int event)
 					     NRF_MODEM_GNSS_DATA_NMEA);
 		if (retval == 0) {
 			retval = k_msgq_put(&nmea_queue, &nmea_data, K_NO_WAIT);
+#if defined(CONFIG_STINGSENSE_HEALTH)
+			health_msgq_put(HEALTH_MSGQ_NMEA, retval == 0);
+#endif
 		}
 
 		if (retval != 0) {
@@ -169,14 +216,30 @@ static void gnss_event_handler(int event)
 					     sizeof(last_agnss),
 					     NRF_MODEM_GNSS_DATA_AGNSS_REQ);
 		if (retval == 0) {
-			k_work_submit_to_queue(&gnss_work_q, &agnss_data_get_work);
+#if defined(CONFIG_STINGSENSE_TX_SCHED)
+			/* GNSS is waiting for the data, so the fetch goes right away and takes the
+			 * queued uplink batches along into its connection.
+			 */
+			tx_sched_request(&agnss_tx_client, K_NO_WAIT);
+#else
+			k_work_submit_to_queue(&assist_work_q, &agnss_data_get_work);
+#endif
 		}
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 		break;
 
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+	case NRF_MODEM_GNSS_EVT_SLEEP_AFTER_FIX:
+	case NRF_MODEM_GNSS_EVT_SLEEP_AFTER_TIMEOUT:
+		gnss_coex_sleep();
+		break;
+#endif
+
 	default:
 		break;
 	}
+
+	PROFILE_END(PROFILE_GNSS_EVENT);
 }
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
@@ -190,10 +253,27 @@ static void lte_lc_event_handler(const struct lte_lc_evt *const evt)
 		if ((evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME) ||
 		    (evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_ROAMING)) {
 			LOG_INF("Connected to LTE network");
+			boot_phase_done(BOOT_PHASE_LTE);
 			k_sem_give(&lte_ready);
 		}
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+		if ((evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_HOME) &&
+		    (evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_ROAMING)) {
+			cell_cache_serving_cell_lost();
+		}
+#endif
 		break;
 
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+	case LTE_LC_EVT_CELL_UPDATE:
+		if (evt->cell.id != LTE_LC_CELL_EUTRAN_ID_INVALID) {
+			cell_cache_serving_cell_set(evt->cell.id, evt->cell.tac);
+		} else {
+			cell_cache_serving_cell_lost();
+		}
+		break;
+#endif
+
 	default:
 		break;
 	}
@@ -248,10 +328,8 @@ static const char *get_system_string(uint8_t system_id)
 	}
 }
 
-static void agnss_data_get_work_fn(struct k_work *item)
+static void agnss_data_get(void)
 {
-	ARG_UNUSED(item);
-
 	int err;
 
 	/* GPS data need is always expected to be present and first in list. */
@@ -291,8 +369,6 @@ static void agnss_data_get_work_fn(struct k_work *item)
 		return;
 	}
 
-	requesting_assistance = true;
-
 	LOG_INF("Assistance data needed: data_flags: 0x%02x", last_agnss.data_flags);
 	for (int i = 0; i < last_agnss.system_count; i++) {
 		LOG_INF("Assistance data needed: %s ephe: 0x%llx, alm: 0x%llx",
@@ -303,6 +379,12 @@ static void agnss_data_get_work_fn(struct k_work *item)
 
 #if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
 	lte_connect();
+#else
+	/* GNSS asks for assistance as soon as it starts, LTE may still be attaching. */
+	if (!boot_phase_wait(BOOT_PHASE_LTE, K_MINUTES(10))) {
+		LOG_ERR("No LTE connection for assistance data");
+		return;
+	}
 #endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
 
 	err = assistance_request(&last_agnss);
@@ -313,9 +395,23 @@ static void agnss_data_get_work_fn(struct k_work *item)
 #if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
 	lte_disconnect();
 #endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
+}
 
-	requesting_assistance = false;
+static void agnss_data_get_work_fn(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	PROFILE_START(PROFILE_AGNSS_WORK);
+	agnss_data_get();
+	PROFILE_END(PROFILE_AGNSS_WORK);
+}
+
+#if defined(CONFIG_STINGSENSE_TX_SCHED)
+static void agnss_tx_release(struct tx_sched_client *client)
+{
+	k_work_submit_to_queue(&assist_work_q, &agnss_data_get_work);
 }
+#endif
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
@@ -325,10 +421,61 @@ static void ttff_test_got_fix_work_fn(struct k_work *item)
 	if (time_blocked > 0) {
 		LOG_INF("Time GNSS was blocked by LTE: %u", time_blocked);
 	}
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+	enum assistance_location_source source = assistance_location_source_get();
+
+	ttff_sum[source] += time_to_fix;
+	ttff_count[source]++;
+	LOG_INF("Location assistance: %s", assistance_location_source_str(source));
+	for (int i = 0; i < ASSISTANCE_LOCATION_SOURCE_COUNT; i++) {
+		if (ttff_count[i] > 0) {
+			LOG_INF("Average time to fix with %s location: %u (%u tests)",
+				assistance_location_source_str(i), ttff_sum[i] / ttff_count[i],
+				ttff_count[i]);
+		}
+	}
+#endif
 	print_distance_from_reference(&last_pvt);
+
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	struct ttff_bench_run run = {
+		.ttff_ms = time_to_fix_ms,
+		.distance_m = -1,
+		.blocked_s = MIN(time_blocked, UINT16_MAX),
+		.start = ttff_start,
+	};
+
+	for (int i = 0; i < NRF_MODEM_GNSS_MAX_SATELLITES; ++i) {
+		if (last_pvt.sv[i].flags & NRF_MODEM_GNSS_SV_FLAG_USED_IN_FIX) {
+			run.sats++;
+		}
+	}
+
+	if (ref_used) {
+		run.distance_m = (int32_t)distance_calculate(last_pvt.latitude, last_pvt.longitude,
+							     ref_latitude, ref_longitude);
+	}
+
+	ttff_bench_result_add(&run);
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
+
 	LOG_INF("Sleeping for %u seconds", CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_INTERVAL);
 }
 
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+static int ttff_test_force_warm_start(void)
+{
+	LOG_INF("Deleting GNSS ephemerides");
+
+	if (nrf_modem_gnss_nv_data_delete(NRF_MODEM_GNSS_DELETE_EPHEMERIDES) != 0) {
+		LOG_ERR("Failed to delete GNSS data");
+		return -1;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
+
 static int ttff_test_force_cold_start(void)
 {
 	int err;
@@ -360,35 +507,42 @@ static int ttff_test_force_cold_start(void)
 	return 0;
 }
 
-#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD)
-static bool qzss_assistance_is_supported(void)
+static void ttff_test_prepare_work_fn(struct k_work *item)
 {
-	char resp[32];
+	bool cold_start = IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START);
 
-	if (nrf_modem_at_cmd(resp, sizeof(resp), "AT+CGMM") == 0) {
-		/* nRF9160 does not support QZSS assistance, while nRF91x1 do. */
-		if (strstr(resp, "nRF9160") != NULL) {
-			return false;
-		}
+	/* Make sure GNSS is stopped before next start. */
+	nrf_modem_gnss_stop();
+
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	ttff_start = ttff_bench_next_start();
+	if (ttff_start == TTFF_BENCH_DONE) {
+		LOG_INF("TTFF benchmark done, use the ttff_bench shell command to read the results");
+		return;
 	}
 
-	return true;
-}
-#endif /* CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD */
+	LOG_INF("TTFF benchmark: %s start", ttff_bench_start_str(ttff_start));
+	cold_start = (ttff_start == TTFF_BENCH_COLD);
+	if (ttff_start == TTFF_BENCH_WARM && ttff_test_force_warm_start() != 0) {
+		return;
+	}
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
 
-static void ttff_test_prepare_work_fn(struct k_work *item)
-{
-	/* Make sure GNSS is stopped before next start. */
-	nrf_modem_gnss_stop();
+#if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_FIX_STORE_ALTERNATE)
+	static bool use_stored_fix;
+
+	use_stored_fix = !use_stored_fix;
+	fix_store_inject_enable(use_stored_fix);
+#endif
 
-	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START)) {
+	if (cold_start) {
 		if (ttff_test_force_cold_start() != 0) {
 			return;
 		}
 	}
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
-	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START)) {
+	if (cold_start) {
 		/* All A-GNSS data is always requested before GNSS is started. */
 		last_agnss.data_flags =
 			NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST |
@@ -401,14 +555,14 @@ static void ttff_test_prepare_work_fn(struct k_work *item)
 		last_agnss.system[0].sv_mask_ephe = 0xffffffff;
 		last_agnss.system[0].sv_mask_alm = 0xffffffff;
 #if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD)
-		if (qzss_assistance_is_supported()) {
+		if (modem_cache_identity()->qzss_assistance) {
 			last_agnss.system_count = 2;
 			last_agnss.system[1].sv_mask_ephe = 0x3ff;
 			last_agnss.system[1].sv_mask_alm = 0x3ff;
 		}
 #endif /* CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD */
 
-		k_work_submit_to_queue(&gnss_work_q, &agnss_data_get_work);
+		k_work_submit_to_queue(&assist_work_q, &agnss_data_get_work);
 	} else {
 		/* Start and stop GNSS to trigger possible A-GNSS data request. If new A-GNSS
 		 * data is needed it is fetched before GNSS is started.
@@ -423,6 +577,13 @@ static void ttff_test_prepare_work_fn(struct k_work *item)
 
 static void ttff_test_start_work_fn(struct k_work *item)
 {
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+	struct k_work_sync sync;
+
+	/* The A-GNSS data requested for this start is on the assistance queue. */
+	(void)k_work_flush(&agnss_data_get_work, &sync);
+#endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
+
 	LOG_INF("Starting GNSS");
 	if (nrf_modem_gnss_start() != 0) {
 		LOG_ERR("Failed to start GNSS");
@@ -436,9 +597,23 @@ static void ttff_test_start_work_fn(struct k_work *item)
 
 static void date_time_evt_handler(const struct date_time_evt *evt)
 {
-	k_sem_give(&time_sem);
+	if (evt->type != DATE_TIME_NOT_OBTAINED) {
+		boot_phase_done(BOOT_PHASE_TIME);
+	}
 }
 
+#if !defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND) && \
+	(!defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_STINGSENSE_UPLINK))
+static void lte_connect_evt_handler(const struct lte_lc_evt *const evt)
+{
+	if (evt->type == LTE_LC_EVT_NW_REG_STATUS &&
+	    (evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME ||
+	     evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_ROAMING)) {
+		boot_phase_done(BOOT_PHASE_LTE);
+	}
+}
+#endif
+
 static int modem_init(void)
 {
 	if (IS_ENABLED(CONFIG_DATE_TIME)) {
@@ -447,26 +622,23 @@ static int modem_init(void)
 
 #if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
 	lte_lc_register_handler(lte_lc_event_handler);
-#elif !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+#elif !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_STINGSENSE_UPLINK)
 	lte_lc_psm_req(true);
 
-	LOG_INF("Connecting to LTE network");
+	/* The modem is in normal mode when this returns, so GNSS can start while LTE attaches.
+	 * The network time is fetched by the Date Time library once connected.
+	 */
+	LOG_INF("Connecting to LTE network in the background");
 
-	if (lte_lc_connect() != 0) {
+	if (lte_lc_connect_async(lte_connect_evt_handler) != 0) {
 		LOG_ERR("Failed to connect to LTE network");
 		return -1;
 	}
 
-	LOG_INF("Connected to LTE network");
-
-	if (IS_ENABLED(CONFIG_DATE_TIME)) {
-		LOG_INF("Waiting for current time");
-
-		/* Wait for an event from the Date Time library. */
-		k_sem_take(&time_sem, K_MINUTES(10));
-
-		if (!date_time_is_valid()) {
-			LOG_WRN("Failed to get current time, continuing anyway");
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)) {
+		/* Fixes are timed from a connected start, as before. */
+		if (!boot_phase_wait(BOOT_PHASE_LTE, K_MINUTES(10))) {
+			LOG_WRN("Not connected to LTE network, continuing anyway");
 		}
 	}
 #endif
@@ -478,7 +650,7 @@ static int sample_init(void)
 {
 	int err = 0;
 
-#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
+#if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 	struct k_work_queue_config cfg = {
 		.name = "gnss_work_q",
 		.no_yield = false
@@ -490,14 +662,42 @@ static int sample_init(void)
 		K_THREAD_STACK_SIZEOF(gnss_workq_stack_area),
 		GNSS_WORKQ_THREAD_PRIORITY,
 		&cfg);
-#endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE || CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
+#if defined(CONFIG_STINGSENSE_HEALTH)
+	health_thread_set(HEALTH_THREAD_GNSS_WORKQ, k_work_queue_thread_get(&gnss_work_q));
+	health_workq_set(HEALTH_WORKQ_GNSS, &gnss_work_q);
+#endif
+#endif /* CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
+
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_STINGSENSE_UPLINK)
+	struct k_work_queue_config assist_cfg = {
+		.name = "assist_work_q",
+		.no_yield = false
+	};
+
+	k_work_queue_start(
+		&assist_work_q,
+		assist_workq_stack_area,
+		K_THREAD_STACK_SIZEOF(assist_workq_stack_area),
+		ASSIST_WORKQ_THREAD_PRIORITY,
+		&assist_cfg);
+#if defined(CONFIG_STINGSENSE_HEALTH)
+	health_thread_set(HEALTH_THREAD_ASSIST_WORKQ, k_work_queue_thread_get(&assist_work_q));
+	health_workq_set(HEALTH_WORKQ_ASSIST, &assist_work_q);
+#endif
+#endif
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
 	k_work_init(&agnss_data_get_work, agnss_data_get_work_fn);
 
-	err = assistance_init(&gnss_work_q);
+	err = assistance_init(&assist_work_q);
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	if (err == 0) {
+		err = ttff_bench_init();
+	}
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
+
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 	k_work_init_delayable(&ttff_test_got_fix_work, ttff_test_got_fix_work_fn);
 	k_work_init_delayable(&ttff_test_prepare_work, ttff_test_prepare_work_fn);
@@ -523,14 +723,8 @@ static int gnss_init_and_start(void)
 		return -1;
 	}
 
-	/* Enable all supported NMEA messages. */
-	uint16_t nmea_mask = NRF_MODEM_GNSS_NMEA_RMC_MASK |
-			     NRF_MODEM_GNSS_NMEA_GGA_MASK |
-			     NRF_MODEM_GNSS_NMEA_GLL_MASK |
-			     NRF_MODEM_GNSS_NMEA_GSA_MASK |
-			     NRF_MODEM_GNSS_NMEA_GSV_MASK;
-
-	if (nrf_modem_gnss_nmea_mask_set(nmea_mask) != 0) {
+	/* NMEA sentences are only parsed for the fix quality, none by default. */
+	if (nrf_modem_gnss_nmea_mask_set(gnss_quality_nmea_get()) != 0) {
 		LOG_ERR("Failed to set GNSS NMEA mask");
 		return -1;
 	}
@@ -604,6 +798,10 @@ static int gnss_init_and_start(void)
 		return -1;
 	}
 
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+	gnss_coex_init(fix_interval);
+#endif
+
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 	k_work_schedule_for_queue(&gnss_work_q, &ttff_test_prepare_work, K_NO_WAIT);
 #else /* !CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
@@ -613,16 +811,9 @@ static int gnss_init_and_start(void)
 	}
 #endif
 
-	return 0;
-}
+	boot_phase_done(BOOT_PHASE_GNSS_START);
 
-static bool output_paused(void)
-{
-#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE) || defined(CONFIG_GNSS_SAMPLE_LOG_LEVEL_OFF)
-	return false;
-#else
-	return (requesting_assistance || assistance_is_active()) ? true : false;
-#endif
+	return 0;
 }
 
 static void print_satellite_stats(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
@@ -645,31 +836,31 @@ static void print_satellite_stats(struct nrf_modem_gnss_pvt_data_frame *pvt_data
 		}
 	}
 
-	printf("Tracking: %2d Using: %2d Unhealthy: %d\n", tracked, in_fix, unhealthy);
+	printk("Tracking: %2d Using: %2d Unhealthy: %d\n", tracked, in_fix, unhealthy);
 }
 
 static void print_fix_data(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
 {
-	printf("Latitude:       %.06f\n", pvt_data->latitude);
-	printf("Longitude:      %.06f\n", pvt_data->longitude);
-	printf("Altitude:       %.01f m\n", (double)pvt_data->altitude);
-	printf("Accuracy:       %.01f m\n", (double)pvt_data->accuracy);
-	printf("Speed:          %.01f m/s\n", (double)pvt_data->speed);
-	printf("Speed accuracy: %.01f m/s\n", (double)pvt_data->speed_accuracy);
-	printf("Heading:        %.01f deg\n", (double)pvt_data->heading);
-	printf("Date:           %04u-%02u-%02u\n",
+	printk("Latitude:       %.06f\n", pvt_data->latitude);
+	printk("Longitude:      %.06f\n", pvt_data->longitude);
+	printk("Altitude:       %.01f m\n", (double)pvt_data->altitude);
+	printk("Accuracy:       %.01f m\n", (double)pvt_data->accuracy);
+	printk("Speed:          %.01f m/s\n", (double)pvt_data->speed);
+	printk("Speed accuracy: %.01f m/s\n", (double)pvt_data->speed_accuracy);
+	printk("Heading:        %.01f deg\n", (double)pvt_data->heading);
+	printk("Date:           %04u-%02u-%02u\n",
 	       pvt_data->datetime.year,
 	       pvt_data->datetime.month,
 	       pvt_data->datetime.day);
-	printf("Time (UTC):     %02u:%02u:%02u.%03u\n",
+	printk("Time (UTC):     %02u:%02u:%02u.%03u\n",
 	       pvt_data->datetime.hour,
 	       pvt_data->datetime.minute,
 	       pvt_data->datetime.seconds,
 	       pvt_data->datetime.ms);
-	printf("PDOP:           %.01f\n", (double)pvt_data->pdop);
-	printf("HDOP:           %.01f\n", (double)pvt_data->hdop);
-	printf("VDOP:           %.01f\n", (double)pvt_data->vdop);
-	printf("TDOP:           %.01f\n", (double)pvt_data->tdop);
+	printk("PDOP:           %.01f\n", (double)pvt_data->pdop);
+	printk("HDOP:           %.01f\n", (double)pvt_data->hdop);
+	printk("VDOP:           %.01f\n", (double)pvt_data->vdop);
+	printk("TDOP:           %.01f\n", (double)pvt_data->tdop);
 }
 
 /**
@@ -678,135 +869,40 @@ static void print_fix_data(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
  * and display sensor data from Georgia Tech buses.
  */
 
-// Structure for accelerometer statistics
-struct accel_stats {
-    double mean;
-    double variance;
-    double p1;
-    double p10;
-    double p90;
-    double p99;
-};
-
-/**
- * Structure to hold consolidated sensor data
- */
-struct sensor_data {
-    struct datetime dt;
-    double normalized_accel;
-    bool gps_fix_valid;
-    double latitude;
-    double longitude;
-    double altitude;
-    uint32_t seconds_since_fix;
-    char nmea_str[256];
-    double speed;
-    double bearing;
-    // Stats for normalized acceleration (magnitude)
-    struct accel_stats accel_stats;
-    // Percentile stats for individual axes
-    struct accel_stats accel_stats_x;
-    struct accel_stats accel_stats_y;
-    struct accel_stats accel_stats_z;
-};
-
 #define ACCEL_BUF_SIZE 60	// 3s * 20 samples/s
+#define REPORT_INTERVAL_MS (3 * MSEC_PER_SEC)
 
-// Function prototypes
-void calculate_stats(double *buf, size_t count, struct accel_stats *stats);
-static void convert_gps_to_eastern(const struct nrf_modem_gnss_datetime *gps_time, struct datetime *local_time);
+// Calculates the stats of one window, profiled as a stage of its own
+static void window_stats(double *buf, struct accel_stats *stats)
+{
+	PROFILE_START(PROFILE_STATS);
+	calculate_stats(buf, ACCEL_BUF_SIZE, stats);
+	PROFILE_END(PROFILE_STATS);
+}
 
-// Function to convert GPS time to Eastern Time
-static void convert_gps_to_eastern(const struct nrf_modem_gnss_datetime *gps_time, struct datetime *local_time)
+// Packs the stats of one acceleration axis into the record's Q8.8 percentiles
+static void pack_axis_percentiles(struct sensor_record *data, enum sensor_record_axis axis,
+				  const struct accel_stats *stats)
 {
-    if (gps_time == NULL || local_time == NULL) {
-        return;
-    }
-    
-    // Copy GPS time (UTC) to local time structure
-    local_time->year = gps_time->year;
-    local_time->month = gps_time->month;
-    local_time->day = gps_time->day;
-    local_time->hour = gps_time->hour;
-    local_time->minute = gps_time->minute;
-    local_time->second = gps_time->seconds;
-    
-    // Apply Eastern Time offset (UTC-5 for EST)
-    int hour_offset = -5;
-    
-    // Check for Daylight Saving Time (2025 dates)
-    // DST starts on March 9, 2025 and ends on November 2, 2025
-    bool is_dst = false;
-    if ((local_time->month > 3 || (local_time->month == 3 && local_time->day >= 9)) &&
-        (local_time->month < 11 || (local_time->month == 11 && local_time->day < 2))) {
-        is_dst = true;
-        hour_offset = -4; // EDT is UTC-4
-    }
-    
-    // Apply hour offset
-    local_time->hour += hour_offset;
-    
-    // Handle day boundary crossings
-    if (local_time->hour < 0) {
-        local_time->hour += 24;
-        local_time->day--;
-        
-        // Handle month boundary (simplified)
-        if (local_time->day == 0) {
-            local_time->month--;
-            if (local_time->month == 0) {
-                local_time->month = 12;
-                local_time->year--;
-            }
-            
-            // Set day to last day of previous month (simplified)
-            switch (local_time->month) {
-                case 2: local_time->day = 28; break; // Simplified (ignores leap years)
-                case 4: case 6: case 9: case 11: local_time->day = 30; break;
-                default: local_time->day = 31; break;
-            }
-        }
-    }
+	data->accel_pct[axis][SENSOR_RECORD_PCT_1] =
+		sensor_record_q16(stats->p1, SENSOR_RECORD_ACCEL_SCALE);
+	data->accel_pct[axis][SENSOR_RECORD_PCT_10] =
+		sensor_record_q16(stats->p10, SENSOR_RECORD_ACCEL_SCALE);
+	data->accel_pct[axis][SENSOR_RECORD_PCT_90] =
+		sensor_record_q16(stats->p90, SENSOR_RECORD_ACCEL_SCALE);
+	data->accel_pct[axis][SENSOR_RECORD_PCT_99] =
+		sensor_record_q16(stats->p99, SENSOR_RECORD_ACCEL_SCALE);
 }
 
 // Function to collect all sensor data atomically
-static int collect_sensor_data(struct sensor_data *data)
+static int collect_sensor_data(struct sensor_record *data, int64_t *sample_ticks)
 {
-	if (data == NULL) {
+	if (data == NULL || sample_ticks == NULL) {
 		return -EINVAL;
 	}
 
-	// Get GPS-based time instead of RTC time
-    if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
-        // Convert GPS time to Eastern Time
-        convert_gps_to_eastern(&last_pvt.datetime, &data->dt);
-    } else {
-        // If no valid GPS fix, use the last known time or fallback
-        // This preserves the last valid time or uses a placeholder
-        if (data->dt.year == 0) {
-            // Initialize with a fallback time if never set
-            data->dt.year = 2025;
-            data->dt.month = 3;
-            data->dt.day = 30;
-            data->dt.hour = 17;
-            data->dt.minute = 18;
-            data->dt.second = 0;
-        }
-        // Increment seconds to show time is passing (simplified)
-        data->dt.second++;
-        if (data->dt.second >= 60) {
-            data->dt.second = 0;
-            data->dt.minute++;
-            if (data->dt.minute >= 60) {
-                data->dt.minute = 0;
-                data->dt.hour++;
-                // Further time adjustments omitted for brevity
-            }
-        }
-    }
-    
-    // Get accelerometer data for x, y, z axes
-    double x, y, z;
+    // Get a timestamped accelerometer sample for x, y, z axes
+    struct accel_sample sample;
     // Static buffers for normalized magnitude and each axis
     static double accel_buf[ACCEL_BUF_SIZE];
     static double accel_buf_x[ACCEL_BUF_SIZE];
@@ -814,49 +910,87 @@ static int collect_sensor_data(struct sensor_data *data)
     static double accel_buf_z[ACCEL_BUF_SIZE];
     static size_t sample_count = 0;
 
-    get_accelerometer_data(&x, &y, &z);
-    // Calculate normalized acceleration (magnitude)
-    data->normalized_accel = sqrt(x * x + y * y + z * z);
+    get_accelerometer_sample(&sample);
+    sample_timing_sample(sample.ticks);
+    *sample_ticks = sample.ticks;
+
+    // Timestamp of the sample from the GNSS-disciplined uptime clock, converted to local time
+    // on the host
+    if (timebase_ticks_to_time(sample.ticks, &data->time, &data->time_ms)) {
+        data->flags |= SENSOR_RECORD_FLAG_TIME_VALID;
+    } else {
+        data->flags &= ~SENSOR_RECORD_FLAG_TIME_VALID;
+    }
 
     // Store the normalized magnitude and axis values in their respective circular buffers
-    accel_buf[sample_count % ACCEL_BUF_SIZE] = data->normalized_accel;
-    accel_buf_x[sample_count % ACCEL_BUF_SIZE] = x;
-    accel_buf_y[sample_count % ACCEL_BUF_SIZE] = y;
-    accel_buf_z[sample_count % ACCEL_BUF_SIZE] = z;
+    accel_buf[sample_count % ACCEL_BUF_SIZE] =
+        sqrt(sample.x * sample.x + sample.y * sample.y + sample.z * sample.z);
+    accel_buf_x[sample_count % ACCEL_BUF_SIZE] = sample.x;
+    accel_buf_y[sample_count % ACCEL_BUF_SIZE] = sample.y;
+    accel_buf_z[sample_count % ACCEL_BUF_SIZE] = sample.z;
     sample_count++;
 
     // Calculate stats every 3 seconds (60 samples)
     if (sample_count >= ACCEL_BUF_SIZE) {
+        struct accel_stats stats;
+
         // Compute mean and variance for normalized acceleration
-        calculate_stats(accel_buf, ACCEL_BUF_SIZE, &data->accel_stats);
+        window_stats(accel_buf, &stats);
+        data->accel_mean = (float)stats.mean;
+        data->accel_variance = (float)stats.variance;
         // Compute percentiles for each axis
-        calculate_stats(accel_buf_x, ACCEL_BUF_SIZE, &data->accel_stats_x);
-        calculate_stats(accel_buf_y, ACCEL_BUF_SIZE, &data->accel_stats_y);
-        calculate_stats(accel_buf_z, ACCEL_BUF_SIZE, &data->accel_stats_z);
+        window_stats(accel_buf_x, &stats);
+        pack_axis_percentiles(data, SENSOR_RECORD_AXIS_X, &stats);
+        window_stats(accel_buf_y, &stats);
+        pack_axis_percentiles(data, SENSOR_RECORD_AXIS_Y, &stats);
+        window_stats(accel_buf_z, &stats);
+        pack_axis_percentiles(data, SENSOR_RECORD_AXIS_Z, &stats);
+        data->flags |= SENSOR_RECORD_FLAG_STATS_VALID;
         sample_count = 0;
     }
 
 	// Process GPS data
-	data->gps_fix_valid = (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) != 0;
+	struct fix_filter_fix fix;
+	bool fix_valid;
 
-	if (data->gps_fix_valid) {
+#if defined(CONFIG_STINGSENSE_FIX_FILTER)
+	// Gated and smoothed, outliers never reach the record
+	fix_valid = fix_filter_get(&fix);
+#else
+	fix_valid = (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID);
+	fix = (struct fix_filter_fix){
+		.latitude = last_pvt.latitude,
+		.longitude = last_pvt.longitude,
+		.altitude = last_pvt.altitude,
+		.speed = last_pvt.speed,
+		.heading = last_pvt.heading,
+	};
+#endif
+
+	if (fix_valid) {
 		// We have a valid GPS fix
-		data->latitude = last_pvt.latitude;
-		data->longitude = last_pvt.longitude;
-		data->altitude = last_pvt.altitude;
-		data->speed = last_pvt.speed;
-		data->bearing = last_pvt.heading;
+		data->flags |= SENSOR_RECORD_FLAG_FIX_VALID;
+		data->latitude = sensor_record_coord(fix.latitude);
+		data->longitude = sensor_record_coord(fix.longitude);
+		data->altitude = sensor_record_q16(fix.altitude, SENSOR_RECORD_ALT_SCALE);
+		data->speed = sensor_record_uq16(fix.speed, SENSOR_RECORD_SPEED_SCALE);
+		data->bearing = sensor_record_uq16(fix.heading, SENSOR_RECORD_BEARING_SCALE);
+		data->fix_quality = gnss_quality_score();
 		fix_timestamp = k_uptime_get(); // update fix timestamp
 		data->seconds_since_fix = 0;
 	} else {
 		// no valid fix, calculate time since last fix
-		data->seconds_since_fix = (uint32_t)((k_uptime_get() - fix_timestamp) / 1000);
+		data->flags &= ~SENSOR_RECORD_FLAG_FIX_VALID;
+		data->fix_quality = 0;
+		data->seconds_since_fix =
+			(uint16_t)MIN((k_uptime_get() - fix_timestamp) / 1000, UINT16_MAX);
 	}
 	return 0;
 }
 
 // Function to display all sensor data in a consistent, atomic operation
-static void display_sensor_data(const struct sensor_data *data, uint8_t cnt)
+static void display_sensor_data(const struct sensor_record *data, uint8_t cnt,
+				const struct health_record *health)
 {
     if (data == NULL) {
         return;
@@ -869,33 +1003,45 @@ static void display_sensor_data(const struct sensor_data *data, uint8_t cnt)
     // printk("===== StingSense Bus Monitoring System =====\n\n");
     // printk("Sensor Data\n");
     printk("-------------------------------------------------------------------------------\n");
-    printk("Date/Time: %04d-%02d-%02d %02d:%02d:%02d EDT\n", 
-           data->dt.year, data->dt.month, data->dt.day,
-           data->dt.hour, data->dt.minute, data->dt.second);
+    printk("Timestamp: %u.%03u %s\n", data->time, data->time_ms,
+           (data->flags & SENSOR_RECORD_FLAG_TIME_VALID) ? "UTC" : "uptime");
     
-    if (data->gps_fix_valid) {
+    if (data->flags & SENSOR_RECORD_FLAG_FIX_VALID) {
         printk("GPS: Lat: %f, Lon: %f, Alt: %f\nSpeed: %.2f m/s, Bearing: %.1f°\n",
-               data->latitude, data->longitude, data->altitude,
-               data->speed, data->bearing);
+               data->latitude / SENSOR_RECORD_COORD_SCALE,
+               data->longitude / SENSOR_RECORD_COORD_SCALE,
+               data->altitude / SENSOR_RECORD_ALT_SCALE,
+               data->speed / SENSOR_RECORD_SPEED_SCALE,
+               data->bearing / SENSOR_RECORD_BEARING_SCALE);
+        printk("Fix quality: %u/100\n", data->fix_quality);
     } else {
         printk("GPS: Searching [%c] (No fix for %u seconds)\n", 
                update_indicator[cnt % 4], data->seconds_since_fix);
     }
 
-    if (data->accel_stats.mean > 0) {
+#if defined(CONFIG_STINGSENSE_HEALTH)
+    if (health != NULL) {
+        health_record_print(health);
+    }
+#endif
+
+    if (data->flags & SENSOR_RECORD_FLAG_STATS_VALID) {
+        static const char axis_name[SENSOR_RECORD_AXIS_COUNT] = {'X', 'Y', 'Z'};
+
         printk("Acceleration Stats (3s Window):\n");
-        printk("  Mean (Magnitude): %.3f (m/s²)\n", data->accel_stats.mean);
-        printk("  Variance (Magnitude): %.3f (m/s²)²\n", data->accel_stats.variance);
+        printk("  Mean (Magnitude): %.3f (m/s²)\n", (double)data->accel_mean);
+        printk("  Variance (Magnitude): %.3f (m/s²)²\n", (double)data->accel_variance);
         printk("  Percentiles:\n");
-        printk("    X-Axis: p1=%.3f, p10=%.3f, p90=%.3f, p99=%.3f (m/s²)\n",
-               data->accel_stats_x.p1, data->accel_stats_x.p10,
-               data->accel_stats_x.p90, data->accel_stats_x.p99);
-        printk("    Y-Axis: p1=%.3f, p10=%.3f, p90=%.3f, p99=%.3f (m/s²)\n",
-               data->accel_stats_y.p1, data->accel_stats_y.p10,
-               data->accel_stats_y.p90, data->accel_stats_y.p99);
-        printk("    Z-Axis: p1=%.3f, p10=%.3f, p90=%.3f, p99=%.3f (m/s²)\n",
-               data->accel_stats_z.p1, data->accel_stats_z.p10,
-               data->accel_stats_z.p90, data->accel_stats_z.p99);
+        for (int axis = 0; axis < SENSOR_RECORD_AXIS_COUNT; axis++) {
+            const int16_t *pct = data->accel_pct[axis];
+
+            printk("    %c-Axis: p1=%.3f, p10=%.3f, p90=%.3f, p99=%.3f (m/s²)\n",
+                   axis_name[axis],
+                   pct[SENSOR_RECORD_PCT_1] / SENSOR_RECORD_ACCEL_SCALE,
+                   pct[SENSOR_RECORD_PCT_10] / SENSOR_RECORD_ACCEL_SCALE,
+                   pct[SENSOR_RECORD_PCT_90] / SENSOR_RECORD_ACCEL_SCALE,
+                   pct[SENSOR_RECORD_PCT_99] / SENSOR_RECORD_ACCEL_SCALE);
+        }
     } else {
         LOG_WRN("Invalid acceleration stats - window not complete");
         return;
@@ -953,42 +1099,38 @@ static void display_sensor_data(const struct sensor_data *data, uint8_t cnt)
     // printk("-------------------------------------------------------------------------------\n");
 }
 
-// Functions for statistical calculations
-static int compare_double(const void *a, const void *b) {
-	return (*(double*)a > *(double*)b) ? 1 : -1;
-}
-
-void calculate_stats(double *buf, size_t count, struct accel_stats *stats) {
-	if (count < 1) return;
-
-	// calculate mean and variance
-	double sum = 0.0, sum_sq = 0.0;
-	for (size_t i = 0; i < count; i++) {
-		sum += buf[i];
-		sum_sq += buf[i] * buf[i];
-	}
-	stats->mean = sum / count;
-	stats->variance = (sum_sq / count) - (stats->mean * stats->mean);
-
-	// calculate the percentiles
-	qsort(buf, count, sizeof(double), compare_double);
-	stats->p1 = buf[(int)(count * 0.01)];
-	stats->p10 = buf[(int)(count * 0.10)];
-	stats->p90 = buf[(int)(count * 0.90)];
-	stats->p99 = buf[(int)(count * 0.99)];
-}
-
 int main(void)
 {
     int err;
     uint8_t cnt = 0;
     struct nrf_modem_gnss_nmea_data_frame *nmea_data;
-	struct sensor_data sensor_data = {0};
+	struct sensor_record sensor_data = {0};
 	int64_t next_update_time;
+	int64_t sample_ticks;
+	uint32_t reports = 0;
 
     LOG_INF("Starting StingSense Bus Monitoring System");
+	boot_init();
+
+#if defined(CONFIG_STINGSENSE_PROFILE)
+	// Start the cycle counter before the GNSS event handler can run
+	(void)profile_init();
+#endif
+#if defined(CONFIG_STINGSENSE_HEALTH)
+	health_thread_set(HEALTH_THREAD_MAIN, k_current_get());
+	health_thread_set(HEALTH_THREAD_SYSWORKQ, k_work_queue_thread_get(&k_sys_work_q));
+	health_workq_set(HEALTH_WORKQ_SYS, &k_sys_work_q);
+	health_msgq_set(HEALTH_MSGQ_NMEA, &nmea_queue);
+#endif
+#if defined(CONFIG_STINGSENSE_KERNEL_BENCH)
+	// Benchmark the math kernels before GNSS and the sensor loop load the CPU
+	(void)kernel_bench_run(NULL, CONFIG_STINGSENSE_KERNEL_BENCH_ITERATIONS);
+#endif
 
     /* ===== INITIALIZATION PHASE ===== */
+	// Each source of the records is started as soon as it can be, nothing waits for the
+	// network: the accelerometer first, then GNSS, while LTE attaches in the background
+
 	// Configure GPS antenna voltage (required for Icarus)
 	err = nrf_modem_at_printf("AT%%XMAGPIO=1,0,0,1,1,1574,1577");
     if (err) {
@@ -1001,6 +1143,13 @@ int main(void)
         LOG_ERR("Modem library initialization failed, error: %d", err);
         return err;
     }
+	boot_phase_done(BOOT_PHASE_MODEM_LIB);
+
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+	// Model and firmware are read once here, the serving cell is followed from here on, so
+	// that the assistance requests need no AT commands of their own
+	(void)modem_cache_init();
+#endif
 
     // Set up reference coordinates for distance calculation (if configured)
     if (sizeof(CONFIG_GNSS_SAMPLE_REFERENCE_LATITUDE) > 1 &&
@@ -1013,8 +1162,37 @@ int main(void)
 
     // Initialize all required subsystems
     LOG_INF("Initializing hardware subsystems...");
-    
-    // Initialize modem for cellular connectivity
+
+    // Initialize accelerometer sensor, the records do not wait for GNSS or LTE
+    LOG_INF("Initializing accelerometer...");
+    if (!init_accelerometer()) {
+        LOG_ERR("Accelerometer initialization failed");
+        return -1;
+    }
+
+    // No need to initialize RTC as records are stamped from the GNSS-disciplined time base
+    LOG_INF("Using GNSS time base instead of RTC...");
+
+	// Accelerometer samples are taken on the report tick
+	sample_timing_init(REPORT_INTERVAL_MS * USEC_PER_MSEC);
+
+	// The first report is due right away, records are stamped with the uptime until the time
+	// base is set
+	next_update_time = k_uptime_get();
+	boot_phase_done(BOOT_PHASE_ACCEL);
+
+#if defined(CONFIG_STINGSENSE_TX_SCHED)
+	// Before LTE connects, so that the radio on time is counted from the first connection
+	(void)tx_sched_init();
+#endif
+#if defined(CONFIG_STINGSENSE_UPLINK)
+	if (uplink_init(&assist_work_q) != 0) {
+		LOG_ERR("Failed to initialize uplink");
+		return -1;
+	}
+#endif
+
+    // Start the LTE attach for cellular connectivity, without waiting for it
     if (modem_init() != 0) {
         LOG_ERR("Failed to initialize modem");
         return -1;
@@ -1026,8 +1204,8 @@ int main(void)
         return -1;
     }
     
-    // Initialize and start GNSS (GPS) module with time acquisition
-    LOG_INF("Initializing GNSS with time acquisition...");
+    // Initialize and start GNSS (GPS) module, it gets the time from the satellites
+    LOG_INF("Initializing GNSS...");
     if (gnss_init_and_start() != 0) {
         LOG_ERR("Failed to initialize and start GNSS");
         return -1;
@@ -1035,27 +1213,6 @@ int main(void)
     
     // Record timestamp for fix tracking
     fix_timestamp = k_uptime_get();
-    
-    // Initialize accelerometer sensor
-    LOG_INF("Initializing accelerometer...");
-    if (!init_accelerometer()) {
-        LOG_ERR("Accelerometer initialization failed");
-        return -1;
-    }
-    
-    // No need to initialize RTC as we're using GPS time
-    LOG_INF("Using GPS time instead of RTC...");
-    
-    // Initialize sensor data with current date (will be updated with GPS time)
-    sensor_data.dt.year = 2025;
-    sensor_data.dt.month = 3;
-    sensor_data.dt.day = 30;
-    sensor_data.dt.hour = 17;
-    sensor_data.dt.minute = 18;
-    sensor_data.dt.second = 0;
-
-	// Set initial update time to current time
-	next_update_time = k_uptime_get();
 
     /* ===== MAIN APPLICATION LOOP ===== */
 
@@ -1067,19 +1224,52 @@ int main(void)
         // If it's time for the next update (or past time)
         if (remaining <= 0) {
             // Collect all sensor data atomically 
-            collect_sensor_data(&sensor_data);
+            PROFILE_START(PROFILE_COLLECT);
+            collect_sensor_data(&sensor_data, &sample_ticks);
+            PROFILE_END(PROFILE_COLLECT);
             
+            // Sample the health watermarks outside the profiled stages
+            const struct health_record *health = NULL;
+#if defined(CONFIG_STINGSENSE_HEALTH)
+            struct health_record health_record;
+
+            if (health_record_due()) {
+                health_record_get(&health_record);
+                health = &health_record;
+            }
+#endif
+
             // Display all collected data in a single, atomic operation
             cnt++;
-            display_sensor_data(&sensor_data, cnt);
+            PROFILE_START(PROFILE_DISPLAY);
+#if defined(CONFIG_STINGSENSE_OUTPUT_FRAMED)
+            (void)frame_send(FRAME_TYPE_SENSOR, &sensor_data, sizeof(sensor_data));
+            if (health != NULL) {
+                (void)frame_send(FRAME_TYPE_HEALTH, health, sizeof(*health));
+            }
+#else
+            display_sensor_data(&sensor_data, cnt, health);
+#endif
+            PROFILE_END(PROFILE_DISPLAY);
+            boot_phase_done(BOOT_PHASE_FIRST_RECORD);
+#if defined(CONFIG_STINGSENSE_UPLINK)
+            uplink_record_add(&sensor_data);
+#endif
+            sample_timing_report(sample_ticks);
+
+            reports++;
+            if (CONFIG_STINGSENSE_SAMPLE_TIMING_LOG_INTERVAL > 0 &&
+                reports % CONFIG_STINGSENSE_SAMPLE_TIMING_LOG_INTERVAL == 0) {
+                sample_timing_log();
+            }
             
             // Schedule next update precisely 3 seconds from the last scheduled time
-            next_update_time += (3 * MSEC_PER_SEC);
+            next_update_time += REPORT_INTERVAL_MS;
             
             // If we've fallen behind by more than a full cycle, reset the schedule
             if (next_update_time < k_uptime_get()) {
                 LOG_WRN("Update schedule has fallen behind, resetting");
-                next_update_time = k_uptime_get() + (3 * MSEC_PER_SEC);
+                next_update_time = k_uptime_get() + REPORT_INTERVAL_MS;
             }
         }
         
@@ -1094,22 +1284,48 @@ int main(void)
             k_sem_take(events[0].sem, K_NO_WAIT) == 0) {
             
             // Process new PVT data (update internal state only, no printing)
+            gnss_quality_pvt(&last_pvt);
+            if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+                bool fix_ok = true;
+
+                timebase_discipline(&last_pvt.datetime, last_pvt_ticks);
+#if defined(CONFIG_STINGSENSE_FIX_FILTER)
+                fix_ok = fix_filter_accepted(
+                    fix_filter_update(&last_pvt, k_ticks_to_ms_floor64(last_pvt_ticks)));
+#endif
+                // Only fixes that passed the filter are kept for the next start
+                if (fix_ok) {
+                    boot_phase_done(BOOT_PHASE_FIRST_FIX);
+#if defined(CONFIG_GNSS_SAMPLE_FIX_STORE)
+                    fix_store_update(&last_pvt);
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_CELL_CACHE)
+                    cell_cache_fix_add(&last_pvt);
+#endif
+                }
+            }
             if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)) {
                 if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED) {
                     time_blocked++;
                 }
             }
+#if defined(CONFIG_STINGSENSE_HEALTH)
+            // LTE blocked GNSS for this PVT, counted in every mode
+            health_gnss_pvt(last_pvt.flags & (NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED |
+                                              NRF_MODEM_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME));
+#endif
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+            gnss_coex_pvt(&last_pvt);
+#endif
         }
 
         // Handle NMEA data if available
         if (events[1].state == K_POLL_STATE_MSGQ_DATA_AVAILABLE &&
             k_msgq_get(events[1].msgq, &nmea_data, K_NO_WAIT) == 0) {
             
-            // Store NMEA data for later display (not immediate printing)
-            if (nmea_data && !output_paused()) {
-                strncpy(sensor_data.nmea_str, nmea_data->nmea_str, 
-                        sizeof(sensor_data.nmea_str) - 1);
-                sensor_data.nmea_str[sizeof(sensor_data.nmea_str) - 1] = '\0';
+            // Parse the DOPs and C/N0 in place, the sentence is not kept
+            if (nmea_data) {
+                gnss_quality_nmea(nmea_data->nmea_str);
             }
             
             // Free the memory when done
@@ -7,14 +7,16 @@
 #ifndef MCC_LOCATION_TABLE_H_
 #define MCC_LOCATION_TABLE_H_
 
-struct __attribute__ ((__packed__)) mcc_table {
+/* Location of a country. The table is keyed by MCC in a separate array, see
+ * mcc_location_table.csv.
+ */
+struct mcc_table {
 	uint8_t confidence;    /* percentage, 0-100 */
 	uint8_t unc_semiminor; /* scaled, see GNSS interface for details */
 	uint8_t unc_semimajor; /* scaled, see GNSS interface for details */
 	uint8_t orientation;   /* orientation angle between the major axis and north */
 	float lat;
 	float lon;
-	uint16_t mcc;
 };
 
 /**
@@ -44,4 +46,22 @@ int32_t lat_convert(float lat);
  */
 int32_t lon_convert(float lon);
 
+/**
+ * @brief Converts a horizontal uncertainty to the coded representation used by GNSS.
+ *
+ * @param unc[in] Uncertainty in meters.
+ *
+ * @return Coded uncertainty K, r = 10 * (1.1^K - 1) meters, saturated to 127.
+ */
+uint8_t unc_convert(float unc);
+
+/**
+ * @brief Converts an altitude uncertainty to the coded representation used by GNSS.
+ *
+ * @param unc[in] Uncertainty in meters.
+ *
+ * @return Coded uncertainty K, h = 45 * (1.025^K - 1) meters, saturated to 127.
+ */
+uint8_t unc_altitude_convert(float unc);
+
 #endif /* MCC_LOCATION_TABLE_H_ */
@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_at.h>
+#include <modem/lte_lc.h>
+
+#include "modem_cache.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define AT_RESPONSE_MAX_LEN		64
+#define PLMN_STR_MAX_LEN		8 /* MCC + MNC + quotes */
+#define TAC_STR_MAX_LEN			4 /* 16-bit hexadecimal */
+#define CELL_ID_STR_MAX_LEN		8 /* 28-bit hexadecimal */
+
+/* nRF91x1 capabilities until the model has been read. */
+static struct modem_cache_identity identity = {
+	.qzss_assistance = true,
+	.factory_almanac_v3 = true,
+};
+
+static struct k_spinlock lock;
+static struct lte_lc_cell cell = { .id = LTE_LC_CELL_EUTRAN_ID_INVALID };
+static bool operator_valid;
+/* Incremented when the operator may have changed, a read started before is discarded. */
+static uint32_t operator_generation;
+static uint32_t operator_reads;
+static uint32_t cell_reads;
+
+/* Serializes the operator reads of the refresh work and of the readers. */
+static K_MUTEX_DEFINE(operator_mutex);
+static struct k_work operator_work;
+
+/* Sends an AT command and copies the first line of the response. */
+static int at_line_read(const char *cmd, char *buf, size_t size)
+{
+	char resp[AT_RESPONSE_MAX_LEN];
+	int err = nrf_modem_at_cmd(resp, sizeof(resp), "%s", cmd);
+
+	if (err) {
+		return err;
+	}
+
+	resp[strcspn(resp, "\r\n")] = '\0';
+	strncpy(buf, resp, size - 1);
+	buf[size - 1] = '\0';
+
+	return 0;
+}
+
+/* Reads the operator, and the serving cell as seen by the modem at the same time. Called with
+ * the operator mutex held. Returns -EAGAIN and keeps the cached cell if a cell update changed the
+ * tracking area during the read, as the response may be of the old one.
+ */
+static int operator_read(void)
+{
+	char plmn_str[PLMN_STR_MAX_LEN + 1];
+	char tac_str[TAC_STR_MAX_LEN + 1];
+	char cell_id_str[CELL_ID_STR_MAX_LEN + 1];
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t generation = operator_generation;
+	int err = 0;
+	int fields;
+	int mcc;
+	int mnc;
+
+	operator_reads++;
+	k_spin_unlock(&lock, key);
+
+	/* TAC and cell ID are missing when the device isn't registered to a network. */
+	fields = nrf_modem_at_scanf(
+		"AT%XMONITOR",
+		"%%XMONITOR: "
+		"%*d"                                  /* <reg_status>: ignored */
+		",%*[^,]"                              /* <full_name>: ignored */
+		",%*[^,]"                              /* <short_name>: ignored */
+		",%"STRINGIFY(PLMN_STR_MAX_LEN)"[^,]"  /* <plmn> */
+		",\"%"STRINGIFY(TAC_STR_MAX_LEN)"[0-9A-F]\"" /* <tac> */
+		",%*d"                                 /* <AcT>: ignored */
+		",%*d"                                 /* <band>: ignored */
+		",\"%"STRINGIFY(CELL_ID_STR_MAX_LEN)"[0-9A-F]\"", /* <cell_id> */
+		plmn_str, tac_str, cell_id_str);
+	if (fields < 1 || strlen(plmn_str) < 7) {
+		return -EIO;
+	}
+
+	/* The PLMN is quoted, 3 digits of MCC then 2 or 3 digits of MNC. */
+	mnc = strtol(plmn_str + 4, NULL, 10);
+	plmn_str[4] = '\0';
+	mcc = strtol(plmn_str + 1, NULL, 10);
+
+	key = k_spin_lock(&lock);
+	if (generation != operator_generation) {
+		err = -EAGAIN;
+	} else {
+		cell.mcc = mcc;
+		cell.mnc = mnc;
+		if (fields == 3) {
+			cell.id = strtoul(cell_id_str, NULL, 16);
+			cell.tac = strtoul(tac_str, NULL, 16);
+		}
+		operator_valid = true;
+	}
+	k_spin_unlock(&lock, key);
+
+	return err;
+}
+
+/* Returns true if the operator has to be read: registered, but not read since the tracking
+ * area changed.
+ */
+static bool operator_stale(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool stale = (cell.id != LTE_LC_CELL_EUTRAN_ID_INVALID) && !operator_valid;
+
+	k_spin_unlock(&lock, key);
+
+	return stale;
+}
+
+static void operator_work_fn(struct k_work *work)
+{
+	int err = 0;
+
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&operator_mutex, K_FOREVER);
+	if (operator_stale()) {
+		err = operator_read();
+	}
+	k_mutex_unlock(&operator_mutex);
+
+	/* After -EAGAIN, the cell update that overtook the read has submitted the work again. */
+	if (err && err != -EAGAIN) {
+		LOG_WRN("Failed to read the operator");
+	}
+}
+
+static void lte_evt_handler(const struct lte_lc_evt *const evt)
+{
+	k_spinlock_key_t key;
+	bool refresh;
+
+	if (evt->type != LTE_LC_EVT_CELL_UPDATE) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	/* The operator only changes with the tracking area, or after losing the network. */
+	refresh = (evt->cell.id != LTE_LC_CELL_EUTRAN_ID_INVALID) &&
+		  (cell.id == LTE_LC_CELL_EUTRAN_ID_INVALID || evt->cell.tac != cell.tac);
+	cell.id = evt->cell.id;
+	cell.tac = evt->cell.tac;
+	if (refresh) {
+		operator_valid = false;
+		operator_generation++;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (refresh) {
+		k_work_submit(&operator_work);
+	}
+}
+
+int modem_cache_init(void)
+{
+	int err;
+
+	k_work_init(&operator_work, operator_work_fn);
+	lte_lc_register_handler(lte_evt_handler);
+
+	err = at_line_read("AT+CGMM", identity.model, sizeof(identity.model));
+	if (err == 0) {
+		err = at_line_read("AT+CGMR", identity.firmware, sizeof(identity.firmware));
+	}
+	if (err) {
+		LOG_ERR("Failed to read modem identity, error: %d", err);
+		return err;
+	}
+
+	/* nRF9160 supports neither QZSS assistance nor the version 3 factory almanac, nRF91x1
+	 * do.
+	 */
+	if (strstr(identity.model, "nRF9160") != NULL) {
+		identity.qzss_assistance = false;
+		identity.factory_almanac_v3 = false;
+	}
+
+	LOG_INF("Modem %s, firmware %s", identity.model, identity.firmware);
+
+	return 0;
+}
+
+const struct modem_cache_identity *modem_cache_identity(void)
+{
+	return &identity;
+}
+
+int modem_cache_cell_get(struct lte_lc_cell *out)
+{
+	k_spinlock_key_t key;
+	int err = 0;
+
+	if (operator_stale()) {
+		k_mutex_lock(&operator_mutex, K_FOREVER);
+		if (operator_stale()) {
+			err = operator_read();
+			if (err == -EAGAIN) {
+				/* Overtaken by a tracking area change, read the new one. */
+				err = operator_read();
+			}
+		}
+		k_mutex_unlock(&operator_mutex);
+	}
+
+	key = k_spin_lock(&lock);
+	if (cell.id == LTE_LC_CELL_EUTRAN_ID_INVALID) {
+		err = -ENODATA;
+	} else if (err == 0) {
+		*out = cell;
+		cell_reads++;
+	} else {
+		err = -EIO;
+	}
+	k_spin_unlock(&lock, key);
+
+	return err;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_modem_cache(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct lte_lc_cell snapshot = cell;
+	bool snapshot_operator_valid = operator_valid;
+	uint32_t snapshot_operator_reads = operator_reads;
+	uint32_t snapshot_cell_reads = cell_reads;
+
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "model,firmware,qzss_assistance,factory_almanac_v3");
+	shell_print(sh, "%s,%s,%d,%d", identity.model, identity.firmware,
+		    identity.qzss_assistance, identity.factory_almanac_v3);
+
+	shell_print(sh, "cell_id,tac,mcc,mnc,cell_reads,operator_reads");
+	if (snapshot.id == LTE_LC_CELL_EUTRAN_ID_INVALID) {
+		shell_print(sh, ",,,,%u,%u", snapshot_cell_reads, snapshot_operator_reads);
+	} else if (!snapshot_operator_valid) {
+		shell_print(sh, "%x,%x,,,%u,%u", snapshot.id, snapshot.tac, snapshot_cell_reads,
+			    snapshot_operator_reads);
+	} else {
+		shell_print(sh, "%x,%x,%d,%d,%u,%u", snapshot.id, snapshot.tac, snapshot.mcc,
+			    snapshot.mnc, snapshot_cell_reads, snapshot_operator_reads);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(modem_cache, NULL,
+		   "Print the cached modem identity and serving cell, and the reads, as CSV",
+		   cmd_modem_cache);
+#endif /* CONFIG_SHELL */
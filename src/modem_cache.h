@@ -0,0 +1,53 @@
+#ifndef MODEM_CACHE_H_
+#define MODEM_CACHE_H_
+
+#include <zephyr/kernel.h>
+#include <modem/lte_lc.h>
+
+/**
+ * Modem information cache.
+ *
+ * The model and firmware version are read once at init and the capabilities derived from them.
+ * The serving cell is taken from the lte_lc cell update events, and the operator is read again
+ * only when the tracking area changes, in the background. Readers get the cached values without
+ * any AT command, which would block the caller for the AT round trip.
+ */
+
+struct modem_cache_identity {
+	char model[24];			/* AT+CGMM, for example "nRF9160-SICA" */
+	char firmware[40];		/* AT+CGMR, for example "mfw_nrf9160_1.3.5" */
+	bool qzss_assistance;		/* QZSS assistance data supported, nRF91x1 */
+	bool factory_almanac_v3;	/* Factory almanac in format version 3, nRF91x1 */
+};
+
+/**
+ * @brief Reads the modem identity and starts following the serving cell.
+ *
+ * @details Called after nrf_modem_lib_init() and before LTE is activated.
+ *
+ * @retval 0 on success.
+ * @retval -errno if the identity could not be read, the capabilities are those of nRF91x1.
+ */
+int modem_cache_init(void);
+
+/**
+ * @brief Returns the modem identity read at init.
+ */
+const struct modem_cache_identity *modem_cache_identity(void);
+
+/**
+ * @brief Returns the serving cell.
+ *
+ * @details The ID and TAC are always current. The MCC and MNC are read from the modem if the
+ *          background refresh after a tracking area change has not completed yet.
+ *
+ * @param[out] cell Serving cell, id, tac, mcc and mnc set.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if not registered to a network.
+ * @retval -EIO if the operator could not be read, or the tracking area changed again while it
+ *              was read.
+ */
+int modem_cache_cell_get(struct lte_lc_cell *cell);
+
+#endif /* MODEM_CACHE_H_ */
@@ -0,0 +1,388 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+#include <modem/modem_info.h>
+
+#include "pgps_sched.h"
+#include "tx_sched.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define PERIOD_MS		((int64_t)CONFIG_NRF_CLOUD_PGPS_PREDICTION_PERIOD * 60 * MSEC_PER_SEC)
+#define SPAN_MS			(CONFIG_NRF_CLOUD_PGPS_NUM_PREDICTIONS * PERIOD_MS)
+#define URGENT_MS		((int64_t)CONFIG_STINGSENSE_PGPS_PREFETCH_URGENT * 3600 * MSEC_PER_SEC)
+#define GOOD_RSRP_DBM		CONFIG_STINGSENSE_PGPS_PREFETCH_RSRP
+/* A download that has not ended by then has failed without an event. */
+#define FETCH_TIMEOUT_MS	(5 * 60 * MSEC_PER_SEC)
+/* An expiry estimate the library did not agree with is not acted on again before this. */
+#define PREFETCH_RETRY_MS	(60 * 60 * MSEC_PER_SEC)
+
+/* Serving cells remembered, the least recently seen is replaced. */
+#define COVERAGE_CELLS		32
+/* Readings before the mean RSRP of a cell is trusted. */
+#define COVERAGE_MIN_SAMPLES	4
+#define RSRP_UNKNOWN		INT16_MIN
+#define RSRP_NOT_KNOWN_IDX	255
+
+enum fetch_reason {
+	FETCH_GOOD,		/* Connected with a good signal */
+	FETCH_URGENT,		/* Few predictions left, whatever the signal */
+	FETCH_UNKNOWN,		/* Predictions of unknown age, as the library asks */
+	FETCH_REASON_COUNT
+};
+
+static const char *const fetch_reason_names[FETCH_REASON_COUNT] = {
+	[FETCH_GOOD] = "good",
+	[FETCH_URGENT] = "urgent",
+	[FETCH_UNKNOWN] = "unknown",
+};
+
+struct coverage_cell {
+	uint32_t id;
+	int16_t rsrp_x8;	/* Mean RSRP in 1/8 dBm, exponentially weighted */
+	uint16_t samples;
+	int64_t seen_ms;
+};
+
+static pgps_sched_fetch_t fetch_cb;
+static struct k_work eval_work;
+static struct k_work_delayable deadline_work;
+
+/* Released at the next connection, or when the download becomes urgent. */
+static void tx_release(struct tx_sched_client *client)
+{
+	ARG_UNUSED(client);
+
+	k_work_submit(&eval_work);
+}
+
+static struct tx_sched_client tx_client = {
+	.name = "pgps",
+	.release = tx_release,
+};
+
+static struct k_spinlock lock;
+static struct coverage_cell cells[COVERAGE_CELLS];
+static uint32_t cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+static int16_t rsrp_dbm = RSRP_UNKNOWN;
+
+static bool downloaded;		/* downloaded_ms is known */
+static int64_t downloaded_ms;	/* End of the last download, the set was complete then */
+static bool request_pending;	/* A request of the library is held back */
+static bool fetching;
+static int64_t fetch_started_ms;
+static int16_t fetch_rsrp_dbm;
+static enum fetch_reason fetch_reason;
+static int64_t prefetched_ms = -PREFETCH_RETRY_MS;	/* Expired predictions last requested */
+
+/* Since boot. */
+static uint32_t fetches[FETCH_REASON_COUNT];
+static uint32_t deferred;
+static uint32_t failures;
+static uint64_t fetch_ms_sum;
+static uint32_t fetch_ms_count;
+
+/* Returns the cell entry, a new one replacing the least recently seen if needed. Called with the
+ * lock held.
+ */
+static struct coverage_cell *coverage_cell_get(uint32_t id, bool add)
+{
+	struct coverage_cell *oldest = &cells[0];
+
+	for (int i = 0; i < COVERAGE_CELLS; i++) {
+		if (cells[i].samples > 0 && cells[i].id == id) {
+			return &cells[i];
+		}
+		if (cells[i].seen_ms < oldest->seen_ms) {
+			oldest = &cells[i];
+		}
+	}
+
+	if (!add) {
+		return NULL;
+	}
+
+	*oldest = (struct coverage_cell){ .id = id };
+
+	return oldest;
+}
+
+/* Returns true while connected with a good signal, in a cell that is not known to be weak.
+ * Called with the lock held.
+ */
+static bool window_good(void)
+{
+	struct coverage_cell *cell = coverage_cell_get(cell_id, false);
+
+	if (!tx_sched_connected() || rsrp_dbm == RSRP_UNKNOWN || rsrp_dbm < GOOD_RSRP_DBM) {
+		return false;
+	}
+
+	return cell == NULL || cell->samples < COVERAGE_MIN_SAMPLES ||
+	       cell->rsrp_x8 / 8 >= GOOD_RSRP_DBM;
+}
+
+static void fetch_start(enum fetch_reason reason, int64_t now)
+{
+	fetching = true;
+	fetch_started_ms = now;
+	fetch_rsrp_dbm = rsrp_dbm;
+	fetch_reason = reason;
+	fetches[reason]++;
+}
+
+static void eval_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	int64_t remaining_ms = downloaded ? SPAN_MS - (now - downloaded_ms) : 0;
+	int64_t expired = downloaded ? (now - downloaded_ms) / PERIOD_MS : 0;
+	bool pending = request_pending;
+	int16_t signal_dbm = rsrp_dbm;
+	enum fetch_reason reason;
+
+	if (fetching && now - fetch_started_ms < FETCH_TIMEOUT_MS) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+	fetching = false;
+
+	if (!pending && (!downloaded || expired < CONFIG_NRF_CLOUD_PGPS_REPLACEMENT_THRESHOLD ||
+			 now - prefetched_ms < PREFETCH_RETRY_MS)) {
+		/* Nothing to download. */
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	if (remaining_ms <= URGENT_MS) {
+		reason = FETCH_URGENT;
+	} else if (window_good()) {
+		reason = FETCH_GOOD;
+	} else {
+		bool connected = tx_sched_connected();
+
+		k_spin_unlock(&lock, key);
+
+		/* Until the urgent point, wait for the next connection, or for the signal of this
+		 * one to improve.
+		 */
+		k_work_reschedule(&deadline_work, K_MSEC(remaining_ms - URGENT_MS));
+		if (!connected) {
+			tx_sched_request(&tx_client, K_MSEC(remaining_ms - URGENT_MS));
+		}
+		return;
+	}
+
+	request_pending = false;
+	if (pending) {
+		fetch_start(reason, now);
+	} else {
+		/* The library asks for the expired predictions, if it agrees they have expired. */
+		prefetched_ms = now;
+	}
+	k_spin_unlock(&lock, key);
+
+	(void)k_work_cancel_delayable(&deadline_work);
+
+	LOG_INF("P-GPS prefetch: %s, %lld of %d hours of predictions left, RSRP %d dBm",
+		fetch_reason_names[reason], remaining_ms / (3600 * MSEC_PER_SEC),
+		(int)(SPAN_MS / (3600 * MSEC_PER_SEC)), signal_dbm);
+
+	fetch_cb(pending);
+}
+
+static void deadline_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_work_submit(&eval_work);
+}
+
+static void rsrp_handler(char rsrp_idx)
+{
+	uint8_t idx = rsrp_idx;
+	k_spinlock_key_t key;
+	struct coverage_cell *cell;
+
+	if (idx == RSRP_NOT_KNOWN_IDX) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	rsrp_dbm = RSRP_IDX_TO_DBM(idx);
+	if (cell_id != LTE_LC_CELL_EUTRAN_ID_INVALID) {
+		cell = coverage_cell_get(cell_id, true);
+		cell->rsrp_x8 = cell->samples ? cell->rsrp_x8 + (rsrp_dbm * 8 - cell->rsrp_x8) / 8 :
+						rsrp_dbm * 8;
+		cell->samples = MIN(cell->samples + 1, UINT16_MAX);
+		cell->seen_ms = k_uptime_get();
+	}
+	k_spin_unlock(&lock, key);
+
+	k_work_submit(&eval_work);
+}
+
+static void lte_evt_handler(const struct lte_lc_evt *const evt)
+{
+	k_spinlock_key_t key;
+
+	switch (evt->type) {
+	case LTE_LC_EVT_CELL_UPDATE:
+		key = k_spin_lock(&lock);
+		cell_id = evt->cell.id;
+		/* The RSRP of the new cell is not known until the next notification. */
+		rsrp_dbm = RSRP_UNKNOWN;
+		k_spin_unlock(&lock, key);
+		break;
+
+	case LTE_LC_EVT_RRC_UPDATE:
+		if (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED) {
+			k_work_submit(&eval_work);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+int pgps_sched_init(pgps_sched_fetch_t fetch)
+{
+	int err;
+
+	fetch_cb = fetch;
+	k_work_init(&eval_work, eval_work_fn);
+	k_work_init_delayable(&deadline_work, deadline_work_fn);
+	lte_lc_register_handler(lte_evt_handler);
+
+	err = modem_info_init();
+	if (err == 0) {
+		err = modem_info_rsrp_register(rsrp_handler);
+	}
+	if (err) {
+		LOG_ERR("Failed to enable RSRP notifications, error: %d", err);
+	}
+
+	return err;
+}
+
+bool pgps_sched_request(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	bool defer = false;
+
+	if (!downloaded) {
+		/* Without a download of our own, the library knows best. */
+		fetch_start(FETCH_UNKNOWN, now);
+	} else if (fetching && now - fetch_started_ms < FETCH_TIMEOUT_MS) {
+		/* The request of a fetch started here. */
+	} else if (SPAN_MS - (now - downloaded_ms) <= URGENT_MS) {
+		fetch_start(FETCH_URGENT, now);
+	} else if (window_good()) {
+		fetch_start(FETCH_GOOD, now);
+	} else {
+		request_pending = true;
+		deferred++;
+		defer = true;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (defer) {
+		LOG_INF("P-GPS request held back until a good signal");
+		k_work_submit(&eval_work);
+	}
+
+	return defer;
+}
+
+void pgps_sched_fetch_done(bool stored)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	uint32_t fetch_ms = now - fetch_started_ms;
+	bool ours = fetching;
+	enum fetch_reason reason = fetch_reason;
+	int16_t signal_dbm = fetch_rsrp_dbm;
+
+	fetching = false;
+	if (ours && stored) {
+		downloaded = true;
+		downloaded_ms = now;
+		fetch_ms_sum += fetch_ms;
+		fetch_ms_count++;
+	} else if (ours) {
+		failures++;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (ours) {
+		LOG_INF("P-GPS download %s in %u ms, %s, RSRP %d dBm at start",
+			stored ? "done" : "failed", fetch_ms, fetch_reason_names[reason], signal_dbm);
+	}
+}
+
+void pgps_sched_check(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool unknown = !downloaded && !fetching;
+
+	k_spin_unlock(&lock, key);
+
+	if (unknown) {
+		/* Stored predictions of unknown age, the library checks them. */
+		fetch_cb(false);
+		return;
+	}
+
+	k_work_submit(&eval_work);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_pgps_sched(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	int64_t remaining_ms = downloaded ? SPAN_MS - (now - downloaded_ms) : -1;
+	uint32_t snapshot_fetches[FETCH_REASON_COUNT];
+	uint32_t snapshot_deferred = deferred;
+	uint32_t snapshot_failures = failures;
+	uint32_t mean_ms = fetch_ms_count ? fetch_ms_sum / fetch_ms_count : 0;
+	uint32_t snapshot_cell_id = cell_id;
+	int16_t snapshot_rsrp_dbm = rsrp_dbm;
+	bool good = window_good();
+	struct coverage_cell snapshot_cells[COVERAGE_CELLS];
+
+	memcpy(snapshot_fetches, fetches, sizeof(snapshot_fetches));
+	memcpy(snapshot_cells, cells, sizeof(snapshot_cells));
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "hours_left,fetches_good,fetches_urgent,fetches_unknown,deferred,failures,"
+			"mean_fetch_ms,cell_id,rsrp_dbm,good");
+	shell_print(sh, "%lld,%u,%u,%u,%u,%u,%u,%x,%d,%d",
+		    remaining_ms < 0 ? -1 : remaining_ms / (3600 * MSEC_PER_SEC),
+		    snapshot_fetches[FETCH_GOOD], snapshot_fetches[FETCH_URGENT],
+		    snapshot_fetches[FETCH_UNKNOWN], snapshot_deferred, snapshot_failures, mean_ms,
+		    snapshot_cell_id, snapshot_rsrp_dbm == RSRP_UNKNOWN ? 0 : snapshot_rsrp_dbm, good);
+
+	shell_print(sh, "cell_id,mean_rsrp_dbm,samples,seen_s_ago");
+	for (int i = 0; i < COVERAGE_CELLS; i++) {
+		if (snapshot_cells[i].samples == 0) {
+			continue;
+		}
+		shell_print(sh, "%x,%d,%u,%lld", snapshot_cells[i].id,
+			    snapshot_cells[i].rsrp_x8 / 8, snapshot_cells[i].samples,
+			    (now - snapshot_cells[i].seen_ms) / MSEC_PER_SEC);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(pgps_sched, NULL,
+		   "Print the P-GPS downloads and the RSRP learned per cell as CSV",
+		   cmd_pgps_sched);
+#endif /* CONFIG_SHELL */
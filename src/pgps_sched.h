@@ -0,0 +1,62 @@
+#ifndef PGPS_SCHED_H_
+#define PGPS_SCHED_H_
+
+#include <stdbool.h>
+
+/**
+ * P-GPS prefetch scheduler.
+ *
+ * The P-GPS predictions are fetched ahead of need, while an RRC connection is up and the signal
+ * is good, instead of whenever the P-GPS library asks. The RSRP of each serving cell along the
+ * route is learned from the modem notifications, so that one strong reading in a cell known to
+ * be weak does not start a download. The predictions left are estimated from the time of the
+ * last download.
+ *
+ * A download is due when the library has asked for one, or when enough predictions have expired
+ * for it to replace them. A due download waits for a good window until fewer than
+ * CONFIG_STINGSENSE_PGPS_PREFETCH_URGENT hours of predictions are left, then starts at the next
+ * connection or at the latest then, as a transmit scheduler client (tx_sched.h).
+ */
+
+/**
+ * @brief Fetch callback, called from the system work queue.
+ *
+ * @param[in] request_pending True if a request of the library was held back and is to be sent,
+ *                            false if the expired predictions are to be requested.
+ */
+typedef void (*pgps_sched_fetch_t)(bool request_pending);
+
+/**
+ * @brief Initializes the scheduler.
+ *
+ * @details Registers for the LTE link controller events and the RSRP notifications, call
+ *          before LTE is connected.
+ *
+ * @param[in] fetch Fetch callback.
+ *
+ * @retval 0 on success.
+ * @retval -errno if the RSRP notifications could not be enabled.
+ */
+int pgps_sched_init(pgps_sched_fetch_t fetch);
+
+/**
+ * @brief Handles a prediction request of the P-GPS library.
+ *
+ * @retval true if the request is held back, the fetch callback is called later.
+ * @retval false if the request is to be sent now.
+ */
+bool pgps_sched_request(void);
+
+/**
+ * @brief Ends a download.
+ *
+ * @param[in] stored True if the predictions were stored, false if the download failed.
+ */
+void pgps_sched_fetch_done(bool stored);
+
+/**
+ * @brief Checks whether a download is due, after a prediction has been injected.
+ */
+void pgps_sched_check(void);
+
+#endif /* PGPS_SCHED_H_ */
@@ -0,0 +1,160 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+
+#include "profile.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* Empty stages timed to find the profiling overhead. */
+#define PROFILE_CALIBRATION_ROUNDS	16
+
+static struct k_spinlock lock;
+static struct histogram stages[PROFILE_STAGE_COUNT];
+static int64_t reset_ms;
+/* Cycles between the two counter reads of an empty stage, subtracted from every sample. */
+static uint32_t probe_cycles;
+/* Cycles of a complete empty stage including recording it, the cost of profiling a sample. */
+static uint32_t sample_cycles;
+
+static void stages_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+		histogram_reset(&stages[i]);
+	}
+	reset_ms = k_uptime_get();
+
+	k_spin_unlock(&lock, key);
+}
+
+int profile_init(void)
+{
+	uint32_t start;
+
+	if (DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) {
+		LOG_ERR("DWT cycle counter not available");
+		return -ENOTSUP;
+	}
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	/* The counter doesn't run if the secure side hasn't allowed debug access. */
+	start = DWT->CYCCNT;
+	k_busy_wait(10);
+	if (DWT->CYCCNT == start) {
+		LOG_ERR("DWT cycle counter not running");
+		return -ENOTSUP;
+	}
+
+	probe_cycles = UINT32_MAX;
+	sample_cycles = UINT32_MAX;
+	for (int i = 0; i < PROFILE_CALIBRATION_ROUNDS; i++) {
+		uint32_t inner;
+
+		start = DWT->CYCCNT;
+		inner = DWT->CYCCNT;
+		inner = DWT->CYCCNT - inner;
+		profile_add(PROFILE_COLLECT, inner);
+		sample_cycles = MIN(sample_cycles, DWT->CYCCNT - start);
+		probe_cycles = MIN(probe_cycles, inner);
+	}
+
+	stages_reset();
+
+	LOG_INF("Cycle count profiling enabled, %u cycles per sample", sample_cycles);
+
+	return 0;
+}
+
+void profile_add(enum profile_stage stage, uint32_t cycles)
+{
+	k_spinlock_key_t key;
+
+	cycles = (cycles > probe_cycles) ? cycles - probe_cycles : 0;
+
+	key = k_spin_lock(&lock);
+	histogram_add(&stages[stage], cycles);
+	k_spin_unlock(&lock, key);
+}
+
+void profile_stage_get(enum profile_stage stage, struct histogram *hist)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*hist = stages[stage];
+
+	k_spin_unlock(&lock, key);
+}
+
+const char *profile_stage_str(enum profile_stage stage)
+{
+	switch (stage) {
+	case PROFILE_COLLECT:
+		return "collect";
+
+	case PROFILE_STATS:
+		return "stats";
+
+	case PROFILE_DISPLAY:
+		return "display";
+
+	case PROFILE_GNSS_EVENT:
+		return "gnss_event";
+
+	case PROFILE_AGNSS_WORK:
+		return "agnss_work";
+
+	case PROFILE_PGPS_WORK:
+		return "pgps_work";
+
+	default:
+		return "unknown";
+	}
+}
+
+static int cmd_show(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t cycles_per_us = SystemCoreClock / USEC_PER_SEC;
+	uint64_t elapsed_cycles = (uint64_t)(k_uptime_get() - reset_ms) * USEC_PER_MSEC *
+				  cycles_per_us;
+	uint64_t overhead_cycles = 0;
+	struct histogram hist;
+
+	shell_print(sh, "stage,count,min_cyc,avg_cyc,p99_cyc,max_cyc,avg_us,max_us,cpu_pct");
+	for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+		profile_stage_get(i, &hist);
+		overhead_cycles += (uint64_t)hist.count * sample_cycles;
+
+		shell_print(sh, "%s,%u,%u,%u,%u,%u,%u,%u,%.3f", profile_stage_str(i), hist.count,
+			    hist.min, histogram_avg(&hist), histogram_percentile(&hist, 99),
+			    hist.max, histogram_avg(&hist) / cycles_per_us,
+			    hist.max / cycles_per_us,
+			    elapsed_cycles ? 100.0 * hist.sum / elapsed_cycles : 0.0);
+	}
+
+	shell_print(sh, "Profiling overhead: %u cycles per sample, %.4f%% of CPU time",
+		    sample_cycles, elapsed_cycles ? 100.0 * overhead_cycles / elapsed_cycles : 0.0);
+
+	return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	stages_reset();
+
+	shell_print(sh, "Profile statistics cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(profile_cmds,
+	SHELL_CMD(show, NULL, "Print cycle counts per stage as CSV", cmd_show),
+	SHELL_CMD(reset, NULL, "Clear the statistics", cmd_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(profile, &profile_cmds, "Per-stage cycle count profiling", NULL);
@@ -0,0 +1,66 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <zephyr/kernel.h>
+
+#include "histogram.h"
+
+/** @brief Profiled stages. */
+enum profile_stage {
+	PROFILE_COLLECT,	/* collect_sensor_data(), including calculate_stats() */
+	PROFILE_STATS,		/* One calculate_stats() call */
+	PROFILE_DISPLAY,	/* display_sensor_data() */
+	PROFILE_GNSS_EVENT,	/* gnss_event_handler(), in interrupt context */
+	PROFILE_AGNSS_WORK,	/* A-GNSS request work item */
+	PROFILE_PGPS_WORK,	/* P-GPS download and injection work items */
+	PROFILE_STAGE_COUNT
+};
+
+#if defined(CONFIG_STINGSENSE_PROFILE)
+#include <cmsis_core.h>
+
+/**
+ * @brief Starts timing a stage.
+ *
+ * @details Declares a local variable, so PROFILE_END() for the same stage must be in the same
+ *          scope. Both expand to nothing when CONFIG_STINGSENSE_PROFILE is disabled.
+ */
+#define PROFILE_START(stage) const uint32_t profile_start_##stage = DWT->CYCCNT
+
+/** @brief Adds the cycles since PROFILE_START() to the statistics of a stage. */
+#define PROFILE_END(stage) profile_add(stage, DWT->CYCCNT - profile_start_##stage)
+
+/**
+ * @brief Enables the DWT cycle counter and clears the statistics.
+ *
+ * @retval 0 on success.
+ * @retval -ENOTSUP if the cycle counter is not available.
+ */
+int profile_init(void);
+
+/**
+ * @brief Adds a cycle count to the statistics of a stage, use PROFILE_END() instead.
+ *
+ * @details Callable from interrupt context.
+ */
+void profile_add(enum profile_stage stage, uint32_t cycles);
+
+/**
+ * @brief Copies the cycle count histogram of a stage.
+ *
+ * @param[in]  stage Stage.
+ * @param[out] hist  Cycle counts of the stage since boot or the last reset.
+ */
+void profile_stage_get(enum profile_stage stage, struct histogram *hist);
+
+/**
+ * @brief Returns a printable name of a stage.
+ */
+const char *profile_stage_str(enum profile_stage stage);
+
+#else
+#define PROFILE_START(stage)
+#define PROFILE_END(stage)
+#endif /* CONFIG_STINGSENSE_PROFILE */
+
+#endif /* PROFILE_H_ */
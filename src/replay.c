@@ -0,0 +1,115 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_STINGSENSE_REPLAY_EXIT)
+#include <posix_board_if.h>
+#endif
+
+#include "replay.h"
+#include "sample_timing.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* Generated from CONFIG_STINGSENSE_REPLAY_TRACE by scripts/gen_replay_trace.py */
+#include "replay_trace.inc"
+
+#define REPLAY_DURATION_MS ((int64_t)REPLAY_ACCEL_COUNT * MSEC_PER_SEC / REPLAY_ACCEL_RATE_HZ)
+
+static atomic_t finished;
+
+int replay_accel_get(int64_t t_ms, double xyz[3])
+{
+	int64_t idx = t_ms * REPLAY_ACCEL_RATE_HZ / MSEC_PER_SEC;
+
+	if (t_ms < 0 || idx >= REPLAY_ACCEL_COUNT) {
+		return -ENODATA;
+	}
+
+	xyz[0] = replay_accel[idx].x / 1000.0;
+	xyz[1] = replay_accel[idx].y / 1000.0;
+	xyz[2] = replay_accel[idx].z / 1000.0;
+
+	return 0;
+}
+
+int replay_fix_get(int64_t t_ms, struct replay_fix *fix)
+{
+	const struct replay_fix *prev;
+	const struct replay_fix *next;
+	size_t lo = 0;
+	size_t hi = REPLAY_FIX_COUNT;
+	double frac;
+
+	if (t_ms < 0 || t_ms >= REPLAY_DURATION_MS) {
+		return -ENODATA;
+	}
+
+	*fix = (struct replay_fix) {
+		.t_ms = (uint32_t)t_ms,
+		.latitude = REPLAY_NO_FIX,
+	};
+
+	if (REPLAY_FIX_COUNT == 0 || t_ms < replay_fixes[0].t_ms) {
+		return 0;
+	}
+
+	/* Last trace point at or before t_ms. */
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (replay_fixes[mid].t_ms <= t_ms) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	prev = &replay_fixes[lo];
+	if (prev->latitude == REPLAY_NO_FIX) {
+		return 0;
+	}
+
+	fix->latitude = prev->latitude;
+	fix->longitude = prev->longitude;
+	fix->speed = prev->speed;
+	fix->heading = prev->heading;
+
+	if (lo + 1 < REPLAY_FIX_COUNT) {
+		next = &replay_fixes[lo + 1];
+		if (next->latitude != REPLAY_NO_FIX) {
+			frac = (double)(t_ms - prev->t_ms) / (next->t_ms - prev->t_ms);
+			fix->latitude += (int32_t)((next->latitude - prev->latitude) * frac);
+			fix->longitude += (int32_t)((next->longitude - prev->longitude) * frac);
+		}
+	}
+
+	return 0;
+}
+
+uint32_t replay_start_utc(void)
+{
+	return REPLAY_START_UTC_S;
+}
+
+static void finish_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	LOG_INF("Replay finished: %u s of trace, %u positions, %u accelerometer samples",
+		(uint32_t)(REPLAY_DURATION_MS / MSEC_PER_SEC), REPLAY_FIX_COUNT,
+		REPLAY_ACCEL_COUNT);
+	sample_timing_log();
+
+#if defined(CONFIG_STINGSENSE_REPLAY_EXIT)
+	posix_exit(0);
+#endif
+}
+
+static K_WORK_DEFINE(finish_work, finish_work_fn);
+
+void replay_finish(void)
+{
+	if (atomic_set(&finished, 1) == 0) {
+		k_work_submit(&finish_work);
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <zephyr/kernel.h>
+
+/* Latitude of a trace point without a fix. */
+#define REPLAY_NO_FIX INT32_MIN
+
+/** @brief Accelerometer sample of the trace, in mm/s^2. */
+struct replay_accel {
+	int16_t x;
+	int16_t y;
+	int16_t z;
+};
+
+/** @brief Position of the trace. */
+struct replay_fix {
+	uint32_t t_ms;		/* Trace time */
+	int32_t latitude;	/* 1e-7 degrees, REPLAY_NO_FIX if there is no fix */
+	int32_t longitude;	/* 1e-7 degrees */
+	uint16_t speed;		/* cm/s */
+	uint16_t heading;	/* Centidegrees */
+};
+
+/**
+ * @brief Returns the accelerometer sample at a point of the trace.
+ *
+ * @details The trace starts at boot, so the trace time is the uptime.
+ *
+ * @param[in]  t_ms Trace time.
+ * @param[out] xyz  Acceleration in m/s^2.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if the trace has ended.
+ */
+int replay_accel_get(int64_t t_ms, double xyz[3]);
+
+/**
+ * @brief Returns the position at a point of the trace, interpolated between trace points.
+ *
+ * @param[in]  t_ms Trace time.
+ * @param[out] fix  Position, with the latitude set to REPLAY_NO_FIX if there is no fix.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if the trace has ended.
+ */
+int replay_fix_get(int64_t t_ms, struct replay_fix *fix);
+
+/**
+ * @brief Returns the UTC time of the start of the trace, in seconds since the Unix epoch.
+ */
+uint32_t replay_start_utc(void);
+
+/**
+ * @brief Ends the replay, callable from interrupt context.
+ *
+ * @details Logs a summary and exits the native_sim executable if CONFIG_STINGSENSE_REPLAY_EXIT
+ *          is enabled.
+ */
+void replay_finish(void);
+
+#endif /* REPLAY_H_ */
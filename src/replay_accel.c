@@ -0,0 +1,57 @@
+#define DT_DRV_COMPAT stingsense_replay_accel
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#include "replay.h"
+
+/* Emulated accelerometer that plays back the trace through the regular sensor API, so that
+ * accelerometer.c runs unchanged on native_sim.
+ */
+
+struct replay_accel_data {
+	double xyz[3];
+};
+
+static int replay_accel_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	struct replay_accel_data *data = dev->data;
+
+	return replay_accel_get(k_uptime_get(), data->xyz);
+}
+
+static int replay_accel_channel_get(const struct device *dev, enum sensor_channel chan,
+				    struct sensor_value *val)
+{
+	struct replay_accel_data *data = dev->data;
+
+	switch (chan) {
+	case SENSOR_CHAN_ACCEL_X:
+	case SENSOR_CHAN_ACCEL_Y:
+	case SENSOR_CHAN_ACCEL_Z:
+		return sensor_value_from_double(val, data->xyz[chan - SENSOR_CHAN_ACCEL_X]);
+
+	case SENSOR_CHAN_ACCEL_XYZ:
+		for (int i = 0; i < 3; i++) {
+			sensor_value_from_double(&val[i], data->xyz[i]);
+		}
+		return 0;
+
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static const struct sensor_driver_api replay_accel_api = {
+	.sample_fetch = replay_accel_sample_fetch,
+	.channel_get = replay_accel_channel_get,
+};
+
+#define REPLAY_ACCEL_DEFINE(inst)							\
+	static struct replay_accel_data replay_accel_data_##inst;			\
+											\
+	DEVICE_DT_INST_DEFINE(inst, NULL, NULL, &replay_accel_data_##inst, NULL,	\
+			      POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY, &replay_accel_api);
+
+DT_INST_FOREACH_STATUS_OKAY(REPLAY_ACCEL_DEFINE)
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_at.h>
+#include <nrf_modem_gnss.h>
+#include <modem/lte_lc.h>
+#include <modem/nrf_modem_lib.h>
+
+#include "replay.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* Emulation of the modem library calls made by the application with
+ * CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE in continuous tracking mode. GNSS produces a PVT from the
+ * trace every second, followed by the enabled NMEA sentences, from a timer as the modem library
+ * does from its interrupt.
+ */
+
+#define REPLAY_PVT_INTERVAL_MS	1000
+#define REPLAY_SATELLITES	8
+#define REPLAY_ACCURACY_M	5.0f
+#define REPLAY_ALTITUDE_M	300.0f
+/* Satellite slots of a GSA sentence, satellites per GSV sentence. */
+#define REPLAY_GSA_SATELLITES	12
+#define REPLAY_GSV_SATELLITES	4
+
+static nrf_modem_gnss_event_handler_type_t event_handler;
+static uint16_t nmea_mask;
+static struct nrf_modem_gnss_pvt_data_frame pvt;
+static struct nrf_modem_gnss_nmea_data_frame nmea;
+
+int nrf_modem_lib_init(void)
+{
+	LOG_INF("Replaying a recorded trace, the modem is emulated");
+
+	return 0;
+}
+
+int nrf_modem_at_printf(const char *fmt, ...)
+{
+	return 0;
+}
+
+int lte_lc_func_mode_set(enum lte_lc_func_mode mode)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_event_handler_set(nrf_modem_gnss_event_handler_type_t handler)
+{
+	event_handler = handler;
+
+	return 0;
+}
+
+int32_t nrf_modem_gnss_nmea_mask_set(uint16_t mask)
+{
+	nmea_mask = mask;
+
+	return 0;
+}
+
+int32_t nrf_modem_gnss_qzss_nmea_mode_set(uint8_t nmea_mode)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_use_case_set(uint8_t use_case)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_power_mode_set(uint8_t power_mode)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_fix_retry_set(uint16_t fix_retry)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_fix_interval_set(uint16_t fix_interval)
+{
+	return 0;
+}
+
+int32_t nrf_modem_gnss_read(void *buf, int32_t buf_len, int type)
+{
+	switch (type) {
+	case NRF_MODEM_GNSS_DATA_PVT:
+		memcpy(buf, &pvt, MIN(buf_len, sizeof(pvt)));
+		return 0;
+
+	case NRF_MODEM_GNSS_DATA_NMEA:
+		memcpy(buf, &nmea, MIN(buf_len, sizeof(nmea)));
+		return 0;
+
+	default:
+		return -EINVAL;
+	}
+}
+
+/* Appends the checksum and line end to an NMEA sentence starting with '$'. */
+static void nmea_finish(char *str, size_t size)
+{
+	uint8_t checksum = 0;
+	size_t len = strlen(str);
+
+	for (size_t i = 1; i < len; i++) {
+		checksum ^= str[i];
+	}
+
+	snprintf(str + len, size - len, "*%02X\r\n", checksum);
+}
+
+/* Formats a coordinate as NMEA (d)ddmm.mmmmm. */
+static void nmea_coord(char *str, size_t size, double deg, int deg_digits)
+{
+	double abs_deg = fabs(deg);
+	int whole = (int)abs_deg;
+
+	snprintf(str, size, "%0*d%08.5f", deg_digits, whole, (abs_deg - whole) * 60.0);
+}
+
+static void nmea_send(void)
+{
+	nmea_finish(nmea.nmea_str, sizeof(nmea.nmea_str));
+	event_handler(NRF_MODEM_GNSS_EVT_NMEA);
+}
+
+static void pvt_build(int64_t t_ms, const struct replay_fix *fix)
+{
+	time_t utc = replay_start_utc() + t_ms / MSEC_PER_SEC;
+	bool valid = (fix->latitude != REPLAY_NO_FIX);
+	struct tm tm;
+
+	gmtime_r(&utc, &tm);
+
+	memset(&pvt, 0, sizeof(pvt));
+	pvt.datetime.year = tm.tm_year + 1900;
+	pvt.datetime.month = tm.tm_mon + 1;
+	pvt.datetime.day = tm.tm_mday;
+	pvt.datetime.hour = tm.tm_hour;
+	pvt.datetime.minute = tm.tm_min;
+	pvt.datetime.seconds = tm.tm_sec;
+	pvt.datetime.ms = t_ms % MSEC_PER_SEC;
+
+	for (int i = 0; i < REPLAY_SATELLITES; i++) {
+		pvt.sv[i].sv = i + 1;
+		pvt.sv[i].cn0 = 400;
+		pvt.sv[i].elevation = 45;
+		pvt.sv[i].azimuth = i * 360 / REPLAY_SATELLITES;
+		pvt.sv[i].flags = valid ? NRF_MODEM_GNSS_SV_FLAG_USED_IN_FIX : 0;
+	}
+
+	if (!valid) {
+		return;
+	}
+
+	pvt.flags = NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID | NRF_MODEM_GNSS_PVT_FLAG_VELOCITY_VALID;
+	pvt.latitude = fix->latitude / 1e7;
+	pvt.longitude = fix->longitude / 1e7;
+	pvt.altitude = REPLAY_ALTITUDE_M;
+	pvt.accuracy = REPLAY_ACCURACY_M;
+	pvt.altitude_accuracy = 2.0f * REPLAY_ACCURACY_M;
+	pvt.speed = fix->speed / 100.0f;
+	pvt.speed_accuracy = 0.5f;
+	pvt.heading = fix->heading / 100.0f;
+	pvt.heading_accuracy = 5.0f;
+	pvt.pdop = 1.5f;
+	pvt.hdop = 1.0f;
+	pvt.vdop = 1.2f;
+	pvt.tdop = 1.0f;
+}
+
+static void pvt_timer_fn(struct k_timer *timer)
+{
+	int64_t t_ms = k_uptime_get();
+	struct replay_fix fix;
+	bool valid;
+	char lat[16];
+	char lon[16];
+
+	if (replay_fix_get(t_ms, &fix) != 0) {
+		k_timer_stop(timer);
+		replay_finish();
+		return;
+	}
+
+	pvt_build(t_ms, &fix);
+	valid = (pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID);
+	event_handler(NRF_MODEM_GNSS_EVT_PVT);
+
+	nmea_coord(lat, sizeof(lat), pvt.latitude, 2);
+	nmea_coord(lon, sizeof(lon), pvt.longitude, 3);
+
+	if (nmea_mask & NRF_MODEM_GNSS_NMEA_GGA_MASK) {
+		snprintf(nmea.nmea_str, sizeof(nmea.nmea_str),
+			 "$GPGGA,%02u%02u%02u.%02u,%s,%c,%s,%c,%d,%02d,%.2f,%.2f,M,0,,",
+			 pvt.datetime.hour, pvt.datetime.minute, pvt.datetime.seconds,
+			 pvt.datetime.ms / 10, valid ? lat : "", pvt.latitude < 0 ? 'S' : 'N',
+			 valid ? lon : "", pvt.longitude < 0 ? 'W' : 'E', valid ? 1 : 0,
+			 valid ? REPLAY_SATELLITES : 0, (double)pvt.hdop, (double)pvt.altitude);
+		nmea_send();
+	}
+
+	if (nmea_mask & NRF_MODEM_GNSS_NMEA_RMC_MASK) {
+		snprintf(nmea.nmea_str, sizeof(nmea.nmea_str),
+			 "$GPRMC,%02u%02u%02u.%02u,%c,%s,%c,%s,%c,%.2f,%.2f,%02u%02u%02u,,,%c",
+			 pvt.datetime.hour, pvt.datetime.minute, pvt.datetime.seconds,
+			 pvt.datetime.ms / 10, valid ? 'A' : 'V', valid ? lat : "",
+			 pvt.latitude < 0 ? 'S' : 'N', valid ? lon : "",
+			 pvt.longitude < 0 ? 'W' : 'E', pvt.speed * 1.943844 /* knots */,
+			 (double)pvt.heading, pvt.datetime.day, pvt.datetime.month,
+			 pvt.datetime.year % 100, valid ? 'A' : 'N');
+		nmea_send();
+	}
+
+	if (nmea_mask & NRF_MODEM_GNSS_NMEA_GSA_MASK) {
+		int len = snprintf(nmea.nmea_str, sizeof(nmea.nmea_str), "$GPGSA,A,%c",
+				   valid ? '3' : '1');
+
+		for (int i = 0; i < REPLAY_GSA_SATELLITES; i++) {
+			if (valid && i < REPLAY_SATELLITES) {
+				len += snprintf(nmea.nmea_str + len, sizeof(nmea.nmea_str) - len,
+						",%02u", pvt.sv[i].sv);
+			} else {
+				len += snprintf(nmea.nmea_str + len, sizeof(nmea.nmea_str) - len, ",");
+			}
+		}
+		snprintf(nmea.nmea_str + len, sizeof(nmea.nmea_str) - len, ",%.2f,%.2f,%.2f",
+			 (double)pvt.pdop, (double)pvt.hdop, (double)pvt.vdop);
+		nmea_send();
+	}
+
+	if (nmea_mask & NRF_MODEM_GNSS_NMEA_GSV_MASK) {
+		int msgs = DIV_ROUND_UP(REPLAY_SATELLITES, REPLAY_GSV_SATELLITES);
+
+		for (int msg = 0; msg < msgs; msg++) {
+			int first = msg * REPLAY_GSV_SATELLITES;
+			int len = snprintf(nmea.nmea_str, sizeof(nmea.nmea_str), "$GPGSV,%d,%d,%02d",
+					   msgs, msg + 1, REPLAY_SATELLITES);
+
+			for (int i = first; i < MIN(first + REPLAY_GSV_SATELLITES, REPLAY_SATELLITES);
+			     i++) {
+				len += snprintf(nmea.nmea_str + len, sizeof(nmea.nmea_str) - len,
+						",%02u,%02d,%03d,%02u", pvt.sv[i].sv,
+						pvt.sv[i].elevation, pvt.sv[i].azimuth,
+						pvt.sv[i].cn0 / 10);
+			}
+			nmea_send();
+		}
+	}
+
+	if (valid) {
+		event_handler(NRF_MODEM_GNSS_EVT_FIX);
+	}
+}
+
+static K_TIMER_DEFINE(pvt_timer, pvt_timer_fn, NULL);
+
+int32_t nrf_modem_gnss_start(void)
+{
+	if (event_handler == NULL) {
+		return -EINVAL;
+	}
+
+	k_timer_start(&pvt_timer, K_MSEC(REPLAY_PVT_INTERVAL_MS), K_MSEC(REPLAY_PVT_INTERVAL_MS));
+
+	return 0;
+}
+
+int32_t nrf_modem_gnss_stop(void)
+{
+	k_timer_stop(&pvt_timer);
+
+	return 0;
+}
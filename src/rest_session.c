@@ -0,0 +1,199 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <net/nrf_cloud_rest.h>
+
+#include "rest_session.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* The JWT is generated again when it has less than this left. */
+#define JWT_MARGIN_MS		(60 * MSEC_PER_SEC)
+#define HTTP_UNAUTHORIZED	401
+/* Room for the response headers on top of a fragment of the body. */
+#define RX_HEADERS_SIZE		768
+
+static char jwt_buf[600];
+static int64_t jwt_expiry_ms;
+static char rx_buf[CONFIG_GNSS_SAMPLE_NRF_CLOUD_FRAGMENT_SIZE + RX_HEADERS_SIZE];
+
+static struct nrf_cloud_rest_context rest_ctx = {
+	.connect_socket = -1,
+	.keep_alive = (CONFIG_GNSS_SAMPLE_NRF_CLOUD_KEEP_ALIVE > 0),
+	.timeout_ms = NRF_CLOUD_REST_TIMEOUT_NONE,
+	.auth = jwt_buf,
+	.rx_buf = rx_buf,
+	.rx_buf_len = sizeof(rx_buf),
+	.fragment_size = CONFIG_GNSS_SAMPLE_NRF_CLOUD_FRAGMENT_SIZE,
+};
+
+/* Serializes the requests and the closing of the idle connection. */
+static K_MUTEX_DEFINE(session_mutex);
+static struct k_work_q *session_work_q;
+static struct k_work_delayable idle_work;
+
+/* Since boot. */
+static uint32_t requests;
+static uint32_t failures;
+static uint32_t connections;	/* Requests that opened a new connection */
+static uint32_t retries;
+static uint32_t jwts;
+static uint64_t rx_bytes;
+static uint64_t latency_sum_ms;
+static uint32_t last_latency_ms;
+
+static int jwt_ensure(void)
+{
+	int err;
+
+	if (k_uptime_get() < jwt_expiry_ms - JWT_MARGIN_MS) {
+		return 0;
+	}
+
+	err = nrf_cloud_jwt_generate(CONFIG_GNSS_SAMPLE_NRF_CLOUD_JWT_VALID, jwt_buf,
+				     sizeof(jwt_buf));
+	if (err) {
+		LOG_ERR("Failed to generate JWT, error: %d", err);
+		jwt_expiry_ms = 0;
+		return err;
+	}
+
+	jwt_expiry_ms = k_uptime_get() + CONFIG_GNSS_SAMPLE_NRF_CLOUD_JWT_VALID * MSEC_PER_SEC;
+	jwts++;
+
+	return 0;
+}
+
+static void session_close(void)
+{
+	if (rest_ctx.connect_socket >= 0) {
+		(void)nrf_cloud_rest_disconnect(&rest_ctx);
+		rest_ctx.connect_socket = -1;
+	}
+}
+
+static void idle_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&session_mutex, K_FOREVER);
+	if (rest_ctx.connect_socket >= 0) {
+		LOG_DBG("Closing idle nRF Cloud connection");
+		session_close();
+	}
+	k_mutex_unlock(&session_mutex);
+}
+
+void rest_session_init(struct k_work_q *work_q)
+{
+	session_work_q = work_q;
+	k_work_init_delayable(&idle_work, idle_work_fn);
+}
+
+int rest_session_request(const char *name, rest_session_fn fn, void *arg)
+{
+	int err;
+
+	k_mutex_lock(&session_mutex, K_FOREVER);
+	(void)k_work_cancel_delayable(&idle_work);
+
+	for (int attempt = 0;; attempt++) {
+		bool reused;
+		bool unauthorized;
+		int64_t start;
+		uint32_t latency_ms;
+
+		err = jwt_ensure();
+		if (err) {
+			break;
+		}
+
+		reused = (rest_ctx.connect_socket >= 0);
+		rest_ctx.status = 0;
+		rest_ctx.response = NULL;
+		rest_ctx.response_len = 0;
+		rest_ctx.total_response_len = 0;
+
+		start = k_uptime_get();
+		err = fn(&rest_ctx, arg);
+		latency_ms = k_uptime_get() - start;
+
+		requests++;
+		connections += !reused;
+		rx_bytes += rest_ctx.total_response_len;
+		latency_sum_ms += latency_ms;
+		last_latency_ms = latency_ms;
+
+		LOG_INF("%s request: %s, %u bytes in %u ms on a %s connection", name,
+			err ? "failed" : "done", rest_ctx.total_response_len, latency_ms,
+			reused ? "reused" : "new");
+
+		if (err == 0) {
+			break;
+		}
+
+		failures++;
+		unauthorized = (rest_ctx.status == HTTP_UNAUTHORIZED);
+		session_close();
+		if (unauthorized) {
+			jwt_expiry_ms = 0;
+		}
+
+		/* The server may have closed the idle connection, or refused an old JWT. */
+		if (attempt > 0 || !(reused || unauthorized)) {
+			break;
+		}
+
+		retries++;
+		LOG_WRN("Retrying %s request with a new %s", name,
+			unauthorized ? "JWT" : "connection");
+	}
+
+	if (rest_ctx.connect_socket >= 0) {
+		k_work_reschedule_for_queue(session_work_q, &idle_work,
+					    K_SECONDS(CONFIG_GNSS_SAMPLE_NRF_CLOUD_KEEP_ALIVE));
+	}
+	k_mutex_unlock(&session_mutex);
+
+	return err;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_nrf_cloud_rest(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t snapshot_requests;
+	uint32_t snapshot_failures;
+	uint32_t snapshot_connections;
+	uint32_t snapshot_retries;
+	uint32_t snapshot_jwts;
+	uint64_t snapshot_rx_bytes;
+	uint64_t snapshot_latency_sum_ms;
+	uint32_t snapshot_last_latency_ms;
+	bool connected;
+
+	k_mutex_lock(&session_mutex, K_FOREVER);
+	snapshot_requests = requests;
+	snapshot_failures = failures;
+	snapshot_connections = connections;
+	snapshot_retries = retries;
+	snapshot_jwts = jwts;
+	snapshot_rx_bytes = rx_bytes;
+	snapshot_latency_sum_ms = latency_sum_ms;
+	snapshot_last_latency_ms = last_latency_ms;
+	connected = (rest_ctx.connect_socket >= 0);
+	k_mutex_unlock(&session_mutex);
+
+	shell_print(sh, "requests,failures,connections,retries,jwts,rx_bytes,mean_ms,last_ms,"
+			"connected");
+	shell_print(sh, "%u,%u,%u,%u,%u,%llu,%llu,%u,%d", snapshot_requests, snapshot_failures,
+		    snapshot_connections, snapshot_retries, snapshot_jwts, snapshot_rx_bytes,
+		    snapshot_requests ? snapshot_latency_sum_ms / snapshot_requests : 0,
+		    snapshot_last_latency_ms, connected);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(nrf_cloud_rest, NULL,
+		   "Print the nRF Cloud requests, connections and latency since boot as CSV",
+		   cmd_nrf_cloud_rest);
+#endif /* CONFIG_SHELL */
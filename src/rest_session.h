@@ -0,0 +1,48 @@
+#ifndef REST_SESSION_H_
+#define REST_SESSION_H_
+
+#include <zephyr/kernel.h>
+#include <net/nrf_cloud_rest.h>
+
+/**
+ * nRF Cloud REST session.
+ *
+ * All nRF Cloud requests go through one REST context, so that they share one keep-alive TLS
+ * connection and one JWT. The connection is closed CONFIG_GNSS_SAMPLE_NRF_CLOUD_KEEP_ALIVE
+ * seconds after the last request. The JWT is generated again shortly before it expires. A
+ * request that fails on a reused connection is sent once more on a new one, because the
+ * server may have closed the idle connection. A request refused with 401 is sent once more
+ * with a new JWT. The latency and the bytes received are logged for every request.
+ */
+
+/**
+ * @brief Sends one request, with the nrf_cloud_rest function called by the callback.
+ *
+ * @param[in] rest_ctx REST context, with the connection and the JWT set.
+ * @param[in] arg      Argument passed to rest_session_request().
+ *
+ * @return 0 on success, negative error code otherwise.
+ */
+typedef int (*rest_session_fn)(struct nrf_cloud_rest_context *rest_ctx, void *arg);
+
+/**
+ * @brief Initializes the session.
+ *
+ * @param[in] work_q Work queue the requests are made from, the connection is closed from it.
+ */
+void rest_session_init(struct k_work_q *work_q);
+
+/**
+ * @brief Makes a request in the session.
+ *
+ * @details The response in the REST context is valid until the next request.
+ *
+ * @param[in] name Request name for the log, for example "A-GNSS".
+ * @param[in] fn   Callback that sends the request.
+ * @param[in] arg  Argument of the callback.
+ *
+ * @return The result of the callback, or a negative error code if no JWT could be generated.
+ */
+int rest_session_request(const char *name, rest_session_fn fn, void *arg);
+
+#endif /* REST_SESSION_H_ */
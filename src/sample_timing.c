@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "sample_timing.h"
+#include "timebase.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+static uint32_t nominal_us;
+static int64_t prev_sample_ticks = -1;
+static struct histogram jitter;
+static struct histogram latency;
+
+void sample_timing_init(uint32_t nominal_period_us)
+{
+	nominal_us = nominal_period_us;
+	prev_sample_ticks = -1;
+	histogram_reset(&jitter);
+	histogram_reset(&latency);
+}
+
+void sample_timing_sample(int64_t ticks)
+{
+	if (prev_sample_ticks >= 0) {
+		int64_t interval_us = k_ticks_to_us_floor64(ticks - prev_sample_ticks);
+		int64_t deviation_us = interval_us - nominal_us;
+
+		histogram_add(&jitter, (uint32_t)MIN(llabs(deviation_us), UINT32_MAX));
+	}
+
+	prev_sample_ticks = ticks;
+}
+
+void sample_timing_report(int64_t sample_ticks)
+{
+	int64_t latency_us = k_ticks_to_us_floor64(k_uptime_ticks() - sample_ticks);
+
+	histogram_add(&latency, (uint32_t)CLAMP(latency_us, 0, UINT32_MAX));
+}
+
+const struct histogram *sample_timing_jitter(void)
+{
+	return &jitter;
+}
+
+const struct histogram *sample_timing_latency(void)
+{
+	return &latency;
+}
+
+void sample_timing_log(void)
+{
+	LOG_INF("Sample jitter (us): n %u avg %u p50 %u p99 %u max %u (nominal period %u)",
+		jitter.count, histogram_avg(&jitter), histogram_percentile(&jitter, 50),
+		histogram_percentile(&jitter, 99), jitter.max, nominal_us);
+	LOG_INF("Sample to report latency (us): n %u avg %u p50 %u p99 %u max %u",
+		latency.count, histogram_avg(&latency), histogram_percentile(&latency, 50),
+		histogram_percentile(&latency, 99), latency.max);
+	LOG_INF("Uptime clock drift against GNSS: %d ppb", timebase_drift_ppb());
+}
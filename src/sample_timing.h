@@ -0,0 +1,50 @@
+#ifndef SAMPLE_TIMING_H_
+#define SAMPLE_TIMING_H_
+
+#include <zephyr/kernel.h>
+
+#include "histogram.h"
+
+/**
+ * @brief Initializes sample timing statistics.
+ *
+ * @param[in] nominal_period_us Expected interval between two accelerometer samples.
+ */
+void sample_timing_init(uint32_t nominal_period_us);
+
+/**
+ * @brief Records the timestamp of a new accelerometer sample.
+ *
+ * @details Adds the deviation of the interval since the previous sample from the nominal
+ *          period to the jitter histogram.
+ *
+ * @param[in] ticks Uptime in ticks when the sample was taken.
+ */
+void sample_timing_sample(int64_t ticks);
+
+/**
+ * @brief Records the emission of a report.
+ *
+ * @details Adds the time between taking the newest sample of the report and emitting the report
+ *          to the latency histogram.
+ *
+ * @param[in] sample_ticks Uptime in ticks when the newest sample of the report was taken.
+ */
+void sample_timing_report(int64_t sample_ticks);
+
+/**
+ * @brief Returns the jitter histogram, in microseconds.
+ */
+const struct histogram *sample_timing_jitter(void);
+
+/**
+ * @brief Returns the sample to report latency histogram, in microseconds.
+ */
+const struct histogram *sample_timing_latency(void);
+
+/**
+ * @brief Logs a summary of the sample timing statistics.
+ */
+void sample_timing_log(void);
+
+#endif /* SAMPLE_TIMING_H_ */
@@ -0,0 +1,88 @@
+#ifndef SENSOR_RECORD_H_
+#define SENSOR_RECORD_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/toolchain.h>
+#include <zephyr/sys/util.h>
+#include <math.h>
+
+/**
+ * Compact per-report sensor record.
+ *
+ * This is the only layout a report is kept in once it has been collected: RAM queues and the
+ * flash log both store it verbatim, so every byte removed here is a byte more of backlog. All
+ * members are naturally aligned and the size is pinned below, which keeps the layout identical
+ * between the device and the host decoder.
+ */
+
+/* Coordinates are stored in 1e-7 degrees. */
+#define SENSOR_RECORD_COORD_SCALE	10000000.0
+/* Acceleration percentiles are stored as Q8.8 fixed point in m/s^2 (range +-128 m/s^2). */
+#define SENSOR_RECORD_ACCEL_SCALE	256.0
+/* Altitude is stored in decimeters. */
+#define SENSOR_RECORD_ALT_SCALE		10.0
+/* Speed is stored in cm/s. */
+#define SENSOR_RECORD_SPEED_SCALE	100.0
+/* Bearing is stored in centidegrees. */
+#define SENSOR_RECORD_BEARING_SCALE	100.0
+
+#define SENSOR_RECORD_FLAG_FIX_VALID	BIT(0)
+#define SENSOR_RECORD_FLAG_STATS_VALID	BIT(1)
+/* Set when the timestamp is UTC; otherwise it counts from boot. */
+#define SENSOR_RECORD_FLAG_TIME_VALID	BIT(2)
+
+enum sensor_record_axis {
+	SENSOR_RECORD_AXIS_X,
+	SENSOR_RECORD_AXIS_Y,
+	SENSOR_RECORD_AXIS_Z,
+	SENSOR_RECORD_AXIS_COUNT
+};
+
+enum sensor_record_pct {
+	SENSOR_RECORD_PCT_1,
+	SENSOR_RECORD_PCT_10,
+	SENSOR_RECORD_PCT_90,
+	SENSOR_RECORD_PCT_99,
+	SENSOR_RECORD_PCT_COUNT
+};
+
+struct sensor_record {
+	uint32_t time;			/* Seconds since the Unix epoch (UTC) */
+	int32_t latitude;		/* 1e-7 degrees */
+	int32_t longitude;		/* 1e-7 degrees */
+	float accel_mean;		/* Magnitude mean, m/s^2 */
+	float accel_variance;		/* Magnitude variance, (m/s^2)^2 */
+	int16_t accel_pct[SENSOR_RECORD_AXIS_COUNT][SENSOR_RECORD_PCT_COUNT]; /* Q8.8 m/s^2 */
+	int16_t altitude;		/* Decimeters */
+	uint16_t speed;			/* cm/s */
+	uint16_t bearing;		/* Centidegrees */
+	uint16_t seconds_since_fix;	/* Saturates at UINT16_MAX */
+	uint16_t time_ms;		/* Millisecond part of the timestamp */
+	uint8_t flags;			/* SENSOR_RECORD_FLAG_* */
+	uint8_t fix_quality;		/* 0 to 100, see gnss_quality_score(), 0 without a fix */
+};
+
+BUILD_ASSERT(sizeof(struct sensor_record) == 56,
+	     "struct sensor_record layout changed, update the host decoder");
+
+/* Scales a value to fixed point, rounding to nearest and saturating to the int16_t range. */
+static inline int16_t sensor_record_q16(double value, double scale)
+{
+	double scaled = round(value * scale);
+
+	return (int16_t)CLAMP(scaled, INT16_MIN, INT16_MAX);
+}
+
+static inline uint16_t sensor_record_uq16(double value, double scale)
+{
+	double scaled = round(value * scale);
+
+	return (uint16_t)CLAMP(scaled, 0, UINT16_MAX);
+}
+
+static inline int32_t sensor_record_coord(double degrees)
+{
+	return (int32_t)lround(degrees * SENSOR_RECORD_COORD_SCALE);
+}
+
+#endif /* SENSOR_RECORD_H_ */
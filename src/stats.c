@@ -0,0 +1,54 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "stats.h"
+
+#define PI 3.14159265358979323846
+#define EARTH_RADIUS_METERS (6371.0 * 1000.0)
+
+static int compare_double(const void *a, const void *b)
+{
+	return (*(double *)a > *(double *)b) ? 1 : -1;
+}
+
+void calculate_stats(double *buf, size_t count, struct accel_stats *stats)
+{
+	double sum = 0.0;
+	double sum_sq = 0.0;
+
+	if (count < 1) {
+		return;
+	}
+
+	/* Mean and variance */
+	for (size_t i = 0; i < count; i++) {
+		sum += buf[i];
+		sum_sq += buf[i] * buf[i];
+	}
+	stats->mean = sum / count;
+	stats->variance = (sum_sq / count) - (stats->mean * stats->mean);
+
+	/* Percentiles */
+	qsort(buf, count, sizeof(double), compare_double);
+	stats->p1 = buf[(int)(count * 0.01)];
+	stats->p10 = buf[(int)(count * 0.10)];
+	stats->p90 = buf[(int)(count * 0.90)];
+	stats->p99 = buf[(int)(count * 0.99)];
+}
+
+double distance_calculate(double lat1, double lon1, double lat2, double lon2)
+{
+	double d_lat_rad = (lat2 - lat1) * PI / 180.0;
+	double d_lon_rad = (lon2 - lon1) * PI / 180.0;
+
+	double lat1_rad = lat1 * PI / 180.0;
+	double lat2_rad = lat2 * PI / 180.0;
+
+	double a = pow(sin(d_lat_rad / 2), 2) +
+		   pow(sin(d_lon_rad / 2), 2) *
+		   cos(lat1_rad) * cos(lat2_rad);
+
+	double c = 2 * asin(sqrt(a));
+
+	return EARTH_RADIUS_METERS * c;
+}
@@ -0,0 +1,32 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stddef.h>
+
+/** @brief Statistics of an acceleration window. */
+struct accel_stats {
+	double mean;
+	double variance;
+	double p1;
+	double p10;
+	double p90;
+	double p99;
+};
+
+/**
+ * @brief Calculates the mean, variance and percentiles of a window of samples.
+ *
+ * @param[in,out] buf   Samples, sorted in place.
+ * @param[in]     count Number of samples, nothing is calculated if zero.
+ * @param[out]    stats Statistics of the window.
+ */
+void calculate_stats(double *buf, size_t count, struct accel_stats *stats);
+
+/**
+ * @brief Returns the distance between two coordinates in meters.
+ *
+ * @details The distance is calculated using the haversine formula.
+ */
+double distance_calculate(double lat1, double lon1, double lat2, double lon2);
+
+#endif /* STATS_H_ */
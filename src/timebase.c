@@ -0,0 +1,139 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/timeutil.h>
+#include <zephyr/logging/log.h>
+#include <date_time.h>
+
+#include "timebase.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* Minimum time between the PVTs used for a drift measurement. Shorter spans are dominated by
+ * the PVT event latency rather than by the drift itself.
+ */
+#define DRIFT_MIN_SPAN_US	(60LL * USEC_PER_SEC)
+/* Drift measurements outside this range are treated as time jumps and ignored. */
+#define DRIFT_MAX_PPB		500000
+/* Weight of a new drift measurement, as a power of two (1/8). */
+#define DRIFT_FILTER_SHIFT	3
+
+static struct k_spinlock lock;
+static bool synced;
+/* Reference point: UTC and local time at the latest discipline. */
+static int64_t ref_utc_us;
+static int64_t ref_local_us;
+/* Local time of the previous drift measurement, zero when there is none yet. */
+static int64_t drift_ref_local_us;
+static int64_t drift_ref_utc_us;
+static int32_t drift_ppb;
+/* Last returned time, used to keep the time base monotonic. */
+static int64_t last_us;
+
+static int64_t local_to_utc_us(int64_t local_us)
+{
+	int64_t elapsed_us = local_us - ref_local_us;
+
+	return ref_utc_us + elapsed_us + (elapsed_us * drift_ppb) / 1000000000LL;
+}
+
+static void drift_update(int64_t utc_us, int64_t local_us)
+{
+	if (drift_ref_local_us != 0 && local_us - drift_ref_local_us >= DRIFT_MIN_SPAN_US) {
+		int64_t local_span_us = local_us - drift_ref_local_us;
+		int64_t error_us = (utc_us - drift_ref_utc_us) - local_span_us;
+		int64_t measured_ppb = (error_us * 1000000000LL) / local_span_us;
+
+		if (measured_ppb > -DRIFT_MAX_PPB && measured_ppb < DRIFT_MAX_PPB) {
+			drift_ppb += (int32_t)((measured_ppb - drift_ppb) >> DRIFT_FILTER_SHIFT);
+		}
+	}
+
+	if (drift_ref_local_us == 0 || local_us - drift_ref_local_us >= DRIFT_MIN_SPAN_US) {
+		drift_ref_local_us = local_us;
+		drift_ref_utc_us = utc_us;
+	}
+}
+
+void timebase_discipline(const struct nrf_modem_gnss_datetime *gnss_time, int64_t ticks)
+{
+	struct tm tm = {
+		.tm_year = gnss_time->year - 1900,
+		.tm_mon = gnss_time->month - 1,
+		.tm_mday = gnss_time->day,
+		.tm_hour = gnss_time->hour,
+		.tm_min = gnss_time->minute,
+		.tm_sec = gnss_time->seconds
+	};
+	int64_t utc_us = (timeutil_timegm64(&tm) * MSEC_PER_SEC + gnss_time->ms) * USEC_PER_MSEC;
+	int64_t local_us = k_ticks_to_us_floor64(ticks);
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool was_synced = synced;
+
+	drift_update(utc_us, local_us);
+	ref_utc_us = utc_us;
+	ref_local_us = local_us;
+	synced = true;
+
+	k_spin_unlock(&lock, key);
+
+	/* Logged outside the lock, immediate logging writes the UART with interrupts locked. */
+	if (!was_synced) {
+		LOG_INF("Time base synced to GNSS");
+	}
+}
+
+bool timebase_ticks_to_time(int64_t ticks, uint32_t *sec, uint16_t *ms)
+{
+	int64_t now_us;
+	bool valid;
+
+#if defined(CONFIG_DATE_TIME)
+	if (!synced) {
+		int64_t unix_ms;
+
+		/* Use network time until the first fix. */
+		if (date_time_now(&unix_ms) == 0) {
+			int64_t local_us = k_ticks_to_us_floor64(k_uptime_ticks());
+			k_spinlock_key_t key = k_spin_lock(&lock);
+			bool was_synced = synced;
+
+			if (!was_synced) {
+				ref_utc_us = unix_ms * USEC_PER_MSEC;
+				ref_local_us = local_us;
+				synced = true;
+			}
+
+			k_spin_unlock(&lock, key);
+
+			if (!was_synced) {
+				LOG_INF("Time base synced to network time");
+			}
+		}
+	}
+#endif /* CONFIG_DATE_TIME */
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	now_us = local_to_utc_us(k_ticks_to_us_floor64(ticks));
+	if (now_us < last_us) {
+		now_us = last_us;
+	}
+	last_us = now_us;
+	valid = synced;
+
+	k_spin_unlock(&lock, key);
+
+	*sec = (uint32_t)(now_us / USEC_PER_SEC);
+	*ms = (uint16_t)((now_us % USEC_PER_SEC) / USEC_PER_MSEC);
+
+	return valid;
+}
+
+bool timebase_now(uint32_t *sec, uint16_t *ms)
+{
+	return timebase_ticks_to_time(k_uptime_ticks(), sec, ms);
+}
+
+int32_t timebase_drift_ppb(void)
+{
+	return drift_ppb;
+}
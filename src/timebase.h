@@ -0,0 +1,46 @@
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include <zephyr/kernel.h>
+#include <nrf_modem_gnss.h>
+
+/**
+ * @brief Disciplines the time base with the UTC time of a valid PVT.
+ *
+ * @details Updates the offset between the uptime clock and UTC, and the drift estimate of the
+ *          uptime clock once two PVTs far enough apart have been seen.
+ *
+ * @param[in] gnss_time UTC date and time reported by GNSS.
+ * @param[in] ticks     Uptime in ticks when the PVT event was received.
+ */
+void timebase_discipline(const struct nrf_modem_gnss_datetime *gnss_time, int64_t ticks);
+
+/**
+ * @brief Converts an uptime tick stamp to seconds and milliseconds since the Unix epoch (UTC).
+ *
+ * @details The time is derived from the offset and drift estimate from GNSS (or the network
+ *          time, until the first fix). Stamps converted in order never go backwards, also when
+ *          the fix is lost or a new PVT moves the offset back.
+ *
+ * @param[in]  ticks Uptime in ticks, from k_uptime_ticks().
+ * @param[out] sec   Seconds since the Unix epoch, or since boot if the time base is not synced.
+ * @param[out] ms    Millisecond part.
+ *
+ * @retval true if the time base has been synced to GNSS or network time.
+ * @retval false if the returned time is based on uptime only.
+ */
+bool timebase_ticks_to_time(int64_t ticks, uint32_t *sec, uint16_t *ms);
+
+/**
+ * @brief Returns the current time, see timebase_ticks_to_time().
+ */
+bool timebase_now(uint32_t *sec, uint16_t *ms);
+
+/**
+ * @brief Returns the estimated drift of the uptime clock against GNSS time.
+ *
+ * @return Drift in parts per billion, positive when the uptime clock runs slow.
+ */
+int32_t timebase_drift_ppb(void);
+
+#endif /* TIMEBASE_H_ */
@@ -0,0 +1,325 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+
+#include "ttff_bench.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define TTFF_BENCH_KEY		"ttff_bench/runs"
+#define TTFF_BENCH_MAX_RUNS	(TTFF_BENCH_START_COUNT * CONFIG_GNSS_SAMPLE_TTFF_BENCH_RUNS)
+/* TTFF histogram bins, the last bin also counts everything above its range. */
+#define TTFF_BENCH_BINS		12
+#define TTFF_BENCH_BIN_MS	(CONFIG_GNSS_SAMPLE_TTFF_BENCH_BIN_WIDTH * MSEC_PER_SEC)
+
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD)
+#if defined(CONFIG_NRF_CLOUD_PGPS) && defined(CONFIG_NRF_CLOUD_AGNSS)
+#define TTFF_BENCH_BACKEND	"nrf_cloud_agnss_pgps"
+#elif defined(CONFIG_NRF_CLOUD_PGPS)
+#define TTFF_BENCH_BACKEND	"nrf_cloud_pgps"
+#else
+#define TTFF_BENCH_BACKEND	"nrf_cloud_agnss"
+#endif
+#elif defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL)
+#define TTFF_BENCH_BACKEND	"supl"
+#elif defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)
+#define TTFF_BENCH_BACKEND	"minimal"
+#else
+#define TTFF_BENCH_BACKEND	"none"
+#endif
+
+struct ttff_bench_summary {
+	uint32_t count;
+	uint32_t ttff_min_ms;
+	uint32_t ttff_max_ms;
+	uint64_t ttff_sum_ms;
+	uint32_t sats_sum;
+	uint32_t blocked_sum_s;
+	uint64_t distance_sum_m;
+	uint32_t distance_count;
+	uint16_t bin[TTFF_BENCH_BINS];
+};
+
+static K_MUTEX_DEFINE(bench_mutex);
+static struct ttff_bench_run runs[TTFF_BENCH_MAX_RUNS];
+static size_t run_count;
+static struct ttff_bench_summary summary[TTFF_BENCH_START_COUNT];
+
+static void summary_add(const struct ttff_bench_run *run)
+{
+	struct ttff_bench_summary *s = &summary[run->start];
+
+	s->ttff_min_ms = (s->count == 0) ? run->ttff_ms : MIN(s->ttff_min_ms, run->ttff_ms);
+	s->ttff_max_ms = MAX(s->ttff_max_ms, run->ttff_ms);
+	s->ttff_sum_ms += run->ttff_ms;
+	s->sats_sum += run->sats;
+	s->blocked_sum_s += run->blocked_s;
+	if (run->distance_m >= 0) {
+		s->distance_sum_m += run->distance_m;
+		s->distance_count++;
+	}
+	s->bin[MIN(run->ttff_ms / TTFF_BENCH_BIN_MS, TTFF_BENCH_BINS - 1)]++;
+	s->count++;
+}
+
+static void summary_rebuild(void)
+{
+	memset(summary, 0, sizeof(summary));
+
+	for (size_t i = 0; i < run_count; i++) {
+		summary_add(&runs[i]);
+	}
+}
+
+static int ttff_bench_set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
+{
+	int len;
+
+	if (!key || strcmp(key, "runs")) {
+		return -ENOENT;
+	}
+
+	len = read_cb(cb_arg, runs, MIN(len_rd, sizeof(runs)));
+	if (len < 0 || len % sizeof(runs[0]) != 0) {
+		LOG_ERR("Failed to read TTFF benchmark results from settings");
+		len = 0;
+	}
+
+	run_count = len / sizeof(runs[0]);
+	for (size_t i = 0; i < run_count; i++) {
+		if (runs[i].start >= TTFF_BENCH_START_COUNT) {
+			run_count = 0;
+			break;
+		}
+	}
+	summary_rebuild();
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(ttff_bench, "ttff_bench", NULL, ttff_bench_set, NULL, NULL);
+
+int ttff_bench_init(void)
+{
+	int err;
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Settings subsystem initialization failed, error %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree("ttff_bench");
+	if (err) {
+		LOG_ERR("Loading TTFF benchmark results failed, error %d", err);
+		return err;
+	}
+
+	LOG_INF("TTFF benchmark: %u of %u runs done", run_count, TTFF_BENCH_MAX_RUNS);
+
+	return 0;
+}
+
+enum ttff_bench_start ttff_bench_next_start(void)
+{
+	enum ttff_bench_start start = TTFF_BENCH_DONE;
+
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	/* Interleave the start types, so that slow changes in the sky or the network affect
+	 * them all alike.
+	 */
+	for (int i = 0; i < TTFF_BENCH_START_COUNT; i++) {
+		if (summary[i].count < CONFIG_GNSS_SAMPLE_TTFF_BENCH_RUNS &&
+		    (start == TTFF_BENCH_DONE || summary[i].count < summary[start].count)) {
+			start = i;
+		}
+	}
+
+	k_mutex_unlock(&bench_mutex);
+
+	return start;
+}
+
+void ttff_bench_result_add(const struct ttff_bench_run *run)
+{
+	int err;
+
+	__ASSERT_NO_MSG(run->start < TTFF_BENCH_START_COUNT);
+
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	if (run_count == ARRAY_SIZE(runs)) {
+		k_mutex_unlock(&bench_mutex);
+		return;
+	}
+
+	runs[run_count++] = *run;
+	summary_add(run);
+
+	err = settings_save_one(TTFF_BENCH_KEY, runs, run_count * sizeof(runs[0]));
+
+	k_mutex_unlock(&bench_mutex);
+
+	if (err) {
+		LOG_ERR("Failed to write TTFF benchmark results to settings, error %d", err);
+	}
+
+	LOG_INF("TTFF benchmark: %s start %u/%u done", ttff_bench_start_str(run->start),
+		summary[run->start].count, CONFIG_GNSS_SAMPLE_TTFF_BENCH_RUNS);
+}
+
+const char *ttff_bench_start_str(enum ttff_bench_start start)
+{
+	switch (start) {
+	case TTFF_BENCH_COLD:
+		return "cold";
+
+	case TTFF_BENCH_WARM:
+		return "warm";
+
+	case TTFF_BENCH_HOT:
+		return "hot";
+
+	default:
+		return "unknown";
+	}
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Returns the TTFF at the given percentile of a start type, using the nearest rank. */
+static uint32_t ttff_percentile(enum ttff_bench_start start, uint32_t pct)
+{
+	static uint32_t ttff[CONFIG_GNSS_SAMPLE_TTFF_BENCH_RUNS];
+	size_t count = 0;
+
+	for (size_t i = 0; i < run_count && count < ARRAY_SIZE(ttff); i++) {
+		if (runs[i].start == start) {
+			ttff[count++] = runs[i].ttff_ms;
+		}
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	qsort(ttff, count, sizeof(ttff[0]), compare_u32);
+
+	return ttff[MAX(DIV_ROUND_UP(count * pct, 100), 1) - 1];
+}
+
+static int cmd_runs(const struct shell *sh, size_t argc, char **argv)
+{
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	shell_print(sh, "backend,start,ttff_ms,sats,distance_m,blocked_s");
+	for (size_t i = 0; i < run_count; i++) {
+		shell_print(sh, "%s,%s,%u,%u,%d,%u", TTFF_BENCH_BACKEND,
+			    ttff_bench_start_str(runs[i].start), runs[i].ttff_ms, runs[i].sats,
+			    runs[i].distance_m, runs[i].blocked_s);
+	}
+
+	k_mutex_unlock(&bench_mutex);
+
+	return 0;
+}
+
+static int cmd_summary(const struct shell *sh, size_t argc, char **argv)
+{
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	shell_print(sh, "backend,start,count,ttff_min_ms,ttff_median_ms,ttff_p90_ms,ttff_max_ms,"
+			"ttff_mean_ms,sats_mean,distance_mean_m,blocked_total_s");
+	for (int i = 0; i < TTFF_BENCH_START_COUNT; i++) {
+		const struct ttff_bench_summary *s = &summary[i];
+
+		if (s->count == 0) {
+			continue;
+		}
+
+		shell_print(sh, "%s,%s,%u,%u,%u,%u,%u,%u,%.1f,%d,%u", TTFF_BENCH_BACKEND,
+			    ttff_bench_start_str(i), s->count, s->ttff_min_ms,
+			    ttff_percentile(i, 50), ttff_percentile(i, 90), s->ttff_max_ms,
+			    (uint32_t)(s->ttff_sum_ms / s->count),
+			    (double)s->sats_sum / s->count,
+			    s->distance_count ?
+				(int32_t)(s->distance_sum_m / s->distance_count) : -1,
+			    s->blocked_sum_s);
+	}
+
+	k_mutex_unlock(&bench_mutex);
+
+	return 0;
+}
+
+static int cmd_histogram(const struct shell *sh, size_t argc, char **argv)
+{
+	char line[160];
+	int len;
+
+	len = snprintk(line, sizeof(line), "backend,start");
+	for (int i = 0; i < TTFF_BENCH_BINS; i++) {
+		bool last = (i == TTFF_BENCH_BINS - 1);
+		uint32_t edge_s = (last ? i : i + 1) * CONFIG_GNSS_SAMPLE_TTFF_BENCH_BIN_WIDTH;
+
+		len += snprintk(line + len, sizeof(line) - len, ",%s%u", last ? ">=" : "<", edge_s);
+	}
+	shell_print(sh, "%s", line);
+
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	for (int i = 0; i < TTFF_BENCH_START_COUNT; i++) {
+		len = snprintk(line, sizeof(line), "%s,%s", TTFF_BENCH_BACKEND,
+			       ttff_bench_start_str(i));
+		for (int j = 0; j < TTFF_BENCH_BINS; j++) {
+			len += snprintk(line + len, sizeof(line) - len, ",%u", summary[i].bin[j]);
+		}
+		shell_print(sh, "%s", line);
+	}
+
+	k_mutex_unlock(&bench_mutex);
+
+	return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	int err;
+
+	k_mutex_lock(&bench_mutex, K_FOREVER);
+
+	run_count = 0;
+	summary_rebuild();
+	err = settings_delete(TTFF_BENCH_KEY);
+
+	k_mutex_unlock(&bench_mutex);
+
+	if (err) {
+		shell_error(sh, "Failed to delete results from settings, error %d", err);
+		return err;
+	}
+
+	shell_print(sh, "TTFF benchmark results cleared, reboot to run the benchmark again");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ttff_bench_cmds,
+	SHELL_CMD(runs, NULL, "Print the result of each run as CSV", cmd_runs),
+	SHELL_CMD(summary, NULL, "Print TTFF statistics per start type as CSV", cmd_summary),
+	SHELL_CMD(histogram, NULL, "Print the TTFF histogram per start type as CSV", cmd_histogram),
+	SHELL_CMD(reset, NULL, "Clear all results", cmd_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(ttff_bench, &ttff_bench_cmds, "TTFF benchmark results", NULL);
@@ -0,0 +1,55 @@
+#ifndef TTFF_BENCH_H_
+#define TTFF_BENCH_H_
+
+#include <zephyr/kernel.h>
+
+/** @brief GNSS start types benchmarked, in the order they are run. */
+enum ttff_bench_start {
+	TTFF_BENCH_COLD,	/* All data deleted except the TCXO offset (and factory almanac) */
+	TTFF_BENCH_WARM,	/* Ephemerides deleted */
+	TTFF_BENCH_HOT,		/* Nothing deleted */
+	TTFF_BENCH_START_COUNT,
+	TTFF_BENCH_DONE = TTFF_BENCH_START_COUNT
+};
+
+/** @brief Result of one benchmark run. */
+struct ttff_bench_run {
+	uint32_t ttff_ms;	/* Time to fix */
+	int32_t distance_m;	/* Distance from the reference position, -1 if not set */
+	uint16_t blocked_s;	/* Time GNSS was blocked by LTE */
+	uint8_t start;		/* enum ttff_bench_start */
+	uint8_t sats;		/* Satellites used in the fix */
+};
+
+/**
+ * @brief Initializes the TTFF benchmark and loads the results of earlier runs from settings.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int ttff_bench_init(void);
+
+/**
+ * @brief Returns the start type of the next run.
+ *
+ * @details Cycles through cold, warm and hot starts until each has been run
+ *          CONFIG_GNSS_SAMPLE_TTFF_BENCH_RUNS times. Results are kept in settings, so an
+ *          interrupted benchmark continues after a reboot.
+ *
+ * @retval TTFF_BENCH_DONE when all runs have been done.
+ */
+enum ttff_bench_start ttff_bench_next_start(void);
+
+/**
+ * @brief Adds the result of a run.
+ *
+ * @param[in] run Result of the run started with the type from ttff_bench_next_start().
+ */
+void ttff_bench_result_add(const struct ttff_bench_run *run);
+
+/**
+ * @brief Returns a printable name of a start type.
+ */
+const char *ttff_bench_start_str(enum ttff_bench_start start);
+
+#endif /* TTFF_BENCH_H_ */
@@ -0,0 +1,417 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+
+#include "tx_sched.h"
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+#include "gnss_coex.h"
+#endif
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define HOUR_MS			(3600 * MSEC_PER_SEC)
+/* Hours of radio statistics kept for the shell. */
+#define TX_SCHED_HOURS		24
+
+enum release_reason {
+	RELEASE_NOW,		/* A client could not wait at all */
+	RELEASE_CONNECTED,	/* A connection was up */
+	RELEASE_TAU,		/* A periodic TAU was about to connect */
+	RELEASE_DEADLINE,	/* A client could not wait any longer */
+	RELEASE_GNSS_GAP,	/* A client past its deadline waited for GNSS to sleep */
+	RELEASE_REASON_COUNT
+};
+
+static const char *const release_reason_names[RELEASE_REASON_COUNT] = {
+	[RELEASE_NOW] = "now",
+	[RELEASE_CONNECTED] = "connected",
+	[RELEASE_TAU] = "tau",
+	[RELEASE_DEADLINE] = "deadline",
+	[RELEASE_GNSS_GAP] = "gnss_gap",
+};
+
+struct radio_hour {
+	uint32_t radio_on_ms;
+	uint16_t connections;
+	uint16_t releases;	/* Clients released */
+};
+
+static struct k_spinlock lock;
+static sys_slist_t pending;
+static struct k_work_delayable deadline_work;
+static struct k_work_delayable hour_work;
+
+static bool connected;
+static int64_t connected_ms;	/* Uptime the connection that is up started */
+static sys_slist_t carriers;	/* Clients with traffic on the connection that is up or next */
+static int64_t accounted_ms;	/* Connected time is counted up to here */
+static uint64_t radio_on_ms;
+static struct radio_hour hours[TX_SCHED_HOURS];
+static uint32_t hour;		/* Uptime hour of hours[hour % TX_SCHED_HOURS] */
+static uint32_t releases[RELEASE_REASON_COUNT];
+static int64_t hold_until_ms;	/* Past the deadline, waiting for a GNSS gap up to here */
+
+/* Granted by the network, -1 when not in use. */
+static int psm_tau_s = -1;
+static int psm_active_time_s = -1;
+static float edrx_s = -1.0f;
+static float edrx_ptw_s = -1.0f;
+
+/* Counts the connected time up to now, split at the hour boundaries. Called with the lock held,
+ * returns the number of hours closed.
+ */
+static uint32_t radio_account(int64_t now)
+{
+	uint32_t closed = 0;
+
+	while (now >= (int64_t)(hour + 1) * HOUR_MS) {
+		int64_t end = (int64_t)(hour + 1) * HOUR_MS;
+
+		if (connected) {
+			hours[hour % TX_SCHED_HOURS].radio_on_ms += end - accounted_ms;
+			radio_on_ms += end - accounted_ms;
+			accounted_ms = end;
+		}
+		hour++;
+		hours[hour % TX_SCHED_HOURS] = (struct radio_hour){ 0 };
+		closed++;
+	}
+
+	if (connected) {
+		hours[hour % TX_SCHED_HOURS].radio_on_ms += now - accounted_ms;
+		radio_on_ms += now - accounted_ms;
+	}
+	accounted_ms = now;
+
+	return closed;
+}
+
+/* Adds the connection that ended to the radio on time of the clients it carried. Called with the
+ * lock held.
+ */
+static void carriers_account(int64_t now)
+{
+	struct tx_sched_client *client;
+	sys_snode_t *node;
+
+	while ((node = sys_slist_get(&carriers)) != NULL) {
+		client = CONTAINER_OF(node, struct tx_sched_client, carrier_node);
+		client->radio_on_ms += now - connected_ms;
+		client->carrier = false;
+	}
+}
+
+/* Moves the deadline timer to the earliest deadline. Called with the lock held. */
+static void deadline_update(void)
+{
+	struct tx_sched_client *client;
+	int64_t earliest = INT64_MAX;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&pending, client, node) {
+		earliest = MIN(earliest, client->deadline_ms);
+	}
+
+	if (earliest == INT64_MAX) {
+		(void)k_work_cancel_delayable(&deadline_work);
+	} else {
+		(void)k_work_reschedule(&deadline_work,
+					K_MSEC(MAX(earliest - k_uptime_get(), 0)));
+	}
+}
+
+/* Releases all pending clients, they share whatever connection the first of them opens. */
+static void release_all(enum release_reason reason)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	sys_slist_t released = pending;
+	struct tx_sched_client *client;
+	sys_snode_t *node;
+	uint16_t count = sys_slist_len(&released);
+
+	sys_slist_init(&pending);
+	(void)k_work_cancel_delayable(&deadline_work);
+	hold_until_ms = 0;
+
+	if (count > 0) {
+		radio_account(k_uptime_get());
+		hours[hour % TX_SCHED_HOURS].releases += count;
+		releases[reason]++;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (count > 0) {
+		LOG_DBG("Releasing %u transmit clients, %s", count, release_reason_names[reason]);
+	}
+
+	/* Each client stays pending until it is detached, so that a request for it meanwhile, from
+	 * its own callback or another thread, does not link its node into the pending list while
+	 * it is still in this one.
+	 */
+	for (;;) {
+		key = k_spin_lock(&lock);
+		node = sys_slist_get(&released);
+		if (node != NULL) {
+			client = CONTAINER_OF(node, struct tx_sched_client, node);
+			client->pending = false;
+		}
+		k_spin_unlock(&lock, key);
+
+		if (node == NULL) {
+			break;
+		}
+
+		client->release(client);
+	}
+}
+
+static void deadline_work_fn(struct k_work *work)
+{
+#if defined(CONFIG_STINGSENSE_GNSS_COEX)
+	bool gap = gnss_coex_gap_open();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	bool held = (hold_until_ms > 0);
+
+	if (!gap) {
+		/* A new connection now would block GNSS, wait for it to sleep. */
+		if (!held) {
+			hold_until_ms = now + CONFIG_STINGSENSE_GNSS_COEX_MAX_DEFER * MSEC_PER_SEC;
+		}
+		if (now < hold_until_ms) {
+			(void)k_work_reschedule(&deadline_work, K_MSEC(hold_until_ms - now));
+			k_spin_unlock(&lock, key);
+			return;
+		}
+	}
+	k_spin_unlock(&lock, key);
+
+	release_all((gap && held) ? RELEASE_GNSS_GAP : RELEASE_DEADLINE);
+#else
+	release_all(RELEASE_DEADLINE);
+#endif
+}
+
+static void hour_work_fn(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = k_uptime_get();
+	uint32_t closed = radio_account(now);
+	struct radio_hour last = hours[(hour - 1) % TX_SCHED_HOURS];
+	uint32_t last_hour = hour - 1;
+
+	k_spin_unlock(&lock, key);
+
+	if (closed > 0) {
+		LOG_INF("Radio on %u s in hour %u, %u connections, %u transmit clients released",
+			last.radio_on_ms / MSEC_PER_SEC, last_hour, last.connections, last.releases);
+	}
+
+	(void)k_work_reschedule(&hour_work, K_MSEC((int64_t)(hour + 1) * HOUR_MS - now));
+}
+
+static void tx_sched_lte_handler(const struct lte_lc_evt *const evt)
+{
+	k_spinlock_key_t key;
+
+	switch (evt->type) {
+	case LTE_LC_EVT_RRC_UPDATE:
+		key = k_spin_lock(&lock);
+		radio_account(k_uptime_get());
+		if (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED && !connected) {
+			connected = true;
+			connected_ms = k_uptime_get();
+			hours[hour % TX_SCHED_HOURS].connections++;
+		} else if (evt->rrc_mode == LTE_LC_RRC_MODE_IDLE && connected) {
+			connected = false;
+			carriers_account(k_uptime_get());
+		}
+		k_spin_unlock(&lock, key);
+
+		if (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED) {
+			release_all(RELEASE_CONNECTED);
+		}
+		break;
+
+	case LTE_LC_EVT_TAU_PRE_WARNING:
+		release_all(RELEASE_TAU);
+		break;
+
+	case LTE_LC_EVT_PSM_UPDATE:
+		psm_tau_s = evt->psm_cfg.tau;
+		psm_active_time_s = evt->psm_cfg.active_time;
+		LOG_INF("PSM: TAU %d s, active time %d s", psm_tau_s, psm_active_time_s);
+		break;
+
+	case LTE_LC_EVT_EDRX_UPDATE:
+		edrx_s = evt->edrx_cfg.edrx;
+		edrx_ptw_s = evt->edrx_cfg.ptw;
+		LOG_INF("eDRX: cycle %.2f s, PTW %.2f s", (double)edrx_s, (double)edrx_ptw_s);
+		break;
+
+	default:
+		break;
+	}
+}
+
+int tx_sched_init(void)
+{
+	sys_slist_init(&pending);
+	sys_slist_init(&carriers);
+	k_work_init_delayable(&deadline_work, deadline_work_fn);
+	k_work_init_delayable(&hour_work, hour_work_fn);
+	(void)k_work_schedule(&hour_work, K_MSEC(HOUR_MS - k_uptime_get() % HOUR_MS));
+
+	lte_lc_register_handler(tx_sched_lte_handler);
+
+	return 0;
+}
+
+void tx_sched_request(struct tx_sched_client *client, k_timeout_t max_delay)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t deadline_ms = k_uptime_get() + k_ticks_to_ms_ceil64(max_delay.ticks);
+	bool now = connected || K_TIMEOUT_EQ(max_delay, K_NO_WAIT);
+
+	if (!client->pending) {
+		client->pending = true;
+		client->deadline_ms = deadline_ms;
+		sys_slist_append(&pending, &client->node);
+	} else {
+		client->deadline_ms = MIN(client->deadline_ms, deadline_ms);
+	}
+
+	if (!now && hold_until_ms == 0) {
+		deadline_update();
+	}
+	k_spin_unlock(&lock, key);
+
+	if (now) {
+		release_all(connected ? RELEASE_CONNECTED : RELEASE_NOW);
+	}
+}
+
+void tx_sched_gap_open(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (hold_until_ms > 0) {
+		(void)k_work_reschedule(&deadline_work, K_NO_WAIT);
+	}
+	k_spin_unlock(&lock, key);
+}
+
+bool tx_sched_connected(void)
+{
+	return connected;
+}
+
+uint64_t tx_sched_radio_on_ms(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint64_t ms;
+
+	radio_account(k_uptime_get());
+	ms = radio_on_ms;
+	k_spin_unlock(&lock, key);
+
+	return ms;
+}
+
+void tx_sched_carried(struct tx_sched_client *client)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (!client->carrier) {
+		client->carrier = true;
+		sys_slist_append(&carriers, &client->carrier_node);
+	}
+	k_spin_unlock(&lock, key);
+}
+
+uint64_t tx_sched_client_radio_on_ms(struct tx_sched_client *client)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint64_t ms = client->radio_on_ms;
+
+	if (client->carrier && connected) {
+		ms += k_uptime_get() - connected_ms;
+	}
+	k_spin_unlock(&lock, key);
+
+	return ms;
+}
+
+static int cmd_status(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct tx_sched_client *client;
+	int64_t now = k_uptime_get();
+	uint32_t snapshot[RELEASE_REASON_COUNT];
+	const char *names[8];
+	int32_t deadlines_s[8];
+	size_t count = 0;
+	bool rrc_connected = connected;
+	uint32_t radio_on_s;
+
+	radio_account(now);
+	radio_on_s = radio_on_ms / MSEC_PER_SEC;
+
+	memcpy(snapshot, releases, sizeof(snapshot));
+	SYS_SLIST_FOR_EACH_CONTAINER(&pending, client, node) {
+		if (count < ARRAY_SIZE(names)) {
+			names[count] = client->name;
+			deadlines_s[count] = (client->deadline_ms - now) / MSEC_PER_SEC;
+			count++;
+		}
+	}
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "RRC %s, radio on %u s since boot", rrc_connected ? "connected" : "idle",
+		    radio_on_s);
+	shell_print(sh, "PSM TAU %d s, active time %d s, eDRX cycle %.2f s, PTW %.2f s",
+		    psm_tau_s, psm_active_time_s, (double)edrx_s, (double)edrx_ptw_s);
+	for (int i = 0; i < RELEASE_REASON_COUNT; i++) {
+		shell_print(sh, "Releases on %s: %u", release_reason_names[i], snapshot[i]);
+	}
+	for (size_t i = 0; i < count; i++) {
+		shell_print(sh, "Pending: %s, deadline in %d s", names[i], deadlines_s[i]);
+	}
+
+	return 0;
+}
+
+static int cmd_hours(const struct shell *sh, size_t argc, char **argv)
+{
+	struct radio_hour snapshot[TX_SCHED_HOURS];
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t current;
+
+	radio_account(k_uptime_get());
+	memcpy(snapshot, hours, sizeof(snapshot));
+	current = hour;
+	k_spin_unlock(&lock, key);
+
+	shell_print(sh, "hour,radio_on_s,connections,releases");
+	for (uint32_t h = (current >= TX_SCHED_HOURS) ? current - TX_SCHED_HOURS + 1 : 0;
+	     h <= current; h++) {
+		const struct radio_hour *entry = &snapshot[h % TX_SCHED_HOURS];
+
+		shell_print(sh, "%u,%u,%u,%u", h, entry->radio_on_ms / MSEC_PER_SEC,
+			    entry->connections, entry->releases);
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(tx_sched_cmds,
+	SHELL_CMD(status, NULL, "Print the RRC, PSM and eDRX state and the pending clients",
+		  cmd_status),
+	SHELL_CMD(hours, NULL, "Print the radio on time and connections per hour as CSV",
+		  cmd_hours),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(tx_sched, &tx_sched_cmds, "Transmit scheduler", NULL);
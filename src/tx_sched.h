@@ -0,0 +1,106 @@
+#ifndef TX_SCHED_H_
+#define TX_SCHED_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+/**
+ * Transmit scheduler.
+ *
+ * Every new RRC connection keeps the radio in its high power state for the RRC inactivity
+ * timer, seconds after the last packet. Traffic that can wait is therefore held back until a
+ * connection is up anyway, and all of it is sent together. A client requests a transmit slot
+ * with the longest delay it accepts, and is released:
+ *
+ *   - right away when an RRC connection is up, for any reason,
+ *   - just before a periodic TAU, which connects anyway,
+ *   - when the earliest deadline of all pending clients expires, together with all the others.
+ *
+ * With CONFIG_STINGSENSE_GNSS_COEX, a release on the deadline also waits for a GNSS sleep gap
+ * (gnss_coex.h), for at most CONFIG_STINGSENSE_GNSS_COEX_MAX_DEFER seconds, so that the new
+ * connection does not block GNSS.
+ *
+ * The scheduler also counts the RRC connections and the time spent connected, per hour, and
+ * per client over the connections that carried its traffic.
+ */
+
+struct tx_sched_client;
+
+/**
+ * @brief Release callback, starts the transmission of a client.
+ *
+ * @details Called from the LTE link controller event handler or the system work queue, so it
+ *          only submits work.
+ */
+typedef void (*tx_sched_release_t)(struct tx_sched_client *client);
+
+struct tx_sched_client {
+	const char *name;
+	tx_sched_release_t release;
+
+	/* Private, owned by the scheduler. */
+	sys_snode_t node;
+	int64_t deadline_ms;
+	bool pending;
+	sys_snode_t carrier_node;
+	bool carrier;
+	uint64_t radio_on_ms;
+};
+
+/**
+ * @brief Initializes the scheduler.
+ *
+ * @details Registers for the LTE link controller events, call before LTE is connected.
+ *
+ * @retval 0 on success.
+ */
+int tx_sched_init(void);
+
+/**
+ * @brief Requests a transmit slot.
+ *
+ * @details The client is released within max_delay, earlier if a connection comes up. A
+ *          request for a pending client moves its deadline earlier only. With K_NO_WAIT the
+ *          client is released right away, and all pending clients with it.
+ *
+ * @param[in] client    Client, with name and release set.
+ * @param[in] max_delay Longest delay accepted.
+ */
+void tx_sched_request(struct tx_sched_client *client, k_timeout_t max_delay);
+
+/**
+ * @brief Releases the clients waiting for a GNSS sleep gap.
+ *
+ * @details Callable from interrupt context.
+ */
+void tx_sched_gap_open(void);
+
+/**
+ * @brief Returns true while an RRC connection is up.
+ */
+bool tx_sched_connected(void);
+
+/**
+ * @brief Returns the time spent in RRC connected state since boot, in milliseconds.
+ */
+uint64_t tx_sched_radio_on_ms(void);
+
+/**
+ * @brief Counts the RRC connection that is up, or the next one, as carrying traffic of a client.
+ *
+ * @details The whole connection, from connected to idle, is added to the radio on time of the
+ *          client once, however often this is called during it.
+ *
+ * @param[in] client Client, it need not be pending.
+ */
+void tx_sched_carried(struct tx_sched_client *client);
+
+/**
+ * @brief Returns the time spent in the RRC connections that carried traffic of a client, in
+ *        milliseconds, the connection that is up counted until now.
+ *
+ * @param[in] client Client.
+ */
+uint64_t tx_sched_client_radio_on_ms(struct tx_sched_client *client);
+
+#endif /* TX_SCHED_H_ */
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/coap_client.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+
+#include "uplink.h"
+#include "tx_sched.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define UPLINK_BATCH_RECORDS	CONFIG_STINGSENSE_UPLINK_BATCH_RECORDS
+#define UPLINK_RING_RECORDS	CONFIG_STINGSENSE_UPLINK_RING_RECORDS
+#define UPLINK_PAYLOAD_MAX	(sizeof(struct uplink_batch_header) + \
+				 UPLINK_BATCH_RECORDS * sizeof(struct sensor_record))
+/* Least wait before a failed batch is sent again, doubled on every failure. The retry then
+ * waits for the transmit scheduler like any other batch, for at most the next, doubled backoff.
+ */
+#define UPLINK_RETRY_MIN_S	10
+#define UPLINK_RETRY_MAX_S	600
+/* Records between the round trip and radio time log lines. */
+#define UPLINK_REPORT_RECORDS	1000
+
+BUILD_ASSERT(UPLINK_RING_RECORDS >= UPLINK_BATCH_RECORDS,
+	     "The uplink queue must hold at least one batch");
+
+struct uplink_stats {
+	uint32_t records;	/* Records delivered */
+	uint32_t batches;	/* Batches delivered */
+	uint32_t failures;	/* Batches that failed, and were sent again */
+	uint32_t dropped;	/* Records dropped from a full queue */
+	uint32_t round_trips;	/* Blocks sent, each is a confirmable request and response */
+	uint32_t rtt_sum_ms;	/* Time from the first block to the last response, per batch */
+	uint32_t rtt_max_ms;
+};
+
+static struct coap_client client;
+static struct k_work_q *work_q;
+static struct k_work_delayable send_work;
+static struct k_work_delayable retry_work;
+static int sock = -1;
+static struct sockaddr_storage server_addr;
+static bool server_resolved;
+
+/* Records are kept in the ring by sequence number, tail_seq is the oldest and head_seq the next
+ * one to be added. The batch in flight is a copy in payload, so the ring can drop its records
+ * meanwhile.
+ */
+static struct k_spinlock lock;
+static struct sensor_record ring[UPLINK_RING_RECORDS];
+static uint32_t head_seq;
+static uint32_t tail_seq;
+static bool in_flight;
+static bool retrying;
+static uint32_t in_flight_first;
+static uint16_t in_flight_count;
+static uint32_t retry_s = UPLINK_RETRY_MIN_S;
+static int64_t sent_at_ms;
+static uint8_t payload[UPLINK_PAYLOAD_MAX];
+
+static struct uplink_stats stats;
+static uint32_t next_report_records = UPLINK_REPORT_RECORDS;
+
+/* Released by the transmit scheduler when a connection is up or the batch can't wait longer. */
+static void tx_release(struct tx_sched_client *client)
+{
+	(void)k_work_reschedule_for_queue(work_q, &send_work, K_NO_WAIT);
+}
+
+static struct tx_sched_client tx_client = {
+	.name = "uplink",
+	.release = tx_release,
+};
+
+/* The backoff of a failed batch is over, it goes with the next connection. */
+static void retry_work_fn(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t max_delay_s = retry_s;
+
+	k_spin_unlock(&lock, key);
+
+	tx_sched_request(&tx_client, K_SECONDS(max_delay_s));
+}
+
+static int server_resolve(void)
+{
+	int err;
+	char port[6];
+	struct addrinfo *info;
+
+	struct addrinfo hints = {
+		.ai_flags = AI_NUMERICSERV,
+		.ai_family = AF_UNSPEC, /* Both IPv4 and IPv6 addresses accepted. */
+		.ai_socktype = SOCK_DGRAM
+	};
+
+	snprintf(port, sizeof(port), "%d", CONFIG_STINGSENSE_UPLINK_PORT);
+
+	err = getaddrinfo(CONFIG_STINGSENSE_UPLINK_HOST, port, &hints, &info);
+	if (err) {
+		LOG_ERR("Failed to resolve hostname %s, error: %d",
+			CONFIG_STINGSENSE_UPLINK_HOST, err);
+
+		return -EHOSTUNREACH;
+	}
+
+	memcpy(&server_addr, info->ai_addr, MIN(info->ai_addrlen, sizeof(server_addr)));
+	freeaddrinfo(info);
+
+	sock = socket(server_addr.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
+		LOG_ERR("Failed to create socket, errno %d", errno);
+
+		return -errno;
+	}
+
+	/* The address is kept for the lifetime of the socket, the DNS lookup is not repeated for
+	 * every batch.
+	 */
+	server_resolved = true;
+
+	return 0;
+}
+
+/* Ends the batch in flight and schedules the next one. */
+static void batch_done(bool delivered)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t rtt_ms = k_uptime_get() - sent_at_ms;
+	k_timeout_t delay = K_NO_WAIT;
+	bool next = false;
+	bool report = false;
+	uint32_t records = 0;
+	uint32_t round_trips = 0;
+
+	in_flight = false;
+
+	if (delivered) {
+		/* Records dropped from the full queue meanwhile are gone already. */
+		if ((int32_t)(in_flight_first + in_flight_count - tail_seq) > 0) {
+			tail_seq = in_flight_first + in_flight_count;
+		}
+
+		stats.records += in_flight_count;
+		stats.batches++;
+		stats.rtt_sum_ms += rtt_ms;
+		stats.rtt_max_ms = MAX(stats.rtt_max_ms, rtt_ms);
+		retry_s = UPLINK_RETRY_MIN_S;
+
+		if (stats.records >= next_report_records) {
+			next_report_records += UPLINK_REPORT_RECORDS;
+			report = true;
+			records = stats.records;
+			round_trips = stats.round_trips;
+		}
+
+		/* The connection is up, so the rest goes now, also a partial batch. */
+		next = (head_seq != tail_seq);
+	} else {
+		stats.failures++;
+		retrying = true;
+		delay = K_SECONDS(retry_s);
+		retry_s = MIN(retry_s * 2, UPLINK_RETRY_MAX_S);
+	}
+	k_spin_unlock(&lock, key);
+
+	if (next) {
+		(void)k_work_reschedule_for_queue(work_q, &send_work, K_NO_WAIT);
+	} else if (!delivered) {
+		(void)k_work_reschedule_for_queue(work_q, &retry_work, delay);
+	}
+
+	if (report) {
+		LOG_INF("Uplink: %u round trips and %u ms radio on per %u records",
+			(uint32_t)((uint64_t)round_trips * UPLINK_REPORT_RECORDS / records),
+			(uint32_t)(tx_sched_client_radio_on_ms(&tx_client) * UPLINK_REPORT_RECORDS /
+				   records),
+			UPLINK_REPORT_RECORDS);
+	}
+}
+
+/* Called from the CoAP client thread, for the response to the last block. */
+static void response_cb(int16_t result_code, size_t offset, const uint8_t *data, size_t len,
+			bool last_block, void *user_data)
+{
+	if (result_code == COAP_RESPONSE_CODE_CREATED || result_code == COAP_RESPONSE_CODE_CHANGED) {
+		batch_done(true);
+		return;
+	}
+
+	if (result_code < 0) {
+		LOG_WRN("Uplink batch failed, error: %d", result_code);
+	} else {
+		LOG_WRN("Uplink batch rejected, response code %d.%02d",
+			COAP_RESPONSE_CODE_CLASS(result_code), COAP_RESPONSE_CODE_DETAIL(result_code));
+	}
+
+	batch_done(false);
+}
+
+static void send_work_fn(struct k_work *work)
+{
+	struct uplink_batch_header *header = (struct uplink_batch_header *)payload;
+	struct sensor_record *records = (struct sensor_record *)(header + 1);
+	k_spinlock_key_t key;
+	size_t len;
+	int err;
+
+	struct coap_client_request req = {
+		.method = COAP_METHOD_POST,
+		.confirmable = true,
+		.path = CONFIG_STINGSENSE_UPLINK_PATH,
+		.fmt = COAP_CONTENT_FORMAT_APP_OCTET_STREAM,
+		.payload = payload,
+		.cb = response_cb,
+	};
+
+	if (!server_resolved && server_resolve() != 0) {
+		batch_done(false);
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	retrying = false;
+	if (in_flight || head_seq == tail_seq) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	/* A retried batch takes the records added since it failed as well. */
+	in_flight_first = tail_seq;
+	in_flight_count = MIN(head_seq - tail_seq, UPLINK_BATCH_RECORDS);
+	for (uint16_t i = 0; i < in_flight_count; i++) {
+		records[i] = ring[(in_flight_first + i) % UPLINK_RING_RECORDS];
+	}
+	in_flight = true;
+	k_spin_unlock(&lock, key);
+
+	header->version = UPLINK_BATCH_VERSION;
+	header->record_size = sizeof(struct sensor_record);
+	header->count = in_flight_count;
+	header->first_seq = in_flight_first;
+
+	len = sizeof(*header) + in_flight_count * sizeof(struct sensor_record);
+	req.len = len;
+
+	key = k_spin_lock(&lock);
+	sent_at_ms = k_uptime_get();
+	stats.round_trips += DIV_ROUND_UP(len, CONFIG_COAP_CLIENT_BLOCK_SIZE);
+	k_spin_unlock(&lock, key);
+
+	/* The radio on time per record counts the connections that carried batches only. */
+	tx_sched_carried(&tx_client);
+
+	err = coap_client_req(&client, sock, (struct sockaddr *)&server_addr, &req, NULL);
+	if (err) {
+		LOG_ERR("Failed to send uplink batch, error: %d", err);
+		batch_done(false);
+	}
+}
+
+int uplink_init(struct k_work_q *queue)
+{
+	int err;
+
+	err = coap_client_init(&client, NULL);
+	if (err) {
+		LOG_ERR("Failed to initialize CoAP client, error: %d", err);
+		return err;
+	}
+
+	work_q = queue;
+	k_work_init_delayable(&send_work, send_work_fn);
+	k_work_init_delayable(&retry_work, retry_work_fn);
+
+	return 0;
+}
+
+void uplink_record_add(const struct sensor_record *record)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t queued;
+	bool request;
+
+	if (head_seq - tail_seq == UPLINK_RING_RECORDS) {
+		tail_seq++;
+		stats.dropped++;
+	}
+
+	ring[head_seq % UPLINK_RING_RECORDS] = *record;
+	head_seq++;
+
+	/* A failed batch is requested again when its backoff is over. */
+	queued = head_seq - tail_seq;
+	request = !in_flight && !retrying && queued >= UPLINK_BATCH_RECORDS;
+	k_spin_unlock(&lock, key);
+
+	if (!request) {
+		return;
+	}
+
+	/* A full batch waits for a connection, unless the queue is about to drop records. */
+	if (queued > UPLINK_RING_RECORDS - UPLINK_BATCH_RECORDS) {
+		tx_sched_request(&tx_client, K_NO_WAIT);
+	} else {
+		tx_sched_request(&tx_client, K_SECONDS(CONFIG_STINGSENSE_UPLINK_MAX_DELAY));
+	}
+}
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct uplink_stats snapshot = stats;
+	uint32_t queued = head_seq - tail_seq;
+	uint64_t radio_on_ms;
+
+	k_spin_unlock(&lock, key);
+	radio_on_ms = tx_sched_client_radio_on_ms(&tx_client);
+
+	shell_print(sh, "records,batches,failures,dropped,queued,round_trips,rtt_avg_ms,rtt_max_ms,"
+		    "radio_on_s,round_trips_per_1000,radio_on_s_per_1000");
+	shell_print(sh, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f", snapshot.records, snapshot.batches,
+		    snapshot.failures, snapshot.dropped, queued, snapshot.round_trips,
+		    snapshot.batches ? snapshot.rtt_sum_ms / snapshot.batches : 0,
+		    snapshot.rtt_max_ms, (uint32_t)(radio_on_ms / MSEC_PER_SEC),
+		    snapshot.records ? (uint32_t)((uint64_t)snapshot.round_trips *
+						  UPLINK_REPORT_RECORDS / snapshot.records) : 0,
+		    snapshot.records ? (double)radio_on_ms * UPLINK_REPORT_RECORDS /
+				       MSEC_PER_SEC / snapshot.records : 0.0);
+
+	return 0;
+}
+
+static int cmd_flush(const struct shell *sh, size_t argc, char **argv)
+{
+	(void)k_work_reschedule_for_queue(work_q, &send_work, K_NO_WAIT);
+
+	shell_print(sh, "Sending the queued records");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uplink_cmds,
+	SHELL_CMD(stats, NULL, "Print delivery, round trip and radio on time statistics as CSV",
+		  cmd_stats),
+	SHELL_CMD(flush, NULL, "Send the queued records now, also a partial batch", cmd_flush),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(uplink, &uplink_cmds, "CoAP uplink", NULL);
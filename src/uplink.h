@@ -0,0 +1,58 @@
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/toolchain.h>
+
+#include "sensor_record.h"
+
+/**
+ * CoAP uplink.
+ *
+ * Sensor records are queued in RAM and sent in batches, each batch as one confirmable
+ * block-wise POST to coap://CONFIG_STINGSENSE_UPLINK_HOST/CONFIG_STINGSENSE_UPLINK_PATH. A batch
+ * is delivered when the server answers the last block with 2.01 or 2.04, only then are its
+ * records removed from the queue. A failed batch is sent again, with the records added since,
+ * through the transmit scheduler once its backoff is over.
+ * When the queue is full the oldest record is dropped.
+ *
+ * A full batch waits for the transmit scheduler (tx_sched.h) to release it, when an RRC
+ * connection is up or after at most CONFIG_STINGSENSE_UPLINK_MAX_DELAY seconds. The whole queue
+ * is sent then, also a partial last batch.
+ *
+ * The payload of a POST is a struct uplink_batch_header followed by count records, verbatim.
+ * See coap_server.py for the host side.
+ */
+
+#define UPLINK_BATCH_VERSION	1
+
+struct uplink_batch_header {
+	uint8_t version;	/* UPLINK_BATCH_VERSION */
+	uint8_t record_size;	/* sizeof(struct sensor_record) */
+	uint16_t count;		/* Records in the batch */
+	uint32_t first_seq;	/* Sequence number of the first record, counted from boot */
+};
+
+BUILD_ASSERT(sizeof(struct uplink_batch_header) == 8,
+	     "struct uplink_batch_header layout changed, update the host decoder");
+
+/**
+ * @brief Initializes the uplink.
+ *
+ * @details The server address is resolved when the first batch is sent.
+ *
+ * @param[in] queue Work queue for the batches, which block on DNS and the CoAP exchange.
+ *
+ * @retval 0 on success.
+ * @retval -errno on failure.
+ */
+int uplink_init(struct k_work_q *queue);
+
+/**
+ * @brief Queues a sensor record, and requests a transmit slot when a batch is full.
+ *
+ * @param[in] record Sensor record, copied.
+ */
+void uplink_record_add(const struct sensor_record *record);
+
+#endif /* UPLINK_H_ */
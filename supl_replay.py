@@ -0,0 +1,213 @@
+"""
+Local SUPL stand-in for the SUPL assistance (CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL) that records a
+session with a real server and replays it to the device.
+
+    python supl_replay.py record --upstream supl.google.com:7276 --output session.json
+    python supl_replay.py replay --session session.json [--close] [--timing]
+
+The device needs CONFIG_GNSS_SAMPLE_SUPL_HOSTNAME set to the address of this host. In record mode
+the ULP messages are passed on to the upstream server and the session is saved, each one
+replacing the previous. In replay mode the device gets the recorded server messages in answer to
+its own. Each session is printed with the bytes in each direction, the time taken and the number
+of the session on its connection, so that the DNS cache and the connection reuse of the device can
+be compared between builds.
+
+The replayed messages are the recorded ones, only the SET session ID of the live session is
+copied into them: the header bits in which the live SUPL START differs from the recorded one are
+taken over where the recorded response has the same bits as the recorded request. The response
+sizes therefore stay those of the recording, record a session per request to compare them. With
+--close the connection is closed after each session, as most servers do, --timing keeps the
+recorded delays of the server. There are no dependencies.
+
+supl_session.json is a synthetic session in the framing and header layout of ULP 2.0, with the
+message sizes of a GPS session: SUPL START, RESPONSE, POS INIT, three SUPL POS and END. Its
+bodies are filler, so it checks the replay and the connection handling of the device, and the
+SUPL library rejects the assistance. The bytes and seconds printed for a session that is not a
+recording are marked unverified, they are not those of an assistance cycle. Record a session for
+real assistance data and figures.
+"""
+
+import argparse
+import asyncio
+import json
+import time
+
+# ULP PDUs start with their length, big endian and including the length field
+LENGTH_SIZE = 2
+# The ULP header, version and session ID, is within this many bytes
+HEADER_SIZE = 24
+
+
+class Totals:
+    def __init__(self):
+        self.connections = 0
+        self.sessions = 0
+        self.rx_bytes = 0
+        self.tx_bytes = 0
+        self.seconds = 0.0
+
+    def session(self, rx_bytes, tx_bytes, seconds):
+        self.sessions += 1
+        self.rx_bytes += rx_bytes
+        self.tx_bytes += tx_bytes
+        self.seconds += seconds
+        return (f"{self.sessions} sessions on {self.connections} connections, "
+                f"{self.rx_bytes} bytes received, {self.tx_bytes} bytes sent, "
+                f"{self.seconds / self.sessions:.2f} s per session")
+
+
+async def read_pdu(reader):
+    """Returns the next ULP PDU, or None when the connection is closed."""
+    try:
+        length = await reader.readexactly(LENGTH_SIZE)
+        size = int.from_bytes(length, 'big')
+        if size < LENGTH_SIZE:
+            raise ValueError(f"bad PDU length {size}")
+        return length + await reader.readexactly(size - LENGTH_SIZE)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        return None
+
+
+def session_id_patch(recorded, live):
+    """Returns the (byte, differing bits, live byte, recorded byte) of the request header."""
+    patch = []
+    for i in range(LENGTH_SIZE, min(HEADER_SIZE, len(recorded), len(live))):
+        mask = recorded[i] ^ live[i]
+        if mask:
+            patch.append((i, mask, live[i], recorded[i]))
+    return patch
+
+
+def apply_patch(pdu, patch):
+    pdu = bytearray(pdu)
+    for i, mask, live, recorded in patch:
+        if i < len(pdu):
+            # Only the bits that are the session ID of the recording in the response too
+            same = ~(pdu[i] ^ recorded) & mask
+            pdu[i] = (pdu[i] & ~same | live & same) & 0xff
+    return bytes(pdu)
+
+
+def log_session(peer, connection, number, rx_bytes, tx_bytes, start, totals, note=''):
+    seconds = time.monotonic() - start
+    print(f"{peer}: session {number} on connection {connection}, {rx_bytes} bytes in, "
+          f"{tx_bytes} bytes out, {seconds:.2f} s{note}")
+    print(f"  {totals.session(rx_bytes, tx_bytes, seconds)}{note}")
+
+
+async def replay(reader, writer, args, pdus, note, totals):
+    peer = writer.get_extra_info('peername')[0]
+    totals.connections += 1
+    connection = totals.connections
+    first_request = next(p['data'] for p in pdus if p['from'] == 'device')
+    number = 0
+
+    while True:
+        rx_bytes = tx_bytes = 0
+        start = None
+        patch = []
+        last_t = 0.0
+        for pdu in pdus:
+            if pdu['from'] == 'device':
+                data = await read_pdu(reader)
+                if data is None:
+                    if start is not None:
+                        print(f"{peer}: connection {connection} closed in a session")
+                    writer.close()
+                    return
+                if start is None:
+                    start = time.monotonic()
+                    patch = session_id_patch(first_request, data)
+                if len(data) != len(pdu['data']):
+                    print(f"{peer}: {len(data)} bytes received, {len(pdu['data'])} recorded")
+                rx_bytes += len(data)
+            else:
+                if args.timing:
+                    await asyncio.sleep(max(0.0, pdu['t'] - last_t))
+                data = apply_patch(pdu['data'], patch)
+                writer.write(data)
+                await writer.drain()
+                tx_bytes += len(data)
+            last_t = pdu['t']
+
+        number += 1
+        log_session(peer, connection, number, rx_bytes, tx_bytes, start, totals, note)
+        if args.close:
+            writer.close()
+            return
+
+
+async def record(reader, writer, args, totals):
+    peer = writer.get_extra_info('peername')[0]
+    host, port = args.upstream.rsplit(':', 1)
+    up_reader, up_writer = await asyncio.open_connection(host, int(port))
+    totals.connections += 1
+    start = time.monotonic()
+    pdus = []
+    sizes = {'device': 0, 'server': 0}
+
+    async def forward(source, sink, direction):
+        while (pdu := await read_pdu(source)) is not None:
+            pdus.append({'from': direction, 't': round(time.monotonic() - start, 3),
+                         'hex': pdu.hex()})
+            sizes[direction] += len(pdu)
+            print(f"{peer}: {direction} {len(pdu)} bytes")
+            sink.write(pdu)
+            await sink.drain()
+        sink.close()
+
+    await asyncio.gather(forward(reader, up_writer, 'device'),
+                         forward(up_reader, writer, 'server'))
+
+    with open(args.output, 'w') as f:
+        json.dump({'upstream': args.upstream, 'pdus': pdus}, f, indent=1)
+    log_session(peer, totals.connections, 1, sizes['device'], sizes['server'], start, totals)
+    print(f"  saved {len(pdus)} messages to {args.output}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Records and replays SUPL sessions.")
+    parser.add_argument('--host', default='0.0.0.0', help='Address to listen on')
+    parser.add_argument('--port', type=int, default=7276)
+    sub = parser.add_subparsers(dest='mode', required=True)
+    rec = sub.add_parser('record', help='Pass a session on to a server and save it')
+    rec.add_argument('--upstream', required=True, metavar='HOST:PORT')
+    rec.add_argument('--output', default='supl_session.json')
+    rep = sub.add_parser('replay', help='Answer the device with a saved session')
+    rep.add_argument('--session', default='supl_session.json')
+    rep.add_argument('--close', action='store_true', help='Close the connection after a session')
+    rep.add_argument('--timing', action='store_true', help='Keep the recorded server delays')
+    args = parser.parse_args()
+
+    totals = Totals()
+    if args.mode == 'replay':
+        with open(args.session) as f:
+            session = json.load(f)
+        pdus = session['pdus']
+        # Only a recording answers with real assistance, the figures of a made up session are not
+        # those of an assistance cycle.
+        note = ' (unverified, synthetic session)' if session.get('upstream') == 'synthetic' else ''
+        if note:
+            print(f"{args.session} is not a recording, the SUPL library rejects its assistance")
+        for pdu in pdus:
+            pdu['data'] = bytes.fromhex(pdu['hex'])
+        if not any(p['from'] == 'device' for p in pdus):
+            parser.error("the session has no device messages")
+        handler = lambda r, w: replay(r, w, args, pdus, note, totals)
+    else:
+        handler = lambda r, w: record(r, w, args, totals)
+
+    async def serve():
+        server = await asyncio.start_server(handler, args.host, args.port)
+        print(f"Listening on {args.host}:{args.port}, {args.mode}")
+        async with server:
+            await server.serve_forever()
+
+    try:
+        asyncio.run(serve())
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "mcc_location_table.h"
+#include "reference_table.h"
+
+/* The generated arrays, to check them directly. */
+#include "mcc_location_table.inc"
+
+/* Lookups per benchmark round, every MCC in the table and as many misses. */
+#define BENCH_ROUNDS	20
+
+ZTEST(mcc_lookup, test_every_mcc_matches_reference)
+{
+	uint32_t found = 0;
+
+	for (uint32_t mcc = 0; mcc <= UINT16_MAX; mcc++) {
+		const struct mcc_table *entry = mcc_lookup(mcc);
+		const struct reference_entry *ref = reference_lookup(mcc);
+
+		if (ref == NULL) {
+			zassert_is_null(entry, "MCC %u not in the reference table but found", mcc);
+			continue;
+		}
+
+		zassert_not_null(entry, "MCC %u in the reference table but not found", mcc);
+		zassert_equal(entry->confidence, ref->confidence, "MCC %u confidence", mcc);
+		zassert_equal(entry->unc_semiminor, ref->unc_semiminor, "MCC %u semiminor", mcc);
+		zassert_equal(entry->unc_semimajor, ref->unc_semimajor, "MCC %u semimajor", mcc);
+		zassert_equal(entry->orientation, ref->orientation, "MCC %u orientation", mcc);
+		zassert_equal(entry->lat, ref->lat, "MCC %u latitude", mcc);
+		zassert_equal(entry->lon, ref->lon, "MCC %u longitude", mcc);
+		found++;
+	}
+
+	zassert_equal(found, reference_size(), "%u of %zu reference entries found", found,
+		      reference_size());
+}
+
+ZTEST(mcc_lookup, test_keys_sorted_and_unique)
+{
+	zassert_equal(MCC_TABLE_SIZE, reference_size());
+
+	for (size_t i = 1; i < MCC_TABLE_SIZE; i++) {
+		zassert_true(mcc_table_keys[i - 1] < mcc_table_keys[i],
+			     "Keys %u and %u out of order at %zu", mcc_table_keys[i - 1],
+			     mcc_table_keys[i], i);
+	}
+}
+
+ZTEST(mcc_lookup, test_payload_layout)
+{
+	/* Naturally aligned, the floats are read with word loads. */
+	zassert_equal(sizeof(struct mcc_table), 12);
+	zassert_equal(sizeof(mcc_table_keys[0]), sizeof(uint16_t));
+}
+
+static uint32_t bench_ns(bool reference)
+{
+	uint32_t start = k_cycle_get_32();
+	uint32_t hits = 0;
+
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (size_t i = 0; i < MCC_TABLE_SIZE; i++) {
+			uint16_t mcc = mcc_table_keys[i];
+
+			/* A hit and a miss next to it. */
+			if (reference) {
+				hits += (reference_lookup(mcc) != NULL);
+				hits += (reference_lookup(mcc + 1000) != NULL);
+			} else {
+				hits += (mcc_lookup(mcc) != NULL);
+				hits += (mcc_lookup(mcc + 1000) != NULL);
+			}
+		}
+	}
+
+	zassert_true(hits >= BENCH_ROUNDS * MCC_TABLE_SIZE);
+
+	return k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+}
+
+ZTEST(mcc_lookup, test_benchmark)
+{
+	uint32_t calls = BENCH_ROUNDS * MCC_TABLE_SIZE * 2;
+	uint32_t sorted_ns;
+	uint32_t linear_ns;
+
+	if (IS_ENABLED(CONFIG_ARCH_POSIX)) {
+		/* Simulated time does not advance while code runs. */
+		ztest_test_skip();
+	}
+
+	sorted_ns = bench_ns(false);
+	linear_ns = bench_ns(true);
+
+	printk("lookup,calls,ns_per_call\n");
+	printk("binary_search,%u,%u\n", calls, sorted_ns / calls);
+	printk("linear_scan,%u,%u\n", calls, linear_ns / calls);
+}
+
+ZTEST_SUITE(mcc_lookup, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,24 @@
+#ifndef REFERENCE_TABLE_H_
+#define REFERENCE_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Entry of the former country sorted table, in its former packed layout. */
+struct __attribute__ ((__packed__)) reference_entry {
+	uint8_t confidence;
+	uint8_t unc_semiminor;
+	uint8_t unc_semimajor;
+	uint8_t orientation;
+	float lat;
+	float lon;
+	uint16_t mcc;
+};
+
+/** @brief Former linear scan lookup, NULL if the MCC is not in the table. */
+const struct reference_entry *reference_lookup(uint16_t mcc);
+
+/** @brief Returns the number of entries in the former table. */
+size_t reference_size(void);
+
+#endif /* REFERENCE_TABLE_H_ */
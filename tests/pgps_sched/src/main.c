@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+#include <modem/modem_info.h>
+
+#include "pgps_sched.h"
+#include "tx_sched.h"
+
+LOG_MODULE_REGISTER(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* A bus on a looping route: 40 cells of 20 minutes each, every third one with a good signal.
+ * The uplink connects for 10 seconds every 30 minutes, and a fix injects a prediction every
+ * hour. After the drive the bus is parked for two weeks in a cell with a weak signal.
+ */
+#define DRIVE_DAYS		60
+#define PARKED_DAYS		14
+#define CELLS			40
+#define PARKED_CELL		0x2000
+#define PARKED_RSRP_DBM		-115
+#define CELL_MIN		20
+#define CONNECTION_MIN		30
+#define CONNECTION_S		10
+#define FIX_MIN			60
+
+#define HOUR_MS			(3600LL * MSEC_PER_SEC)
+#define PERIOD_MS		((int64_t)CONFIG_NRF_CLOUD_PGPS_PREDICTION_PERIOD * 60 * MSEC_PER_SEC)
+#define SPAN_MS			(CONFIG_NRF_CLOUD_PGPS_NUM_PREDICTIONS * PERIOD_MS)
+#define URGENT_MS		(CONFIG_STINGSENSE_PGPS_PREFETCH_URGENT * HOUR_MS)
+#define GOOD_RSRP_DBM		CONFIG_STINGSENSE_PGPS_PREFETCH_RSRP
+
+struct drive_result {
+	int downloads;
+	int forced;		/* Downloads that opened a connection of their own */
+	int deferred;		/* Library requests held back by the scheduler */
+	int early;		/* Downloads outside a connection before the urgent point */
+	int weak;		/* Downloads in a weak signal before the urgent point */
+	int64_t min_left_ms;	/* Fewest predictions left at a download */
+	int rsrp_sum;
+};
+
+static bool sched;
+static struct drive_result result;
+static int64_t drive_start_ms;
+static int64_t sim_ms;
+static int64_t sim_min;
+static int cell_rsrp[CELLS];
+static int rsrp;
+
+/* Uptime of the drive, in sim_ms steps without the scheduler. */
+static int64_t now_ms(void)
+{
+	return sched ? k_uptime_get() - drive_start_ms : sim_ms;
+}
+
+/* LTE and transmit scheduler fakes. */
+static bool connected;
+static lte_lc_evt_handler_t lte_handler;
+static rsrp_cb_t rsrp_handler;
+static struct tx_sched_client *waiting;
+static int64_t waiting_until_ms = -1;
+
+bool tx_sched_connected(void)
+{
+	return connected;
+}
+
+void tx_sched_request(struct tx_sched_client *client, k_timeout_t max_delay)
+{
+	int64_t until_ms = now_ms() + k_ticks_to_ms_ceil64(max_delay.ticks);
+
+	waiting = client;
+	if (waiting_until_ms < 0 || until_ms < waiting_until_ms) {
+		waiting_until_ms = until_ms;
+	}
+}
+
+void lte_lc_register_handler(lte_lc_evt_handler_t handler)
+{
+	lte_handler = handler;
+}
+
+int modem_info_init(void)
+{
+	return 0;
+}
+
+int modem_info_rsrp_register(rsrp_cb_t cb)
+{
+	rsrp_handler = cb;
+
+	return 0;
+}
+
+/* P-GPS library model: it asks for new predictions once REPLACEMENT_THRESHOLD periods have
+ * expired, and a download is done when it returns.
+ */
+static int64_t library_downloaded_ms = -1;
+
+static void download(void)
+{
+	int64_t left_ms = SPAN_MS - (now_ms() - library_downloaded_ms);
+
+	if (library_downloaded_ms >= 0) {
+		result.min_left_ms = MIN(result.min_left_ms, left_ms);
+		if (left_ms > URGENT_MS) {
+			result.early += !connected;
+			result.weak += (rsrp < GOOD_RSRP_DBM);
+		}
+	}
+
+	result.downloads++;
+	result.forced += !connected;
+	result.rsrp_sum += rsrp;
+	library_downloaded_ms = now_ms();
+
+	if (sched) {
+		pgps_sched_fetch_done(true);
+	}
+}
+
+static void library_request(void)
+{
+	if (sched && pgps_sched_request()) {
+		result.deferred++;
+		return;
+	}
+
+	download();
+}
+
+static void library_preemptive(void)
+{
+	if (library_downloaded_ms < 0 ||
+	    (now_ms() - library_downloaded_ms) / PERIOD_MS >=
+	    CONFIG_NRF_CLOUD_PGPS_REPLACEMENT_THRESHOLD) {
+		library_request();
+	}
+}
+
+static void fetch(bool request_pending)
+{
+	if (request_pending) {
+		download();
+	} else {
+		library_preemptive();
+	}
+}
+
+/* Lets the work submitted so far run, and the simulated time pass. */
+static void sim_sleep_until(int64_t ms)
+{
+	if (sched) {
+		k_sleep(K_TIMEOUT_ABS_MS(drive_start_ms + ms));
+	}
+	sim_ms = ms;
+}
+
+static void release_waiting(void)
+{
+	struct tx_sched_client *client = waiting;
+
+	waiting = NULL;
+	waiting_until_ms = -1;
+	client->release(client);
+}
+
+static void cell_enter(uint32_t id, int mean_rsrp_dbm)
+{
+	struct lte_lc_evt evt = {
+		.type = LTE_LC_EVT_CELL_UPDATE,
+		.cell.id = id,
+	};
+
+	rsrp = mean_rsrp_dbm + rand() % 11 - 5;
+
+	if (sched) {
+		lte_handler(&evt);
+		rsrp_handler((char)(rsrp + 140));
+	}
+}
+
+static void connection(int64_t ms)
+{
+	struct lte_lc_evt evt = {
+		.type = LTE_LC_EVT_RRC_UPDATE,
+		.rrc_mode = LTE_LC_RRC_MODE_CONNECTED,
+	};
+
+	connected = true;
+	if (waiting != NULL) {
+		release_waiting();
+	}
+	if (sched) {
+		lte_handler(&evt);
+	}
+	sim_sleep_until(ms + CONNECTION_S * MSEC_PER_SEC);
+	connected = false;
+}
+
+/* Starts a new device, with no predictions stored. */
+static void device_start(bool with_sched)
+{
+	sched = with_sched;
+	library_downloaded_ms = -1;
+	drive_start_ms = k_uptime_get();
+	sim_ms = 0;
+	sim_min = 0;
+	connected = false;
+	waiting = NULL;
+	waiting_until_ms = -1;
+
+	srand(1);
+	for (int i = 0; i < CELLS; i++) {
+		cell_rsrp[i] = (i % 3 == 0) ? -85 - rand() % 8 : -108 - rand() % 10;
+	}
+}
+
+static void drive(const char *name, int days, bool parked, struct drive_result *out)
+{
+	int64_t end = sim_min + days * 24 * 60;
+
+	result = (struct drive_result){ .min_left_ms = INT64_MAX };
+
+	for (; sim_min < end; sim_min++) {
+		int64_t min = sim_min;
+		int64_t ms = min * 60 * MSEC_PER_SEC;
+
+		sim_sleep_until(ms);
+
+		if (min % CELL_MIN == 0) {
+			if (parked) {
+				cell_enter(PARKED_CELL, PARKED_RSRP_DBM);
+			} else {
+				cell_enter(0x1000 + (min / CELL_MIN) % CELLS,
+					   cell_rsrp[(min / CELL_MIN) % CELLS]);
+			}
+		}
+		if (min % CONNECTION_MIN == 0) {
+			connection(ms);
+		}
+		if (waiting != NULL && sim_ms >= waiting_until_ms) {
+			release_waiting();
+		}
+		if (min % FIX_MIN == 0) {
+			if (sched) {
+				pgps_sched_check();
+			}
+			library_preemptive();
+		}
+	}
+	*out = result;
+
+	TC_PRINT("%s: %d downloads, %d connections of their own, mean RSRP %d dBm, "
+		 "fewest %lld hours left, %d requests held back\n",
+		 name, result.downloads, result.forced,
+		 result.rsrp_sum / MAX(result.downloads, 1), result.min_left_ms / HOUR_MS,
+		 result.deferred);
+}
+
+ZTEST(pgps_sched, test_drive)
+{
+	struct drive_result reactive;
+	struct drive_result scheduled;
+	struct drive_result parked;
+
+	device_start(false);
+	drive("reactive", DRIVE_DAYS, false, &reactive);
+
+	zassert_ok(pgps_sched_init(fetch));
+	device_start(true);
+	drive("scheduler", DRIVE_DAYS, false, &scheduled);
+	drive("scheduler, parked", PARKED_DAYS, true, &parked);
+
+	/* Expiry: the predictions are replaced before they run out. */
+	zassert_true(scheduled.downloads >= DRIVE_DAYS * 24 * HOUR_MS / SPAN_MS,
+		     "%d downloads", scheduled.downloads);
+	zassert_true(scheduled.min_left_ms > 0, "Predictions ran out");
+
+	/* Deferred: the requests of the library wait for a good window. */
+	zassert_true(scheduled.deferred > 0);
+	zassert_equal(scheduled.weak, 0, "%d downloads in a weak signal", scheduled.weak);
+
+	/* Urgent: only then a download opens a connection of its own, the first download aside,
+	 * when the age of the stored predictions is unknown.
+	 */
+	zassert_equal(scheduled.early, 0, "%d early downloads outside a connection",
+		      scheduled.early);
+
+	/* Parked in a weak signal, every download waits for the urgent point. */
+	zassert_true(parked.downloads >= PARKED_DAYS * 24 * HOUR_MS / (SPAN_MS - URGENT_MS) - 1,
+		     "%d downloads", parked.downloads);
+	zassert_equal(parked.early, 0);
+	zassert_true(parked.min_left_ms > 0 && parked.min_left_ms <= URGENT_MS,
+		     "%lld hours left", parked.min_left_ms / HOUR_MS);
+
+	/* Against sending every request of the library at once. */
+	zassert_true(scheduled.downloads <= reactive.downloads, "%d downloads, %d reactive",
+		     scheduled.downloads, reactive.downloads);
+	zassert_true(scheduled.forced < reactive.forced, "%d connections, %d reactive",
+		     scheduled.forced, reactive.forced);
+	zassert_true(scheduled.rsrp_sum / scheduled.downloads >
+		     reactive.rsrp_sum / reactive.downloads);
+}
+
+ZTEST_SUITE(pgps_sched, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,188 @@
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "stats.h"
+#include "mcc_location_table.h"
+
+#define PI			3.14159265358979323846
+#define EARTH_RADIUS_METERS	6371000.0
+/* Meters of one degree along a great circle. */
+#define METERS_PER_DEGREE	(EARTH_RADIUS_METERS * PI / 180.0)
+
+#define RAMP_SIZE		100
+
+/* GNSS integer coordinates of +-90 degrees latitude and +-180 degrees longitude (2^23). */
+#define GNSS_COORD_MAX		8388608
+
+/* Fixed permutation of 0..RAMP_SIZE - 1, so the sort has work to do. */
+static void ramp_shuffled(double *buf)
+{
+	for (int i = 0; i < RAMP_SIZE; i++) {
+		buf[i] = (i * 37) % RAMP_SIZE;
+	}
+}
+
+ZTEST(stats, test_constant_window)
+{
+	double buf[50];
+	struct accel_stats stats;
+
+	for (int i = 0; i < ARRAY_SIZE(buf); i++) {
+		buf[i] = -9.81;
+	}
+
+	calculate_stats(buf, ARRAY_SIZE(buf), &stats);
+
+	zassert_within(stats.mean, -9.81, 1e-12);
+	zassert_within(stats.variance, 0.0, 1e-12);
+	zassert_equal(stats.p1, -9.81);
+	zassert_equal(stats.p10, -9.81);
+	zassert_equal(stats.p90, -9.81);
+	zassert_equal(stats.p99, -9.81);
+}
+
+ZTEST(stats, test_ramp_window)
+{
+	double buf[RAMP_SIZE];
+	struct accel_stats stats;
+
+	ramp_shuffled(buf);
+	calculate_stats(buf, ARRAY_SIZE(buf), &stats);
+
+	/* Population variance of 0..n-1 is (n^2 - 1) / 12. */
+	zassert_within(stats.mean, 49.5, 1e-12);
+	zassert_within(stats.variance, (RAMP_SIZE * RAMP_SIZE - 1) / 12.0, 1e-9);
+	zassert_equal(stats.p1, 1.0);
+	zassert_equal(stats.p10, 10.0);
+	zassert_equal(stats.p90, 90.0);
+	zassert_equal(stats.p99, 99.0);
+
+	for (int i = 0; i < RAMP_SIZE; i++) {
+		zassert_equal(buf[i], i, "Window not sorted in place at %d", i);
+	}
+}
+
+ZTEST(stats, test_small_window_percentiles)
+{
+	double buf[] = { 3.0, -1.0, 2.0, 0.5 };
+	struct accel_stats stats;
+
+	calculate_stats(buf, ARRAY_SIZE(buf), &stats);
+
+	/* The indices are truncated: p1 and p10 are index 0, p90 and p99 index 3. */
+	zassert_within(stats.mean, 1.125, 1e-12);
+	zassert_within(stats.variance, (9.0 + 1.0 + 4.0 + 0.25) / 4 - 1.125 * 1.125, 1e-12);
+	zassert_equal(stats.p1, -1.0);
+	zassert_equal(stats.p10, -1.0);
+	zassert_equal(stats.p90, 3.0);
+	zassert_equal(stats.p99, 3.0);
+}
+
+ZTEST(stats, test_single_sample)
+{
+	double buf[] = { 0.25 };
+	struct accel_stats stats;
+
+	calculate_stats(buf, ARRAY_SIZE(buf), &stats);
+
+	zassert_equal(stats.mean, 0.25);
+	zassert_equal(stats.variance, 0.0);
+	zassert_equal(stats.p1, 0.25);
+	zassert_equal(stats.p99, 0.25);
+}
+
+ZTEST(stats, test_empty_window_untouched)
+{
+	double buf[1] = { 1.0 };
+	struct accel_stats stats;
+	struct accel_stats before;
+
+	memset(&stats, 0x5a, sizeof(stats));
+	before = stats;
+
+	calculate_stats(buf, 0, &stats);
+
+	zassert_mem_equal(&stats, &before, sizeof(stats));
+}
+
+ZTEST(stats, test_distance_same_point)
+{
+	zassert_equal(distance_calculate(33.7756, -84.3963, 33.7756, -84.3963), 0.0);
+}
+
+ZTEST(stats, test_distance_one_degree)
+{
+	/* Along a meridian and along the equator, one degree is the same arc. */
+	zassert_within(distance_calculate(10.0, 20.0, 11.0, 20.0), METERS_PER_DEGREE, 1e-6);
+	zassert_within(distance_calculate(0.0, 20.0, 0.0, 21.0), METERS_PER_DEGREE, 1e-6);
+	/* At 60 degrees of latitude a degree of longitude is about half as long. */
+	zassert_within(distance_calculate(60.0, 0.0, 60.0, 1.0), METERS_PER_DEGREE / 2, 10.0);
+}
+
+ZTEST(stats, test_distance_long_arcs)
+{
+	zassert_within(distance_calculate(0.0, 0.0, 90.0, 0.0), EARTH_RADIUS_METERS * PI / 2,
+		       1e-6);
+	zassert_within(distance_calculate(0.0, 0.0, 0.0, 180.0), EARTH_RADIUS_METERS * PI, 1e-6);
+	/* Across the antimeridian the short way round. */
+	zassert_within(distance_calculate(0.0, 179.5, 0.0, -179.5), METERS_PER_DEGREE, 1e-6);
+}
+
+ZTEST(stats, test_distance_symmetric)
+{
+	double there = distance_calculate(33.7756, -84.3963, 33.7490, -84.3880);
+	double back = distance_calculate(33.7490, -84.3880, 33.7756, -84.3963);
+
+	zassert_within(there, back, 1e-9);
+	/* Georgia Tech to downtown Atlanta, about 3 km. */
+	zassert_between_inclusive(there, 3000.0, 3100.0, "%d m", (int)there);
+}
+
+ZTEST(stats, test_coord_convert_zero)
+{
+	zassert_equal(lat_convert(0.0f), 0);
+	zassert_equal(lon_convert(0.0f), 0);
+	zassert_equal(lat_convert(-0.0f), 0);
+	zassert_equal(lon_convert(-0.0f), 0);
+}
+
+ZTEST(stats, test_coord_convert_edges)
+{
+	zassert_within(lat_convert(90.0f), GNSS_COORD_MAX, 1);
+	zassert_within(lat_convert(-90.0f), -GNSS_COORD_MAX, 1);
+	zassert_within(lon_convert(180.0f), GNSS_COORD_MAX, 1);
+	zassert_within(lon_convert(-180.0f), -GNSS_COORD_MAX, 1);
+	/* Half way, latitude and longitude have different scales. */
+	zassert_within(lat_convert(45.0f), GNSS_COORD_MAX / 2, 1);
+	zassert_within(lon_convert(90.0f), GNSS_COORD_MAX / 2, 1);
+}
+
+ZTEST(stats, test_coord_convert_known)
+{
+	/* Georgia Tech, 33.7756 * 2^23 / 90 and -84.3963 * 2^24 / 360. */
+	zassert_within(lat_convert(33.7756f), 3148114, 1);
+	zassert_within(lon_convert(-84.3963f), -3933152, 1);
+	/* Sydney, southern and eastern hemispheres. */
+	zassert_within(lat_convert(-33.8688f), -3156801, 1);
+	zassert_within(lon_convert(151.2093f), 7046864, 1);
+}
+
+ZTEST(stats, test_coord_convert_sign)
+{
+	static const float degrees[] = { 0.0001f, 1.0f, 24.9384f, 60.1699f, 89.9999f };
+
+	/* Truncated toward zero, so a negated input gives exactly the negated result. */
+	for (int i = 0; i < ARRAY_SIZE(degrees); i++) {
+		int32_t lat = lat_convert(degrees[i]);
+		int32_t lon = lon_convert(2.0f * degrees[i]);
+
+		zassert_true(lat > 0, "lat %d", i);
+		zassert_true(lon > 0, "lon %d", i);
+		zassert_equal(lat_convert(-degrees[i]), -lat, "lat %d", i);
+		zassert_equal(lon_convert(-2.0f * degrees[i]), -lon, "lon %d", i);
+	}
+}
+
+ZTEST_SUITE(stats, NULL, NULL, NULL, NULL, NULL);